@@ -15,11 +15,82 @@
 #include "HAL/FileManager.h"
 #include "Misc/Paths.h"
 #include "UObject/Package.h"
+#include "GeoJsonStreamReader.h"
+#include "BuildingLayerCache.h"
+#include "PolygonTriangulator.h"
+#include "BuildingMeshChunks.h"
+#include "BuildingGeometry.h"
+#include "BuildingLod.h"
+#include "BuildingInstances.h"
+#include "BuildingRebuildCache.h"
+#include "BuildingImageDecoder.h"
+#include "BuildingProjection.h"
+#include "BuildingScratch.h"
+#include "BuildingVertexCache.h"
+#include "Hash/CityHash.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+#include "BuilderAllocCounter.h"
+#include "UObject/MetaData.h"
+#include "ObjectTools.h"
 
 
 
 
 const float	threshold = FLT_EPSILON;
+const float material_opacity = 0.5f;
+
+//һԷFRawMeshд׶β
+static void AllocateRawMesh(const FMeshSize& size, FRawMesh& mesh)
+{
+	mesh.VertexPositions.SetNumUninitialized(size.vertices);
+	mesh.WedgeIndices.SetNumUninitialized(size.indices);
+	mesh.WedgeTexCoords[0].SetNumUninitialized(size.indices);
+	mesh.WedgeTangentX.SetNumUninitialized(size.indices);
+	mesh.WedgeTangentY.SetNumUninitialized(size.indices);
+	mesh.WedgeTangentZ.SetNumUninitialized(size.indices);
+	mesh.WedgeColors.SetNumUninitialized(size.indices);
+	mesh.FaceMaterialIndices.SetNumUninitialized(size.faces);
+	mesh.FaceSmoothingMasks.SetNumUninitialized(size.faces);
+}
+
+//FRawMeshдͼֻʹõһ
+static FRawMeshView MakeRawMeshView(FRawMesh& mesh)
+{
+	FRawMeshView view;
+	view.VertexPositions = mesh.VertexPositions;
+	view.WedgeIndices = mesh.WedgeIndices;
+	view.WedgeTexCoords = mesh.WedgeTexCoords[0];
+	view.WedgeTangentX = mesh.WedgeTangentX;
+	view.WedgeTangentY = mesh.WedgeTangentY;
+	view.WedgeTangentZ = mesh.WedgeTangentZ;
+	view.WedgeColors = mesh.WedgeColors;
+	view.FaceMaterialIndices = mesh.FaceMaterialIndices;
+	view.FaceSmoothingMasks = mesh.FaceSmoothingMasks;
+	return view;
+}
+
+static FString GetImagePath(const FString& ImageName)
+{
+	return FPaths::ProjectContentDir() + "Image/" + ImageName;
+}
+
+//ȡ֮ǰԴԪеCacheKeyһʱΪ
+template<typename AssetType>
+static AssetType* LoadCachedAsset(const FString& PackageName, const FString& AssetName, const FString& CacheKey)
+{
+	if (!FPackageName::DoesPackageExist(PackageName))
+	{
+		return nullptr;
+	}
+	AssetType* Asset = LoadObject<AssetType>(nullptr, *(PackageName + "." + AssetName));
+	if (Asset == nullptr || Asset->GetOutermost()->GetMetaData()->GetValue(Asset, TEXT("CacheKey")) != CacheKey)
+	{
+		return nullptr;
+	}
+	return Asset;
+}
 // Sets default values
 ABuilder::ABuilder()
 {
@@ -27,11 +98,37 @@ ABuilder::ABuilder()
 	PrimaryActorTick.bCanEverTick = true;
 
 	m_file_path = FPaths::ProjectDir() + "Data/";
+	m_package_root = TEXT("/Game");
 	m_use_pmc = false;
+	m_use_stream_reader = true;
+	m_use_layer_cache = true;
 	wall_pmc = CreateDefaultSubobject<UProceduralMeshComponent>("wall_pmc");
 	wall_pmc->SetupAttachment(GetRootComponent());
 	m_wall_top_dis = 1.0;
 	m_wall_bottom_dis = 2.0;
+	m_wall_crease_angle = 30.0;
+	InitWallBands();
+	//ǽֶλݶȾ㲻16λޣֻʣһ򵽴ȵĿܳ
+	m_tile_max_vertices = 65535;
+	m_tile_max_triangles = 131072;
+	m_tile_max_depth = 16;
+	//LOD1LOD2ݲΪͼݲ14LOD210µĽúӴ
+	m_lod_tolerance = 1.0;
+	m_lod_proxy_size = 10.0;
+	m_lod_tolerance_scales = { 1.0f, 4.0f };
+	m_lod_screen_sizes = { 0.3f, 0.1f };
+	//ظ4ϡ5ڵĽԭ
+	m_use_instancing = true;
+	m_instance_min_count = 4;
+	m_instance_quantize = 0.05f;
+	m_instance_saved_vertices = 0;
+	m_instance_saved_bytes = 0;
+	m_use_rebuild_cache = true;
+	m_optimize_vertex_cache = true;
+	build_task = nullptr;
+	m_game_thread_budget = 0.01;
+	m_build_succeeded = false;
+	m_duplicate_package_saves = 0;
 
 	roof_pmc = CreateDefaultSubobject<UProceduralMeshComponent>("roof_pmc");
 	roof_pmc->SetupAttachment(GetRootComponent());
@@ -66,18 +163,42 @@ void ABuilder::SetPath(const FString& path)
 }
 bool ABuilder::ParseJson()
 {
+	SCOPE_CYCLE_COUNTER(STAT_BuildingParse);
+	m_stage_times.Empty();
+	m_building_index.Empty();
+	double start_time = FPlatformTime::Seconds();
 	if (!ParseMapJson())
 	{
 		return false;
 	}
+	addStageTime(TEXT("parse_map"), start_time);
 
+	start_time = FPlatformTime::Seconds();
 	if (!ParseBuildingsJson())
 	{
 		return false;
 	}
+	addStageTime(TEXT("parse_buildings"), start_time);
 
 	return true;
 }
+void ABuilder::writeBakeReport()
+{
+	WriteBakeReport(GetBakeReportFileName(), m_bake_report, m_stage_times);
+}
+void ABuilder::addStageTime(const TCHAR* stage, double start_time)
+{
+	double seconds = FPlatformTime::Seconds() - start_time;
+	for (TPair<FString, double>& stage_time : m_stage_times)
+	{
+		if (stage_time.Key == stage)
+		{
+			stage_time.Value = seconds;
+			return;
+		}
+	}
+	m_stage_times.Emplace(stage, seconds);
+}
 bool ABuilder::ParseMapJson()
 {
 	FString path = m_file_path + "map.json";
@@ -103,7 +224,7 @@ bool ABuilder::ParseMapJson()
 		if (rRoot->HasField(TEXT("data")))
 		{
 			TSharedPtr<FJsonObject> data = rRoot->GetObjectField(TEXT("data"));
-			TArray<TSharedPtr<FJsonValue>> layers = data->GetArrayField(TEXT("layers"));
+			const TArray<TSharedPtr<FJsonValue>>& layers = data->GetArrayField(TEXT("layers"));
 			for (int i = 0; i < layers.Num(); i++)
 			{
 				const TSharedPtr<FJsonObject>* layer;
@@ -123,23 +244,27 @@ bool ABuilder::ParseMapJson()
 							continue;
 						}
 						building_layer_info.opacity = layerConfig->GetNumberField(TEXT("opacity"));
-						TArray<TSharedPtr<FJsonValue>> roughness = layerConfig->GetArrayField(TEXT("roughness"));
+						//LODݲѡ
+						double simplify_tolerance = m_lod_tolerance;
+						layerConfig->TryGetNumberField(TEXT("simplifyTolerance"), simplify_tolerance);
+						building_layer_info.simplify_tolerance = simplify_tolerance;
+						const TArray<TSharedPtr<FJsonValue>>& roughness = layerConfig->GetArrayField(TEXT("roughness"));
 						building_layer_info.roof_roughness = roughness[0].Get()->AsNumber();
 						building_layer_info.wall_roughness = roughness[1].Get()->AsNumber();
 
-						TArray<TSharedPtr<FJsonValue>> metalness = layerConfig->GetArrayField(TEXT("metalness"));
+						const TArray<TSharedPtr<FJsonValue>>& metalness = layerConfig->GetArrayField(TEXT("metalness"));
 						building_layer_info.roof_metalness = metalness[0].Get()->AsNumber();
 						building_layer_info.wall_metalness = metalness[1].Get()->AsNumber();
 
 
-						TArray<TSharedPtr<FJsonValue>> imageUrls = layerConfig->GetArrayField(TEXT("imageUrl"));
+						const TArray<TSharedPtr<FJsonValue>>& imageUrls = layerConfig->GetArrayField(TEXT("imageUrl"));
 						for (int j = 0; j < imageUrls.Num(); j++)
 						{
 							const TSharedPtr<FJsonObject>* imageUrl;
 							if (imageUrls[j].Get()->TryGetObject(imageUrl))
 							{
 								FString condition = imageUrl->Get()->GetStringField(TEXT("condition"));
-								TArray<TSharedPtr<FJsonValue>> values = imageUrl->Get()->GetArrayField(TEXT("value"));
+								const TArray<TSharedPtr<FJsonValue>>& values = imageUrl->Get()->GetArrayField(TEXT("value"));
 								float height = 0.0f;
 								int32 index = 0;
 								if (condition.FindChar('>', index))
@@ -158,8 +283,78 @@ bool ABuilder::ParseMapJson()
 							}
 						}
 						//Ӷ
-						TTuple<int32, FGeoBuildingLayerInfo> info(building_layer_info.layer_id, building_layer_info);
-						m_building_layer_info.Add(info);
+						m_building_layer_info.Add(building_layer_info.layer_id, MoveTemp(building_layer_info));
+					}
+				}
+			}
+
+			//ǽֶãѡײ߶ֶο
+			double wall_distance = 0.0;
+			if (data->TryGetNumberField(TEXT("wallTopDistance"), wall_distance))
+			{
+				m_wall_top_dis = wall_distance;
+			}
+			if (data->TryGetNumberField(TEXT("wallBottomDistance"), wall_distance))
+			{
+				m_wall_bottom_dis = wall_distance;
+			}
+			InitWallBands();
+			//ֿԤ㣨ѡ
+			int32 tile_budget = 0;
+			if (data->TryGetNumberField(TEXT("tileMaxVertices"), tile_budget))
+			{
+				m_tile_max_vertices = tile_budget;
+			}
+			if (data->TryGetNumberField(TEXT("tileMaxTriangles"), tile_budget))
+			{
+				m_tile_max_triangles = tile_budget;
+			}
+			//ԴݻؽأѡܲʱرԲ
+			bool use_cache = true;
+			if (data->TryGetBoolField(TEXT("useLayerCache"), use_cache))
+			{
+				m_use_layer_cache = use_cache;
+			}
+			if (data->TryGetBoolField(TEXT("useRebuildCache"), use_cache))
+			{
+				m_use_rebuild_cache = use_cache;
+			}
+			//ԴڵĸĿ¼ѡΪMeshTextureMaterialܲʹõĿ¼ʽԴ
+			FString package_root;
+			if (data->TryGetStringField(TEXT("packageRoot"), package_root) && package_root.StartsWith(TEXT("/")))
+			{
+				package_root.RemoveFromEnd(TEXT("/"));
+				m_package_root = package_root;
+			}
+			bool optimize_vertex_cache = true;
+			if (data->TryGetBoolField(TEXT("optimizeVertexCache"), optimize_vertex_cache))
+			{
+				m_optimize_vertex_cache = optimize_vertex_cache;
+			}
+			//ʵãѡظΪ0ʱر
+			int32 instance_min_count = 0;
+			if (data->TryGetNumberField(TEXT("instanceMinCount"), instance_min_count))
+			{
+				m_use_instancing = instance_min_count > 0;
+				m_instance_min_count = instance_min_count;
+			}
+			const TArray<TSharedPtr<FJsonValue>>* wall_bands = nullptr;
+			if (data->TryGetArrayField(TEXT("wallBands"), wall_bands))
+			{
+				for (const TSharedPtr<FJsonValue>& wall_band : *wall_bands)
+				{
+					const TSharedPtr<FJsonObject>* band_config;
+					if (!wall_band->TryGetObject(band_config))
+					{
+						continue;
+					}
+					FString band_name = band_config->Get()->GetStringField(TEXT("name"));
+					for (FWallBand& band : m_wall_bands)
+					{
+						if (band.name == band_name)
+						{
+							band.enabled = band_config->Get()->GetBoolField(TEXT("enabled"));
+						}
 					}
 				}
 			}
@@ -180,83 +375,133 @@ bool ABuilder::ParseBuildingsJson()
 	{
 		int32 layer_id = it->Value.layer_id;
 		FString file_name = m_file_path + it->Value.url;
-		TSharedPtr<FJsonObject> rRoot;
-		if (!getJsonRootObjectFromFile(file_name, rRoot))
+
+		double start_time = FPlatformTime::Seconds();
+		FBuildingLayer building_map;
+
+		//Դļδ仯ʱֱӳƻ棬ڻʱ˵JSON
+		FBuildingCacheKey cache_key;
+		FString cache_file = FBuildingLayerCache::GetCacheFileName(file_name);
+		bool has_cache_key = m_use_layer_cache && FBuildingLayerCache::MakeKey(file_name, cache_key);
+		if (has_cache_key && FBuildingLayerCache::Load(cache_file, cache_key, building_map))
 		{
+			UE_LOG(LogClass, Log, TEXT("load layer %d from cache: %d buildings, %.3f s"), layer_id, building_map.Num(), FPlatformTime::Seconds() - start_time);
+			m_building_layer_data.Add(layer_id, MoveTemp(building_map));
 			continue;
 		}
 
+		uint64 start_memory = FPlatformMemory::GetStats().UsedPhysical;
+		uint64 peak_memory = start_memory;
+		bool parsed = m_use_stream_reader ? ParseBuildingsFile_StreamImp(file_name, building_map, peak_memory)
+			: ParseBuildingsFile_DOMImp(file_name, building_map, peak_memory);
+		if (!parsed)
+		{
+			continue;
+		}
+		//ʱڴֵڶԱֽʽ
+		UE_LOG(LogClass, Log, TEXT("parse layer %d (%s): %d buildings, %.3f s, peak memory +%.1f MB"),
+			layer_id, m_use_stream_reader ? TEXT("stream") : TEXT("dom"), building_map.Num(),
+			FPlatformTime::Seconds() - start_time, (peak_memory - start_memory) / (1024.0 * 1024.0));
+		UE_LOG(LogClass, Log, TEXT("layer %d storage: %d coords, %.1f MB, %.1f bytes per building"), layer_id, building_map.NumCoords(),
+			building_map.GetAllocatedSize() / (1024.0 * 1024.0), building_map.Num() > 0 ? (double)building_map.GetAllocatedSize() / building_map.Num() : 0.0);
+
+		if (has_cache_key && !FBuildingLayerCache::Save(cache_file, cache_key, building_map))
+		{
+			UE_LOG(LogClass, Warning, TEXT("save layer cache failed: %s"), *cache_file);
+		}
+
+		m_building_layer_data.Add(layer_id, MoveTemp(building_map));
+	}
+	return true;
+}
+bool ABuilder::ParseBuildingsFile_DOMImp(const FString& file_name, FBuildingLayer& building_data, uint64& peak_memory)
+{
+	TSharedPtr<FJsonObject> rRoot;
+	if (!getJsonRootObjectFromFile(file_name, rRoot, peak_memory))
+	{
+		return false;
+	}
+
+	if (!rRoot->HasField(TEXT("features")))
+	{
+		return false;
+	}
 
-		if (rRoot->HasField(TEXT("features")))
+	const TArray<TSharedPtr<FJsonValue>>& features = rRoot->GetArrayField(TEXT("features"));
+	//γȽţ˫
+	TArray<double> ring;
+	for (int i = 0; i < features.Num(); i++)
+	{
+		const TSharedPtr<FJsonObject>* feature;
+		if (features[i].Get()->TryGetObject(feature))
 		{
-			TArray<FBuildingInfo> building_map;
-			TArray<TSharedPtr<FJsonValue>> features = rRoot->GetArrayField(TEXT("features"));
-			for (int i = 0; i < features.Num(); i++)
-			{
-				const TSharedPtr<FJsonObject>* feature;
-				if (features[i].Get()->TryGetObject(feature))
-				{
 
-					//feture type
-					FString feature_type = feature->Get()->GetStringField(TEXT("type"));
-					if (feature_type != "Feature")
-					{
-						UE_LOG(LogClass, Error, TEXT("type is not Feature"));
-						continue;
-					}
+			//feture type
+			FString feature_type = feature->Get()->GetStringField(TEXT("type"));
+			if (feature_type != "Feature")
+			{
+				UE_LOG(LogClass, Error, TEXT("type is not Feature"));
+				continue;
+			}
 
-					//properties
-					TSharedPtr<FJsonObject> properties = feature->Get()->GetObjectField(TEXT("properties"));
-					if (properties == nullptr)
-					{
-						UE_LOG(LogClass, Error, TEXT("properties is null"));
-						continue;
-					}
+			//properties
+			TSharedPtr<FJsonObject> properties = feature->Get()->GetObjectField(TEXT("properties"));
+			if (properties == nullptr)
+			{
+				UE_LOG(LogClass, Error, TEXT("properties is null"));
+				continue;
+			}
 
-					float feature_height = properties->GetNumberField(TEXT("height"));
-					float feature_code = properties->GetIntegerField(TEXT("code"));
+			float feature_height = properties->GetNumberField(TEXT("height"));
+			float feature_code = properties->GetIntegerField(TEXT("code"));
 
-					//geometries
-					TSharedPtr<FJsonObject> geometry = feature->Get()->GetObjectField(TEXT("geometry"));
-					FString geometry_type = geometry->GetStringField(TEXT("type"));
-					if (geometry_type != "MultiPolygon")
+			//geometries
+			TSharedPtr<FJsonObject> geometry = feature->Get()->GetObjectField(TEXT("geometry"));
+			FString geometry_type = geometry->GetStringField(TEXT("type"));
+			if (geometry_type != "MultiPolygon")
+			{
+				UE_LOG(LogClass, Error, TEXT("geometry type is not multipolygon"));
+				continue;
+			}
+			const TArray<TSharedPtr<FJsonValue>>& feature_coordinates = geometry->GetArrayField(TEXT("coordinates"));
+			for (const TSharedPtr<FJsonValue>& feature_coordinate : feature_coordinates)
+			{
+				ring.Reset();
+				const TArray<TSharedPtr<FJsonValue>>& polygon_coordinates = feature_coordinate.Get()->AsArray();
+				const TArray<TSharedPtr<FJsonValue>>& coordinates = polygon_coordinates[0].Get()->AsArray();
+				for (int j = 0; j < coordinates.Num(); j++)
+				{
+					const TArray<TSharedPtr<FJsonValue>>& coordinate = coordinates[j].Get()->AsArray();
+					double lon = coordinate[0].Get()->AsNumber();
+					double lat = coordinate[1].Get()->AsNumber();
+					//ֹغϣֹ
+					if (j > 0 && j + 1 == coordinates.Num() && FMath::Sqrt(FMath::Square(ring[0] - lon) + FMath::Square(ring[1] - lat)) < threshold)
 					{
-						UE_LOG(LogClass, Error, TEXT("geometry type is not multipolygon"));
 						continue;
 					}
-					TArray<TSharedPtr<FJsonValue>> feature_coordinates = geometry->GetArrayField(TEXT("coordinates"));
-					for (TSharedPtr<FJsonValue> feature_coordinate : feature_coordinates)
-					{
-						FBuildingInfo building;
-						building.height = feature_height;
-						building.code = feature_code;
-						const TArray<TSharedPtr<FJsonValue>> polygon_coordinates = feature_coordinate.Get()->AsArray();
-						const TArray<TSharedPtr<FJsonValue>> coordinates = polygon_coordinates[0].Get()->AsArray();
-						for (int j = 0; j < coordinates.Num(); j++)
-						{
-							const TArray<TSharedPtr<FJsonValue>> coordinate = coordinates[j].Get()->AsArray();
-							FVector coord;
-							coord.X = coordinate[0].Get()->AsNumber();
-							coord.Y = coordinate[1].Get()->AsNumber();
-							//ֹغϣֹ
-							if (j + 1 == coordinates.Num() && FVector::Dist(building.coords[0], coord) < threshold)
-							{
-								continue;
-							}
-							building.coords.Emplace(coord);
-						}
-						building_map.Add(building);
-					}
+					ring.Add(lon);
+					ring.Add(lat);
 				}
+				building_data.AddSourceBuilding(feature_code, feature_height, ring);
 			}
-			TTuple<int32, TArray<FBuildingInfo>> map_info(layer_id, building_map);
-			m_building_layer_data.Add(map_info);
 		}
-
 	}
+	peak_memory = FMath::Max(peak_memory, FPlatformMemory::GetStats().UsedPhysical);
+	return true;
+}
+bool ABuilder::ParseBuildingsFile_StreamImp(const FString& file_name, FBuildingLayer& building_data, uint64& peak_memory)
+{
+	FGeoJsonStreamReader reader;
+	if (!reader.Open(file_name) || !reader.ReadBuildings(building_data))
+	{
+		FString errorMsg = file_name + "ʧ: " + reader.GetError();
+		UE_LOG(LogClass, Error, TEXT("===%s==="), *errorMsg);
+		return false;
+	}
+	peak_memory = FMath::Max(peak_memory, FPlatformMemory::GetStats().UsedPhysical);
 	return true;
 }
-bool ABuilder::getJsonRootObjectFromFile(FString file_name, TSharedPtr<FJsonObject>& json_root)
+bool ABuilder::getJsonRootObjectFromFile(const FString& file_name, TSharedPtr<FJsonObject>& json_root, uint64& peak_memory)
 {
 	FString json = "";
 	if (!FFileHelper::LoadFileToString(json, *(file_name)) || json == "")
@@ -273,659 +518,1228 @@ bool ABuilder::getJsonRootObjectFromFile(FString file_name, TSharedPtr<FJsonObje
 		UE_LOG(LogClass, Error, TEXT("===%s==="), *errorMsg);
 		return false;
 	}
+	//DOMķֵļַͷǰַDOMͬʱռڴ
+	peak_memory = FMath::Max(peak_memory, FPlatformMemory::GetStats().UsedPhysical);
 
 	return true;
 }
 
 void ABuilder::CreateMesh()
 {
-	//116.3,40.0--beijing
-	//114.3,30.6---
-	ProcessCoords(114.3, 30.6);
-	FTransform transform;
-	CreateWallMesh();
-	CreateRoofMesh();
+	if (build_task != nullptr && build_task->IsRunning())
+	{
+		UE_LOG(LogClass, Warning, TEXT("mesh build is already running"));
+		return;
+	}
+	//ͼڹ߳Ͻ룬ImageWrapperģϷ̼߳
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>("ImageWrapper");
+	GenerateMesh();
+	double game_thread_start_time = FPlatformTime::Seconds();
+	runGameThreadTasks(0.0);
+	addStageTime(TEXT("game_thread"), game_thread_start_time);
+	writeBakeReport();
 }
-
-void ABuilder::ProcessCoords(double ref_x, double ref_y)
+UBuildingBuildTask* ABuilder::CreateMeshAsync()
 {
-	FVector ref_point = Lonlat2Mercator(ref_x, ref_y);
-	for (auto it_player = m_building_layer_data.begin(); it_player != m_building_layer_data.end(); ++it_player)
+	if (build_task != nullptr && build_task->IsRunning())
+	{
+		UE_LOG(LogClass, Warning, TEXT("mesh build is already running"));
+		return build_task;
+	}
+	build_task = NewObject<UBuildingBuildTask>(this);
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>("ImageWrapper");
+	m_game_thread_tasks.Empty();
+	m_enqueued_tasks.Reset();
+	m_finished_tasks.Reset();
+	m_background_done = false;
+	m_build_succeeded = false;
+
+	//ں̨̣߳UObject뱣TickBuildTaskϷ̷ִ߳
+	m_build_future = Async(EAsyncExecution::Thread, [this]()
 	{
-		TArray <FBuildingInfo>& building_data = it_player->Value;
-		for (FBuildingInfo& build : building_data)
+		setBuildProgress(TEXT("parse"), 0.0f);
+		bool succeeded = ParseJson();
+		if (succeeded && !isBuildCancelled())
 		{
-			int count = build.coords.Num();
-			for (int i = 0; i < count; i++)
-			{
-				build.coords[i] = Lonlat2Mercator(build.coords[i].X, build.coords[i].Y);
-				build.coords[i] -= ref_point;
-			}
+			GenerateMesh();
 		}
-	}
-}
-FVector ABuilder::Lonlat2Mercator(double lon, double lat, double height)
-{
-	const double earthRad = 6378137.0;
-
-	FVector mercator;
-	double radius = earthRad + height;
-	mercator.Y = lon * PI / 180 * radius;
-	float alpha = lat * PI / 180;
-	mercator.X = radius / 2 * log((1.0 + sin(alpha)) / (1.0 - sin(alpha)));
-
-	return mercator;
+		m_build_succeeded = succeeded && !isBuildCancelled();
+		m_background_done = true;
+	});
+	m_build_ticker = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ABuilder::TickBuildTask));
+	return build_task;
 }
-
-void ABuilder::CreateWallMesh()
+bool ABuilder::TickBuildTask(float DeltaTime)
 {
-	if (m_use_pmc)
+	//ȶȡ̨ɱ־֤˺Ŷӵѿɼ
+	bool background_done = m_background_done;
+	bool drained = runGameThreadTasks(m_game_thread_budget);
+	if (background_done)
 	{
-		CreateWallMesh_PMCImp();
+		int32 enqueued = m_enqueued_tasks.GetValue();
+		float save_progress = enqueued > 0 ? (float)m_finished_tasks.GetValue() / enqueued : 1.0f;
+		build_task->SetProgress(TEXT("save"), 0.5f + 0.5f * save_progress);
 	}
-	else
+	if (background_done && drained)
 	{
-		CreateWallMesh_RawMeshImp();
+		m_build_future.Wait();
+		m_build_ticker.Reset();
+		if (m_build_succeeded && !isBuildCancelled())
+		{
+			writeBakeReport();
+		}
+		build_task->Finish(m_build_succeeded && !isBuildCancelled());
+		return false;
 	}
+	build_task->BroadcastProgress();
+	return true;
 }
-
-void ABuilder::CreateWallMesh_PMCImp()
+void ABuilder::BeginDestroy()
 {
-	for (auto it_layer_data = m_building_layer_data.begin(); it_layer_data != m_building_layer_data.end(); ++it_layer_data)
+	//̨̳߳thisǰȡȴ
+	if (build_task != nullptr && build_task->IsRunning())
 	{
-		int32 layer_id = it_layer_data->Key;
-		TArray<FBuildingInfo> building_data = it_layer_data->Value;
-		TArray<FVector> Verties;
-		TArray<int32> Index;
-		TArray<FVector> Normals;
-		TArray<FVector2D> UV;
-		TArray<FColor> VertexColors;
-		TArray<FProcMeshTangent> Tangents;
-
-		FVector ZUp(0.0, 0.0, 1.0);
-		for (FBuildingInfo build : building_data)
-		{
-			double height = build.height;
-			int count = build.coords.Num();
-			for (int i = 0; i < count; i++)
-			{
-				//
-				int delta = Verties.Num();
-				FVector cur_coord = build.coords[i];
-				int32 next_index = i + 1 == count ? 0 : i + 1;
-				FVector next_coord = build.coords[next_index];
-				Verties.Add(FVector(cur_coord.X, cur_coord.Y, 0));
-				Verties.Add(FVector(cur_coord.X, cur_coord.Y, height));
-				Verties.Add(FVector(next_coord.X, next_coord.Y, 0));
-				Verties.Add(FVector(next_coord.X, next_coord.Y, height));
-
-				//ɫ
-				VertexColors.Add(FColor(1.0f, 1.0f, 1.0f, 1.0f));
-				VertexColors.Add(FColor(1.0f, 1.0f, 1.0f, 1.0f));
-				VertexColors.Add(FColor(1.0f, 1.0f, 1.0f, 1.0f));
-				VertexColors.Add(FColor(1.0f, 1.0f, 1.0f, 1.0f));
-
-				//
-				FVector Forward = next_coord - cur_coord;
-				FVector normal = FVector::CrossProduct(ZUp, Forward);
-				Normals.Add(normal);
-				Normals.Add(normal);
-				Normals.Add(normal);
-				Normals.Add(normal);
-
-				//
-				UV.Add(FVector2D(0.0f, 0.0f));
-				UV.Add(FVector2D(0.0f, 1.0f));
-				UV.Add(FVector2D(1.0f, 0.0f));
-				UV.Add(FVector2D(1.0f, 1.0f));
-
-				//			
-				int index0 = 0 + delta;
-				int index1 = 1 + delta;
-				int index2 = 2 + delta;
-				int index3 = 3 + delta;
-				Index.Add(index0);
-				Index.Add(index1);
-				Index.Add(index2);
-				Index.Add(index1);
-				Index.Add(index3);
-				Index.Add(index2);
-			}
-		}
-
-		Tangents.Init(FProcMeshTangent(1.0f, 0.0f, 0.0f), Verties.Num());
-		wall_pmc->CreateMeshSection(1, Verties, Index, Normals, UV, UV, UV, UV, VertexColors, Tangents, true);
-		wall_pmc->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-
-		FString image_name = "2.png";
-		UTexture2D* texture = nullptr;
-		int32 width, height;
-		if (LoadImageToTexture2D(image_name, texture, width, height))
-		{
-			UMaterialInterface* Material = CreateMaterial(texture, "wall_material", 0.7, 0.4);
-			wall_pmc->SetMaterial(1, Material);
-		}
+		build_task->Cancel();
+		m_build_future.Wait();
+		FTicker::GetCoreTicker().RemoveTicker(m_build_ticker);
+		m_game_thread_tasks.Empty();
 	}
+	Super::BeginDestroy();
 }
-void ABuilder::CreateWallMesh_RawMeshImp()
+bool ABuilder::PickBuilding(const FVector& location, FBuildingQueryHit& hit) const
 {
-	const int32 m_wall_center_random_count = 5;
-	FRawMesh TotalRawMesh;
-	FRawMesh TopRawMesh;
-	FRawMesh BottomRawMesh;
-	FRawMesh CenterRawMeshs[m_wall_center_random_count];
-	for (auto it_layer_data = m_building_layer_data.begin(); it_layer_data != m_building_layer_data.end(); ++it_layer_data)
+	FBuildingHit building_hit;
+	if (!isBuildingIndexReady() || !m_building_index.PickPoint(getProjectedLocation(location), building_hit))
 	{
-		int32 layer_id = it_layer_data->Key;
-		TArray<FBuildingInfo> building_data = it_layer_data->Value;
-		int32 building_index = 0;
-		
-		for (FBuildingInfo build : building_data)
-		{
-		    building_index++;
-			if (building_index == m_wall_center_random_count)
-			{
-				building_index = 0;
-			}
-			FRawMesh& CenterRawMesh = CenterRawMeshs[building_index];
-			double height = build.height;
-			int count = build.coords.Num();
-			for (int i = 0; i < count; i++)
-			{
-				FVector cur_coord = build.coords[i];
-				int32 next_index = i + 1 == count ? 0 : i + 1;
-				FVector next_coord = build.coords[next_index];
-				divideRect_RawMeshImp(cur_coord,next_coord,0,height,TotalRawMesh);
-				divideRect_RawMeshImp(cur_coord, next_coord, height - m_wall_top_dis, height, TopRawMesh);
-				divideRect_RawMeshImp(cur_coord, next_coord, m_wall_bottom_dis, height - m_wall_top_dis, CenterRawMesh);
-				divideRect_RawMeshImp(cur_coord, next_coord, 0, m_wall_bottom_dis, BottomRawMesh);
-			}
-		}
+		return false;
 	}
-
-	SaveStaticMeshWithRawMesh("total_wall_mesh","total_wall_material", TotalRawMesh);
-	SaveStaticMeshWithRawMesh("top_wall_mesh","top_wall_material", TopRawMesh);
-	for (int i = 0; i < m_wall_center_random_count; i++)
+	TArray<FBuildingQueryHit> query_hits;
+	getQueryHits(MakeArrayView(&building_hit, 1), query_hits);
+	hit = query_hits[0];
+	return true;
+}
+TArray<FBuildingQueryHit> ABuilder::QueryBuildingsInBox(const FVector& min, const FVector& max) const
+{
+	TArray<FBuildingQueryHit> query_hits;
+	if (isBuildingIndexReady())
 	{
-		SaveStaticMeshWithRawMesh("center_wall_mesh" + FString::FromInt(i),"ceter_wall_material"+FString::FromInt(i), CenterRawMeshs[i]);
+		FBox2D box(ForceInit);
+		box += getProjectedLocation(min);
+		box += getProjectedLocation(max);
+		TArray<FBuildingHit> hits;
+		m_building_index.QueryBox(box, hits);
+		getQueryHits(hits, query_hits);
 	}
-	SaveStaticMeshWithRawMesh("bottom_wall_mesh","bottom_wall_material", BottomRawMesh);
+	return query_hits;
 }
-void ABuilder::divideRect_RawMeshImp(FVector cur_coord, FVector next_coord, double bottom,double top, FRawMesh& RawMesh )
+TArray<FBuildingQueryHit> ABuilder::QueryBuildingsInRadius(const FVector& center, float radius) const
 {
-	int delta = RawMesh.VertexPositions.Num();
-	RawMesh.VertexPositions.Add(FVector(cur_coord.X, cur_coord.Y, bottom));
-	RawMesh.VertexPositions.Add(FVector(cur_coord.X, cur_coord.Y, top));
-	RawMesh.VertexPositions.Add(FVector(next_coord.X, next_coord.Y, bottom));
-	RawMesh.VertexPositions.Add(FVector(next_coord.X, next_coord.Y, top));
-
-	int index0 = 0 + delta;
-	int index1 = 1 + delta;
-	int index2 = 2 + delta;
-	int index3 = 3 + delta;
-	RawMesh.WedgeIndices.Add(index0);
-	RawMesh.WedgeIndices.Add(index1);
-	RawMesh.WedgeIndices.Add(index2);
-	RawMesh.WedgeIndices.Add(index1);
-	RawMesh.WedgeIndices.Add(index3);
-	RawMesh.WedgeIndices.Add(index2);
-
-	RawMesh.WedgeTexCoords->Add(FVector2D(0.0f, 0.0f));
-	RawMesh.WedgeTexCoords->Add(FVector2D(0.0f, 1.0f));
-	RawMesh.WedgeTexCoords->Add(FVector2D(1.0f, 0.0f));
-	RawMesh.WedgeTexCoords->Add(FVector2D(0.0f, 1.0f));
-	RawMesh.WedgeTexCoords->Add(FVector2D(1.0f, 1.0f));
-	RawMesh.WedgeTexCoords->Add(FVector2D(1.0f, 0.0f));
-
-	for (int face = 0; face < 2; face++)
+	TArray<FBuildingQueryHit> query_hits;
+	if (isBuildingIndexReady())
 	{
-		RawMesh.FaceMaterialIndices.Add(0);
-		RawMesh.FaceSmoothingMasks.Add(0);
-		for (int corner = 0; corner < 3; corner++)
-		{
-			RawMesh.WedgeTangentX.Add(FVector(1, 0, 0));
-			RawMesh.WedgeTangentY.Add(FVector(0, 1, 0));
-			RawMesh.WedgeTangentZ.Add(FVector(0, 0, 1));
-
-			RawMesh.WedgeColors.Add(FColor(1.0f, 1.0f, 1.0f, 1.0f));
-		}
+		TArray<FBuildingHit> hits;
+		m_building_index.QueryRadius(getProjectedLocation(center), radius, hits);
+		getQueryHits(hits, query_hits);
 	}
+	return query_hits;
 }
-
-void ABuilder::CreateRoofMesh()
+TArray<FBuildingQueryHit> ABuilder::QueryNearestBuildings(const FVector& location, int32 count) const
 {
-	if (m_use_pmc)
+	TArray<FBuildingQueryHit> query_hits;
+	if (isBuildingIndexReady())
 	{
-		CreateRoofMesh_PMCImp();
+		TArray<FBuildingHit> hits;
+		m_building_index.QueryNearest(getProjectedLocation(location), count, hits);
+		getQueryHits(hits, query_hits);
 	}
-	else
+	return query_hits;
+}
+bool ABuilder::isBuildingIndexReady() const
+{
+	//첽ʱ̨̻߳ؽͼ
+	return build_task == nullptr || !build_task->IsRunning();
+}
+FVector2D ABuilder::getProjectedLocation(const FVector& location) const
+{
+	return FVector2D(GetActorTransform().InverseTransformPosition(location));
+}
+void ABuilder::getQueryHits(TArrayView<const FBuildingHit> hits, TArray<FBuildingQueryHit>& query_hits) const
+{
+	query_hits.Reset(hits.Num());
+	for (const FBuildingHit& hit : hits)
 	{
-		CreateRoofMesh_RawMeshImp();
+		FBuildingQueryHit& query_hit = query_hits.AddDefaulted_GetRef();
+		query_hit.layer_id = hit.layer_id;
+		query_hit.index = hit.index;
+		query_hit.code = m_building_layer_data[hit.layer_id].GetCode(hit.index);
+		query_hit.distance = hit.distance;
 	}
 }
-void ABuilder::CreateRoofMesh_PMCImp()
+void ABuilder::enqueueGameThreadTask(TUniqueFunction<void()>&& task)
 {
-	for (auto it_layer_data = m_building_layer_data.begin(); it_layer_data != m_building_layer_data.end(); ++it_layer_data)
+	m_enqueued_tasks.Increment();
+	m_game_thread_tasks.Enqueue(MoveTemp(task));
+}
+bool ABuilder::runGameThreadTasks(double budget)
+{
+	double start_time = FPlatformTime::Seconds();
+	TUniqueFunction<void()> task;
+	while (m_game_thread_tasks.Dequeue(task))
 	{
-		int32 layer_id = it_layer_data->Key;
-		TArray<FBuildingInfo> building_data = it_layer_data->Value;
-		TArray<FVector> Vertes;
-		TArray<int32> Index;
-		TArray<FVector> Normals;
-		TArray<FVector2D> UV;
-		TArray<FColor> VertexColors;
-		TArray<FProcMeshTangent> Tangents;
-		for (FBuildingInfo build : building_data)
+		//ȡʣؽ治ᱣ
+		if (!isBuildCancelled())
 		{
-			double height = build.height;
-			TArray<FVector> polygon = build.coords;
-
-			if (isConvexPolygon(polygon))
-			{
-				divideConvexPolygon_PMCImp(polygon, height, Vertes, Index, UV);
-			}
-			else
-			{
-				divideConcavePolygon_PMCImp(polygon, height, Vertes, Index, UV);
-			}
-
+			task();
 		}
-		VertexColors.Init(FColor(1.0f, 1.0f, 1.0f, 0.5f), Vertes.Num());
-		Normals.Init(FVector(0.0, 0.0f, 1.0), Vertes.Num());
-		Tangents.Init(FProcMeshTangent(1.0f, 0.0f, 0.0f), Vertes.Num());
-		roof_pmc->CreateMeshSection(0, Vertes, Index, Normals, UV, UV, UV, UV, VertexColors, Tangents, true);
-		roof_pmc->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-
-		FString image_name = "1.png";
-		UTexture2D* texture = nullptr;
-		int32 width, height;
-		if (LoadImageToTexture2D(image_name, texture, width, height))
+		m_finished_tasks.Increment();
+		if (budget > 0.0 && FPlatformTime::Seconds() - start_time >= budget)
 		{
-			UMaterialInterface* Material = CreateMaterial(texture, "roof_material", 0.7, 0.4);
-			roof_pmc->SetMaterial(0, Material);
+			return m_game_thread_tasks.IsEmpty();
 		}
 	}
+	return true;
 }
-void ABuilder::CreateRoofMesh_RawMeshImp()
+bool ABuilder::isBuildCancelled() const
 {
-	FRawMesh RawMesh;
-	for (auto it_layer_data = m_building_layer_data.begin(); it_layer_data != m_building_layer_data.end(); ++it_layer_data)
+	return build_task != nullptr && build_task->IsRunning() && build_task->IsCancelled();
+}
+void ABuilder::setBuildProgress(const TCHAR* stage, float progress)
+{
+	//̨ռܽȵǰһ
+	if (build_task != nullptr && build_task->IsRunning())
 	{
-		int32 layer_id = it_layer_data->Key;
-		TArray<FBuildingInfo> building_data = it_layer_data->Value;
-		for (FBuildingInfo build : building_data)
-		{
-			double height = build.height;
-			TArray<FVector> polygon = build.coords;
-			if (isConvexPolygon(polygon))
-			{
-				divideConvexPolygon_RawMeshImp(polygon, height, RawMesh);
-			}
-			else
-			{
-				divideConcavePolygon_RawMeshImp(polygon, height, RawMesh);
-			}
-		}
+		build_task->SetProgress(stage, 0.5f * progress);
 	}
-
-	SaveStaticMeshWithRawMesh("roof_mesh","roof_material",RawMesh);
 }
-void ABuilder::divideConvexPolygon_PMCImp(TArray<FVector> polygon, double height, TArray<FVector>& Vertex, TArray<int32>& Index, TArray<FVector2D>& UV)
+void ABuilder::GenerateMesh()
 {
-	int32 count = polygon.Num();
-	int delta = Vertex.Num();
-	FVector2D min(FLT_MAX, FLT_MAX);
-	FVector2D max(FLT_MIN, FLT_MIN);
-	for (int i = 0; i < count; i++)
-	{
-		min.X = polygon[i].X < min.X ? polygon[i].X : min.X;
-		min.Y = polygon[i].Y < min.Y ? polygon[i].Y : min.Y;
-		max.X = polygon[i].X > max.X ? polygon[i].X : max.X;
-		max.Y = polygon[i].Y > max.Y ? polygon[i].Y : max.Y;
+	//116.3,40.0--beijing
+	//114.3,30.6---
+	setBuildProgress(TEXT("project"), 0.1f);
+	FBuildingScratchArena::ResetStats();
+	m_bake_report = FBuildingBakeReport();
+	double project_start_time = FPlatformTime::Seconds();
+	ProcessCoords(114.3, 30.6);
+	addStageTime(TEXT("project"), project_start_time);
 
-		polygon[i].Z = height;
-		Vertex.Add(polygon[i]);
-	}
-	float uv_width = max.X - min.X;
-	float uv_height = max.Y - min.Y;
+	double index_start_time = FPlatformTime::Seconds();
+	m_building_index.Build(m_building_layer_data);
+	UE_LOG(LogClass, Log, TEXT("index %d buildings: %.1f MB, %.3f s"), m_building_index.Num(),
+		m_building_index.GetAllocatedSize() / (1024.0 * 1024.0), FPlatformTime::Seconds() - index_start_time);
+	addStageTime(TEXT("index"), index_start_time);
+	FTransform transform;
 
-	for (int i = 0; i < count; i++)
+	int32 building_count = 0;
+	for (auto it_layer_data = m_building_layer_data.begin(); it_layer_data != m_building_layer_data.end(); ++it_layer_data)
 	{
-		float u = (polygon[i].X - min.X) / uv_width;
-		float v = (polygon[i].Y - min.Y) / uv_height;
-		UV.Add(FVector2D(u, v));
+		building_count += it_layer_data->Value.Num();
+		m_bake_report.vertices += it_layer_data->Value.NumCoords();
 	}
+	m_bake_report.buildings = building_count;
+	TSet<uint64> roof_ring_hashes;
+	m_stale_mesh_names.Reset();
 
-
-	for (int i = 0; i < count - 2; i++)
+	//RawMeshռֿÿÿֶһ
+	if (!m_use_pmc)
 	{
-		int index0 = 0 + delta;
-		int index1 = 1 + i + delta;
-		int index2 = 2 + i + delta;
-		Index.Add(index0);
-		Index.Add(index2);
-		Index.Add(index1);
+		setBuildProgress(TEXT("tile"), 0.2f);
+		//ظĽֻһԭ񣬲ֿ
+		double instance_start_time = FPlatformTime::Seconds();
+		m_prototype_data.Empty();
+		m_prototype_instances.Empty();
+		if (m_use_instancing)
+		{
+			FindBuildingPrototypes(m_building_layer_data, m_instance_quantize, m_instance_min_count, m_prototype_data, m_prototype_instances);
+		}
+		int32 prototype_count = 0;
+		int32 instance_count = 0;
+		for (auto it = m_prototype_instances.begin(); it != m_prototype_instances.end(); ++it)
+		{
+			prototype_count += it->Value.Num();
+			for (const FBuildingInstances& instances : it->Value)
+			{
+				instance_count += instances.building_indices.Num();
+			}
+		}
+		UE_LOG(LogClass, Log, TEXT("instancing: %d buildings share %d prototypes, %.3f s"), instance_count, prototype_count, FPlatformTime::Seconds() - instance_start_time);
+		addStageTime(TEXT("instancing"), instance_start_time);
+
+		FBuildingTileBudget budget;
+		budget.max_vertices = m_tile_max_vertices;
+		budget.max_triangles = m_tile_max_triangles;
+		budget.max_depth = m_tile_max_depth;
+		double tile_start_time = FPlatformTime::Seconds();
+		MakeBuildingTiles(m_building_layer_data, m_prototype_instances, budget, m_building_tiles);
+		UE_LOG(LogClass, Log, TEXT("split %d buildings into %d tiles"), building_count - instance_count, m_building_tiles.Num());
+		MakePrototypeTiles(m_prototype_data, m_prototype_instances, m_building_tiles);
+		addStageTime(TEXT("tiles"), tile_start_time);
+
+		double lod_start_time = FPlatformTime::Seconds();
+		TMap<int32, float> layer_tolerances;
+		for (auto it = m_building_layer_info.begin(); it != m_building_layer_info.end(); ++it)
+		{
+			layer_tolerances.Add(it->Key, it->Value.simplify_tolerance);
+		}
+		FBuildingLodSettings lod_settings;
+		lod_settings.tolerance_scales = m_lod_tolerance_scales;
+		lod_settings.proxy_size = m_lod_proxy_size;
+		MakeLodBuildings(m_building_layer_data, layer_tolerances, lod_settings, m_lod_building_data);
+		MakeLodBuildings(m_prototype_data, layer_tolerances, lod_settings, m_lod_prototype_data);
+		UE_LOG(LogClass, Log, TEXT("simplify %d lods: %.3f s"), m_lod_building_data.Num(), FPlatformTime::Seconds() - lod_start_time);
+		addStageTime(TEXT("lod"), lod_start_time);
+
+		//ؽݹϣϴαʱһµķֿѱ
+		double hash_start_time = FPlatformTime::Seconds();
+		if (m_use_rebuild_cache)
+		{
+			m_rebuild_cache.Load(FBuildingRebuildCache::GetCacheFileName(m_package_root));
+		}
+		getTileHashes(m_tile_hashes, roof_ring_hashes);
+		UE_LOG(LogClass, Log, TEXT("hash %d tiles: %.3f s"), m_tile_hashes.Num(), FPlatformTime::Seconds() - hash_start_time);
+		addStageTime(TEXT("hash"), hash_start_time);
 	}
-}
-void ABuilder::divideConvexPolygon_RawMeshImp(TArray<FVector> polygon, double height, FRawMesh& RawMesh)
-{
-	int32 count = polygon.Num();
-	int delta = RawMesh.VertexPositions.Num();
-	FVector2D min(FLT_MAX, FLT_MAX);
-	FVector2D max(FLT_MIN, FLT_MIN);
-	for (int i = 0; i < count; i++)
-	{
-		min.X = polygon[i].X < min.X ? polygon[i].X : min.X;
-		min.Y = polygon[i].Y < min.Y ? polygon[i].Y : min.Y;
-		max.X = polygon[i].X > max.X ? polygon[i].X : max.X;
-		max.Y = polygon[i].Y > max.Y ? polygon[i].Y : max.Y;
 
-		polygon[i].Z = height;
-		RawMesh.VertexPositions.Add(polygon[i]);
+	if (isBuildCancelled())
+	{
+		return;
 	}
 
-	float uv_width = max.X - min.X;
-	float uv_height = max.Y - min.Y;
-
-	for (int i = 0; i < count - 2; i++)
+	//ͳеĶѷ
+	FScopedAllocationCounter allocation_counter;
+	enqueueGameThreadTask([this]()
 	{
-		int index0 = 0 + delta;
-		int index1 = 1 + i + delta;
-		int index2 = 2 + i + delta;
-		RawMesh.WedgeIndices.Add(index0);
-		RawMesh.WedgeIndices.Add(index2);
-		RawMesh.WedgeIndices.Add(index1);
-
-
-		float u0 = (polygon[i].X - min.X) / uv_width;
-		float v0 = (polygon[i].Y - min.Y) / uv_height;
-		RawMesh.WedgeTexCoords->Add(FVector2D(u0, v0));
-		float u2 = (polygon[i + 2].X - min.X) / uv_width;
-		float v2 = (polygon[i + 2].Y - min.Y) / uv_height;
-		RawMesh.WedgeTexCoords->Add(FVector2D(u2, v2));
-		float u1 = (polygon[i + 1].X - min.X) / uv_width;
-		float v1 = (polygon[i + 1].Y - min.Y) / uv_height;
-		RawMesh.WedgeTexCoords->Add(FVector2D(u1, v1));
-
-
-		RawMesh.FaceMaterialIndices.Add(0);
-		RawMesh.FaceSmoothingMasks.Add(0);
-		for (int corner = 0; corner < 3; corner++)
+		for (UHierarchicalInstancedStaticMeshComponent* instance_component : instance_components)
 		{
-			RawMesh.WedgeTangentX.Add(FVector(1, 0, 0));
-			RawMesh.WedgeTangentY.Add(FVector(0, 1, 0));
-			RawMesh.WedgeTangentZ.Add(FVector(0, 0, 1));
-
-			RawMesh.WedgeColors.Add(FColor(1.0f, 1.0f, 1.0f, 1.0f));
+			instance_component->DestroyComponent();
 		}
-	
-	}
-}
-void ABuilder::divideConcavePolygon_PMCImp(TArray<FVector> polygon, double height, TArray<FVector>& Vertex, TArray<int32>& Index, TArray<FVector2D>& UV)
-{
-	int32 count = polygon.Num();
-	FVector2D min(FLT_MAX, FLT_MAX);
-	FVector2D max(FLT_MIN, FLT_MIN);
-	for (int i = 0; i < count; i++)
+		instance_components.Empty();
+		m_instance_saved_vertices = 0;
+		m_instance_saved_bytes = 0;
+		dirty_packages.Empty();
+		m_duplicate_package_saves = 0;
+	});
+	//õͼڹ߳ϲн룬Ϸֻ߳Դ
+	TArray<FString> image_paths;
+	getMeshImagePaths(image_paths);
+	double decode_start_time = FPlatformTime::Seconds();
+	m_decoded_images.Reset();
+	DecodeImages(image_paths, m_decoded_images);
+	addStageTime(TEXT("decode_images"), decode_start_time);
+
+	double mesh_start_time = FPlatformTime::Seconds();
+	setBuildProgress(TEXT("wall"), 0.4f);
+	CreateWallMesh();
+	addStageTime(TEXT("wall"), mesh_start_time);
+	setBuildProgress(TEXT("roof"), 0.7f);
+	double roof_start_time = FPlatformTime::Seconds();
+	CreateRoofMesh();
+	addStageTime(TEXT("roof"), roof_start_time);
+	if (isBuildCancelled())
 	{
-		min.X = polygon[i].X < min.X ? polygon[i].X : min.X;
-		min.Y = polygon[i].Y < min.Y ? polygon[i].Y : min.Y;
-		max.X = polygon[i].X > max.X ? polygon[i].X : max.X;
-		max.Y = polygon[i].Y > max.Y ? polygon[i].Y : max.Y;
-
-		polygon[i].Z = height;
+		return;
 	}
-	float uv_width = max.X - min.X;
-	float uv_height = max.Y - min.Y;
-
-	int32 delta = 0;
-	int32 index = 0;
-	while (count > 3)
+	setBuildProgress(TEXT("save"), 1.0f);
+	uint64 allocations = allocation_counter.GetAllocations();
+	UE_LOG(LogClass, Log, TEXT("create mesh: %d buildings, %.3f s, %llu allocations (%.1f per building), %.1f MB allocated"),
+		building_count, FPlatformTime::Seconds() - mesh_start_time, allocations, building_count > 0 ? (double)allocations / building_count : 0.0,
+		allocation_counter.GetAllocatedBytes() / (1024.0 * 1024.0));
+	//ʱݴ߳ݴ䣬ѷֻݴʱ
+	FBuildingScratchStats scratch_stats = FBuildingScratchArena::GetStats();
+	UE_LOG(LogClass, Log, TEXT("scratch: %llu allocations in %llu scopes, %.1f MB, %d threads, peak %.1f KB, %llu heap blocks in %.3f ms"),
+		scratch_stats.allocations, scratch_stats.scopes, scratch_stats.bytes / (1024.0 * 1024.0), scratch_stats.threads,
+		scratch_stats.peak_bytes / 1024.0, scratch_stats.heap_blocks, FPlatformTime::ToMilliseconds64(scratch_stats.heap_cycles));
+
+	//񴴽ɺŶӱɺдؽ棬ֻõǻֿ¼
+	//Ą̊́߳Ŷӵһ񣬱֮
+	enqueueGameThreadTask([this, roof_ring_hashes = MoveTemp(roof_ring_hashes), stale_mesh_names = MoveTemp(m_stale_mesh_names)]() mutable
 	{
-		if (isSurplusPoint(polygon, index))//ȥߵ
+		m_decoded_images.Empty();
+		enqueueSaveDirtyPackages([this, roof_ring_hashes = MoveTemp(roof_ring_hashes), stale_mesh_names = MoveTemp(stale_mesh_names)](bool packages_saved) mutable
 		{
-			polygon.RemoveAt(index);
-			count = polygon.Num();
-			index = 0;
-		}
-		else if (isDivisiblePoint(polygon, index))
-		{
-			int pre_index = index == 0 ? count - 1 : index - 1;
-			int next_index = index + 1 == count ? 0 : index + 1;
-
-			delta = Vertex.Num();
-			Vertex.Add(polygon[pre_index]);
-			Vertex.Add(polygon[index]);
-			Vertex.Add(polygon[next_index]);
-
-			Index.Add(0 + delta);
-			Index.Add(2 + delta);
-			Index.Add(1 + delta);
+			if (instance_components.Num() > 0)
+			{
+				UE_LOG(LogClass, Log, TEXT("instancing: %d instanced meshes, %lld vertices saved, %.1f MB vertex data saved"),
+					instance_components.Num(), m_instance_saved_vertices, m_instance_saved_bytes / (1024.0 * 1024.0));
+			}
+			//񱣴ʧʱ»桢ɾ´
+			if (!m_use_pmc && packages_saved)
+			{
+				if (m_use_rebuild_cache)
+				{
+					TSet<FString> mesh_names;
+					for (const FBuildingTile& tile : m_building_tiles)
+					{
+						mesh_names.Add("wall_" + tile.name);
+						mesh_names.Add("roof_" + tile.name);
+					}
+					m_rebuild_cache.KeepTriangles(roof_ring_hashes);
+					//ֿ鲼ֱ仯ٴڵĿ飬ֶݶʧЧ
+					TArray<FString> removed_names;
+					m_rebuild_cache.KeepMeshes(mesh_names, removed_names);
+					for (const FString& removed_name : removed_names)
+					{
+						getCachedMeshPackages(removed_name, stale_mesh_names);
+					}
+					FString cache_file = FBuildingRebuildCache::GetCacheFileName(m_package_root);
+					if (!m_rebuild_cache.Save(cache_file))
+					{
+						UE_LOG(LogClass, Warning, TEXT("save rebuild cache failed: %s"), *cache_file);
+					}
+				}
+				deleteMeshPackages(stale_mesh_names);
+			}
+		});
+	});
+}
 
+void ABuilder::ProcessCoords(double ref_x, double ref_y)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BuildingProjection);
+	double ref_north, ref_east;
+	LonLatToMercator(ref_x, ref_y, ref_north, ref_east);
 
-			float pre_u = (polygon[pre_index].X - min.X) / uv_width;
-			float pre_v = (polygon[pre_index].Y - min.Y) / uv_height;
-			UV.Add(FVector2D(pre_u, pre_v));
-			float next_u = (polygon[next_index].X - min.X) / uv_width;
-			float next_v = (polygon[next_index].Y - min.Y) / uv_height;
-			UV.Add(FVector2D(next_u, next_v));
-			float cur_u = (polygon[index].X - min.X) / uv_width;
-			float cur_v = (polygon[index].Y - min.Y) / uv_height;
-			UV.Add(FVector2D(cur_u, cur_v));
+	for (auto it_layer_data = m_building_layer_data.begin(); it_layer_data != m_building_layer_data.end(); ++it_layer_data)
+	{
+		ProjectBuildingLayer(it_layer_data->Value, ref_north, ref_east);
+	}
+}
+FVector ABuilder::Lonlat2Mercator(double lon, double lat, double height)
+{
+	const double earthRad = 6378137.0;
 
+	FVector mercator;
+	double radius = earthRad + height;
+	mercator.Y = lon * PI / 180 * radius;
+	double alpha = lat * PI / 180;
+	mercator.X = radius / 2 * log((1.0 + sin(alpha)) / (1.0 - sin(alpha)));
+	mercator.Z = 0.0f;
 
-			polygon.RemoveAt(index);
-			count = polygon.Num();
-			index = 0;
-		}
-		else
-		{
-			index++;
-		}
-	}
+	return mercator;
+}
 
-	delta = Vertex.Num();
-	Vertex.Add(polygon[0]);
-	Vertex.Add(polygon[2]);
-	Vertex.Add(polygon[1]);
+void ABuilder::CreateWallMesh()
+{
+	if (m_use_pmc)
+	{
+		CreateWallMesh_PMCImp();
+	}
+	else
+	{
+		CreateWallMesh_RawMeshImp();
+	}
+}
 
+//ֶε
+static FString GetWallBandMeshName(const FWallBand& band, int32 variant)
+{
+	return band.variant_count > 1 ? band.mesh_name + FString::FromInt(variant) : band.mesh_name;
+}
 
-	float pre_u = (polygon[0].X - min.X) / uv_width;
-	float pre_v = (polygon[0].Y - min.Y) / uv_height;
-	UV.Add(FVector2D(pre_u, pre_v));
-	float next_u = (polygon[2].X - min.X) / uv_width;
-	float next_v = (polygon[2].Y - min.Y) / uv_height;
-	UV.Add(FVector2D(next_u, next_v));
-	float cur_u = (polygon[1].X - min.X) / uv_width;
-	float cur_v = (polygon[1].Y - min.Y) / uv_height;
-	UV.Add(FVector2D(cur_u, cur_v));
+//㷨仯ʱʹ֮ǰȫʧЧ
+const uint32 mesh_generator_version = 3;
 
+//ֽۼӵùϣ
+template<typename ValueType>
+static uint64 HashBuildValue(const ValueType& value, uint64 hash)
+{
+	return CityHash64WithSeed((const char*)&value, sizeof(ValueType), hash);
+}
 
-	Index.Add(0 + delta);
-	Index.Add(2 + delta);
-	Index.Add(1 + delta);
+//ɵļдʱڴֵͬʱۼӵ決
+static void LogMeshEmission(const TCHAR* mesh_name, const FMeshSize& size, double start_time, double count_time, uint64 start_memory, FBuildingEmissionStats& stats)
+{
+	uint64 peak_memory = FMath::Max(start_memory, FPlatformMemory::GetStats().UsedPhysical);
+	double write_seconds = FPlatformTime::Seconds() - count_time;
+	UE_LOG(LogClass, Log, TEXT("emit %s: %d vertices, %d triangles, count %.3f s, write %.3f s, peak memory +%.1f MB"),
+		mesh_name, size.vertices, size.indices / 3, count_time - start_time, write_seconds,
+		(peak_memory - start_memory) / (1024.0 * 1024.0));
+	stats.vertices += size.vertices;
+	stats.triangles += size.indices / 3;
+	stats.count_seconds += count_time - start_time;
+	stats.write_seconds += write_seconds;
+	stats.peak_memory = FMath::Max(stats.peak_memory, peak_memory - start_memory);
 }
-void ABuilder::divideConcavePolygon_RawMeshImp(TArray<FVector> polygon, double height, FRawMesh& RawMesh)
+
+//񶥵ƽƵoriginΪԭľֲ
+static void OffsetRawMesh(FRawMesh& RawMesh, const FVector& origin)
 {
-	int32 count = polygon.Num();
-	FVector2D min(FLT_MAX, FLT_MAX);
-	FVector2D max(FLT_MIN, FLT_MIN);
-	for (int i = 0; i < count; i++)
+	for (FVector& position : RawMesh.VertexPositions)
 	{
-		min.X = polygon[i].X < min.X ? polygon[i].X : min.X;
-		min.Y = polygon[i].Y < min.Y ? polygon[i].Y : min.Y;
-		max.X = polygon[i].X > max.X ? polygon[i].X : max.X;
-		max.Y = polygon[i].Y > max.Y ? polygon[i].Y : max.Y;
-
-		polygon[i].Z = height;
+		position -= origin;
 	}
-	float uv_width = max.X - min.X;
-	float uv_height = max.Y - min.Y;
+}
 
-	int32 delta = 0;
-	int32 index = 0;
-	while (count > 3)
+void ABuilder::CreateWallMesh_PMCImp()
+{
+	float crease_cos = getWallCreaseCos();
+	for (auto it_layer_data = m_building_layer_data.begin(); it_layer_data != m_building_layer_data.end(); ++it_layer_data)
 	{
-		if (isSurplusPoint(polygon, index))//ȥߵ
+		int32 layer_id = it_layer_data->Key;
+		const FBuildingLayer& building_data = it_layer_data->Value;
+		TArray<FBuildingChunk> chunks;
+		MakeBuildingChunks(layer_id, building_data, chunks);
+
+		double start_time = FPlatformTime::Seconds();
+		uint64 start_memory = FPlatformMemory::GetStats().UsedPhysical;
+
+		FPMCMeshChunk wall;
+		double count_time = 0.0;
+		FMeshSize total = MakeWallMesh_PMC(chunks, crease_cos, wall, count_time);
+		LogMeshEmission(TEXT("wall (pmc)"), total, start_time, count_time, start_memory, m_bake_report.wall);
+		if (m_optimize_vertex_cache)
 		{
-			polygon.RemoveAt(index);
-			count = polygon.Num();
-			index = 0;
+			OptimizePMCMesh(wall, m_bake_report.vertex_cache);
 		}
-		else if (isDivisiblePoint(polygon, index))
-		{
-			int pre_index = index == 0 ? count - 1 : index - 1;
-			int next_index = index + 1 == count ? 0 : index + 1;
 
-			delta = RawMesh.VertexPositions.Num();
-			RawMesh.VertexPositions.Add(polygon[pre_index]);
-			RawMesh.VertexPositions.Add(polygon[index]);
-			RawMesh.VertexPositions.Add(polygon[next_index]);
-
-			RawMesh.WedgeIndices.Add(0 + delta);
-			RawMesh.WedgeIndices.Add(2 + delta);
-			RawMesh.WedgeIndices.Add(1 + delta);
+		enqueueGameThreadTask([this, wall = MoveTemp(wall)]()
+		{
+			TArray<FProcMeshTangent> Tangents;
+			Tangents.Init(FProcMeshTangent(1.0f, 0.0f, 0.0f), wall.Vertices.Num());
+			wall_pmc->CreateMeshSection(1, wall.Vertices, wall.Index, wall.Normals, wall.UV, wall.UV, wall.UV, wall.UV, wall.VertexColors, Tangents, true);
+			wall_pmc->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
-			float pre_u = (polygon[pre_index].X - min.X) / uv_width;
-			float pre_v = (polygon[pre_index].Y - min.Y) / uv_height;
-			RawMesh.WedgeTexCoords->Add(FVector2D(pre_u, pre_v));
-			float next_u = (polygon[next_index].X - min.X) / uv_width;
-			float next_v = (polygon[next_index].Y - min.Y) / uv_height;
-			RawMesh.WedgeTexCoords->Add(FVector2D(next_u, next_v));
-			float cur_u = (polygon[index].X - min.X) / uv_width;
-			float cur_v = (polygon[index].Y - min.Y) / uv_height;
-			RawMesh.WedgeTexCoords->Add(FVector2D(cur_u, cur_v));
 
+			FString image_name = "2.png";
+			UTexture2D* texture = nullptr;
+			int32 width, height;
+			if (LoadImageToTexture2D(image_name, texture, width, height))
+			{
+				UMaterialInterface* Material = CreateMaterial(texture, "wall_material", 0.7, 0.4);
+				wall_pmc->SetMaterial(1, Material);
+			}
+		});
+	}
+}
+void ABuilder::CreateWallMesh_RawMeshImp()
+{
+	float crease_cos = getWallCreaseCos();
+	//ÿõķֶռvariant_count
+	TArray<int32> band_meshes;
+	int32 mesh_count = 0;
+	for (const FWallBand& band : m_wall_bands)
+	{
+		band_meshes.Add(band.enabled ? mesh_count : INDEX_NONE);
+		mesh_count += band.enabled ? band.variant_count : 0;
+	}
+	if (mesh_count == 0)
+	{
+		return;
+	}
+	//вǽȶֶΰݹϣ䣬ɾıнı
+	auto get_band_mesh = [&](int32 band_index, uint32 variant_key)
+	{
+		return band_meshes[band_index] + variant_key % m_wall_bands[band_index].variant_count;
+	};
+
+	//ÿֿ [][LOD] 
+	int32 lod_count = m_lod_building_data.Num() + 1;
+	int32 tile_count = m_building_tiles.Num();
+	TArray<TArray<FRawMesh>> tile_meshes;
+	tile_meshes.SetNum(tile_count);
+	for (TArray<FRawMesh>& meshes : tile_meshes)
+	{
+		meshes.SetNum(mesh_count * lod_count);
+	}
+	TArray<bool> tile_dirty;
+	int32 dirty_count = getDirtyTiles("wall_", tile_dirty);
+	UE_LOG(LogClass, Log, TEXT("rebuild wall: %d of %d tiles changed"), dirty_count, tile_count);
+
+	//ȡLOD0ݹϣLODͬһʹͬı
+	TArray<TArray<uint32>> tile_variant_keys;
+	tile_variant_keys.SetNum(tile_count);
+	ParallelFor(tile_count, [&](int32 tile_index)
+	{
+		if (!tile_dirty[tile_index])
+		{
+			return;
+		}
+		const FBuildingTile& tile = m_building_tiles[tile_index];
+		tile_variant_keys[tile_index].SetNumUninitialized(tile.building_indices.Num());
+		for (int32 i = 0; i < tile.building_indices.Num(); i++)
+		{
+			tile_variant_keys[tile_index][i] = (uint32)HashBuilding(getTileBuilding(tile, i, 0));
+		}
+	});
 
+	for (int32 lod = 0; lod < lod_count; lod++)
+	{
+		if (isBuildCancelled())
+		{
+			return;
+		}
+		double start_time = FPlatformTime::Seconds();
+		uint64 start_memory = FPlatformMemory::GetStats().UsedPhysical;
 
-			RawMesh.FaceMaterialIndices.Add(0);
-			RawMesh.FaceSmoothingMasks.Add(0);
-			for (int corner = 0; corner < 3; corner++)
+		//ÿֿڣÿÿҸ߶Чķֶиһ״
+		TArray<FMeshSize> tile_sizes;
+		tile_sizes.SetNum(tile_count);
+		ParallelFor(tile_count, [&](int32 tile_index)
+		{
+			if (!tile_dirty[tile_index])
 			{
-				RawMesh.WedgeTangentX.Add(FVector(1, 0, 0));
-				RawMesh.WedgeTangentY.Add(FVector(0, 1, 0));
-				RawMesh.WedgeTangentZ.Add(FVector(0, 0, 1));
+				return;
+			}
+			SCOPE_CYCLE_COUNTER(STAT_BuildingMeshCount);
+			const FBuildingTile& tile = m_building_tiles[tile_index];
+			TArray<FMeshSize> sizes;
+			sizes.SetNum(mesh_count);
+			for (int32 i = 0; i < tile.building_indices.Num(); i++)
+			{
+				FBuildingView build = getTileBuilding(tile, i, lod);
+				for (int32 band_index = 0; band_index < m_wall_bands.Num(); band_index++)
+				{
+					double bottom, top;
+					if (band_meshes[band_index] != INDEX_NONE && getWallBandRange(m_wall_bands[band_index], build.height, bottom, top))
+					{
+						CountWallStrip_RawMesh(build.coords, sizes[get_band_mesh(band_index, tile_variant_keys[tile_index][i])]);
+					}
+				}
+			}
+			for (int32 mesh_index = 0; mesh_index < mesh_count; mesh_index++)
+			{
+				AllocateRawMesh(sizes[mesh_index], tile_meshes[tile_index][mesh_index * lod_count + lod]);
+				tile_sizes[tile_index].vertices += sizes[mesh_index].vertices;
+				tile_sizes[tile_index].indices += sizes[mesh_index].indices;
+				tile_sizes[tile_index].faces += sizes[mesh_index].faces;
+			}
+		});
+		FMeshSize total = PrefixMeshSizes(tile_sizes);
+		double count_time = FPlatformTime::Seconds();
 
-				RawMesh.WedgeColors.Add(FColor(1.0f, 1.0f, 1.0f, 1.0f));
+		//д룺ÿֻһΣ۽ƽڸֶμ乲ãԷֿԭ㱣
+		ParallelFor(tile_count, [&](int32 tile_index)
+		{
+			if (!tile_dirty[tile_index])
+			{
+				return;
+			}
+			SCOPE_CYCLE_COUNTER(STAT_BuildingMeshFill);
+			const FBuildingTile& tile = m_building_tiles[tile_index];
+			TArray<FMeshSize> cursors;
+			TArray<FRawMeshView> meshes;
+			cursors.SetNum(mesh_count);
+			for (int32 mesh_index = 0; mesh_index < mesh_count; mesh_index++)
+			{
+				meshes.Add(MakeRawMeshView(tile_meshes[tile_index][mesh_index * lod_count + lod]));
+			}
+			for (int32 i = 0; i < tile.building_indices.Num(); i++)
+			{
+				FBuildingScratchMark scratch_mark;
+				FBuildingView build = getTileBuilding(tile, i, lod);
+				TBuildingScratchArray<uint32> smoothing_masks;
+				smoothing_masks.SetNumUninitialized(build.coords.Num());
+				GetWallSmoothingMasks(build.coords, crease_cos, smoothing_masks);
+				for (int32 band_index = 0; band_index < m_wall_bands.Num(); band_index++)
+				{
+					double bottom, top;
+					if (band_meshes[band_index] != INDEX_NONE && getWallBandRange(m_wall_bands[band_index], build.height, bottom, top))
+					{
+						int32 mesh_index = get_band_mesh(band_index, tile_variant_keys[tile_index][i]);
+						DivideWallStrip_RawMesh(build.coords, smoothing_masks, bottom, top, meshes[mesh_index], cursors[mesh_index]);
+					}
+				}
 			}
-			
+			for (int32 mesh_index = 0; mesh_index < mesh_count; mesh_index++)
+			{
+				OffsetRawMesh(tile_meshes[tile_index][mesh_index * lod_count + lod], tile.origin);
+			}
+		});
+		LogMeshEmission(*FString::Printf(TEXT("wall lod %d (raw mesh)"), lod), total, start_time, count_time, start_memory, m_bake_report.wall);
+	}
 
-			polygon.RemoveAt(index);
-			count = polygon.Num();
-			index = 0;
+	for (int32 band_index = 0; band_index < m_wall_bands.Num(); band_index++)
+	{
+		const FWallBand& band = m_wall_bands[band_index];
+		if (band_meshes[band_index] == INDEX_NONE)
+		{
+			//ͣõķֶɵĿв
+			for (int32 i = 0; i < band.variant_count; i++)
+			{
+				for (int32 tile_index = 0; tile_index < tile_count; tile_index++)
+				{
+					if (tile_dirty[tile_index])
+					{
+						m_stale_mesh_names.Add(GetWallBandMeshName(band, i) + "_" + m_building_tiles[tile_index].name);
+					}
+				}
+			}
+			continue;
 		}
-		else
+		for (int32 i = 0; i < band.variant_count; i++)
 		{
-			index++;
+			FString mesh_name = GetWallBandMeshName(band, i);
+			FString material_name = band.variant_count > 1 ? band.material_name + FString::FromInt(i) : band.material_name;
+			TSharedRef<UMaterialInterface*> Material = enqueueLoadMaterial(material_name);
+			int32 mesh_index = band_meshes[band_index] + i;
+			for (int32 tile_index = 0; tile_index < tile_count; tile_index++)
+			{
+				const FBuildingTile& tile = m_building_tiles[tile_index];
+				if (!tile_dirty[tile_index])
+				{
+					//δ仯ԭͿ·ʵ
+					if (tile.instances.Num() > 0)
+					{
+						enqueueReloadPrototype(mesh_name + "_" + tile.name, tile_index);
+					}
+				}
+				//ķֶοΪ
+				else if (tile_meshes[tile_index][mesh_index * lod_count].VertexPositions.Num() > 0)
+				{
+					TArray<FRawMesh> lods;
+					lods.Reserve(lod_count);
+					for (int32 lod = 0; lod < lod_count; lod++)
+					{
+						lods.Add(MoveTemp(tile_meshes[tile_index][mesh_index * lod_count + lod]));
+					}
+					enqueueSaveMesh(mesh_name + "_" + tile.name, Material, MoveTemp(lods), tile_index);
+				}
+				else
+				{
+					m_stale_mesh_names.Add(mesh_name + "_" + tile.name);
+				}
+			}
 		}
 	}
+	for (int32 tile_index = 0; tile_index < tile_count; tile_index++)
+	{
+		if (tile_dirty[tile_index] && m_use_rebuild_cache)
+		{
+			m_rebuild_cache.SetMeshHash("wall_" + m_building_tiles[tile_index].name, m_tile_hashes[tile_index]);
+		}
+	}
+}
+void ABuilder::InitWallBands()
+{
+	//桢в5ʹãײ
+	m_wall_bands.Empty();
+	m_wall_bands.Add(MakeWallBand("total", "total_wall_mesh", "total_wall_material", 0.0f, false, 0.0f, true, 1));
+	m_wall_bands.Add(MakeWallBand("top", "top_wall_mesh", "top_wall_material", m_wall_top_dis, true, 0.0f, true, 1));
+	m_wall_bands.Add(MakeWallBand("center", "center_wall_mesh", "ceter_wall_material", m_wall_bottom_dis, false, m_wall_top_dis, true, 5));
+	m_wall_bands.Add(MakeWallBand("bottom", "bottom_wall_mesh", "bottom_wall_material", 0.0f, false, m_wall_bottom_dis, false, 1));
+}
+FWallBand ABuilder::MakeWallBand(const FString& name, const FString& mesh_name, const FString& material_name, float bottom, bool bottom_from_roof, float top, bool top_from_roof, int32 variant_count)
+{
+	FWallBand band;
+	band.name = name;
+	band.mesh_name = mesh_name;
+	band.material_name = material_name;
+	band.bottom = bottom;
+	band.bottom_from_roof = bottom_from_roof;
+	band.top = top;
+	band.top_from_roof = top_from_roof;
+	band.variant_count = variant_count;
+	band.enabled = true;
+	return band;
+}
+float ABuilder::getWallCreaseCos() const
+{
+	return FMath::Cos(FMath::DegreesToRadians(m_wall_crease_angle));
+}
+bool ABuilder::getWallBandRange(const FWallBand& band, double height, double& bottom, double& top) const
+{
+	bottom = FMath::Clamp(band.bottom_from_roof ? height - band.bottom : (double)band.bottom, 0.0, height);
+	top = FMath::Clamp(band.top_from_roof ? height - band.top : (double)band.top, 0.0, height);
+	//ϸ߶Ȳķֱֶ˻ı
+	return top - bottom > threshold;
+}
 
-	delta = RawMesh.VertexPositions.Num();
-	RawMesh.VertexPositions.Add(polygon[0]);
-	RawMesh.VertexPositions.Add(polygon[1]);
-	RawMesh.VertexPositions.Add(polygon[2]);
+void ABuilder::CreateRoofMesh()
+{
+	if (m_use_pmc)
+	{
+		CreateRoofMesh_PMCImp();
+	}
+	else
+	{
+		CreateRoofMesh_RawMeshImp();
+	}
+}
+void ABuilder::CreateRoofMesh_PMCImp()
+{
+	const FBuildingRebuildCache* rebuild_cache = m_use_rebuild_cache ? &m_rebuild_cache : nullptr;
+	for (auto it_layer_data = m_building_layer_data.begin(); it_layer_data != m_building_layer_data.end(); ++it_layer_data)
+	{
+		int32 layer_id = it_layer_data->Key;
+		TArray<FBuildingChunk> chunks;
+		MakeBuildingChunks(layer_id, it_layer_data->Value, chunks);
 
-	RawMesh.WedgeIndices.Add(0 + delta);
-	RawMesh.WedgeIndices.Add(2 + delta);
-	RawMesh.WedgeIndices.Add(1 + delta);
+		double start_time = FPlatformTime::Seconds();
+		uint64 start_memory = FPlatformMemory::GetStats().UsedPhysical;
 
-	float pre_u = (polygon[0].X - min.X) / uv_width;
-	float pre_v = (polygon[0].Y - min.Y) / uv_height;
-	RawMesh.WedgeTexCoords->Add(FVector2D(pre_u, pre_v));
-	float next_u = (polygon[2].X - min.X) / uv_width;
-	float next_v = (polygon[2].Y - min.Y) / uv_height;
-	RawMesh.WedgeTexCoords->Add(FVector2D(next_u, next_v));
-	float cur_u = (polygon[1].X - min.X) / uv_width;
-	float cur_v = (polygon[1].Y - min.Y) / uv_height;
-	RawMesh.WedgeTexCoords->Add(FVector2D(cur_u, cur_v));
+		TArray<FRoofChunkTriangles> chunk_triangles;
+		FPMCMeshChunk roof;
+		double count_time = 0.0;
+		FMeshSize total = MakeRoofMesh_PMC(chunks, rebuild_cache, chunk_triangles, roof, count_time);
+		m_bake_report.AddRoofs(chunk_triangles, true, [&](int32 chunk_index, int32 i, FBuildingSlowRoof& building)
+		{
+			const FBuildingChunk& chunk = chunks[chunk_index];
+			FBuildingView build = (*chunk.buildings)[chunk.begin + i];
+			building.layer_id = chunk.layer_id;
+			building.building_index = chunk.begin + i;
+			building.code = build.code;
+			building.vertices = build.coords.Num();
+		});
+		chunk_triangles.Empty();
+		LogMeshEmission(TEXT("roof (pmc)"), total, start_time, count_time, start_memory, m_bake_report.roof);
+
+		roof.VertexColors.Init(FColor(1.0f, 1.0f, 1.0f, 0.5f), roof.Vertices.Num());
+		roof.Normals.Init(FVector(0.0, 0.0f, 1.0), roof.Vertices.Num());
+		if (m_optimize_vertex_cache)
+		{
+			OptimizePMCMesh(roof, m_bake_report.vertex_cache);
+		}
+		enqueueGameThreadTask([this, roof = MoveTemp(roof)]()
+		{
+			TArray<FProcMeshTangent> Tangents;
+			Tangents.Init(FProcMeshTangent(1.0f, 0.0f, 0.0f), roof.Vertices.Num());
+			roof_pmc->CreateMeshSection(0, roof.Vertices, roof.Index, roof.Normals, roof.UV, roof.UV, roof.UV, roof.UV, roof.VertexColors, Tangents, true);
+			roof_pmc->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
 
-	RawMesh.FaceMaterialIndices.Add(0);
-	RawMesh.FaceSmoothingMasks.Add(0);
-	for (int corner = 0; corner < 3; corner++)
+			FString image_name = "1.png";
+			UTexture2D* texture = nullptr;
+			int32 width, height;
+			if (LoadImageToTexture2D(image_name, texture, width, height))
+			{
+				UMaterialInterface* Material = CreateMaterial(texture, "roof_material", 0.7, 0.4);
+				roof_pmc->SetMaterial(0, Material);
+			}
+		});
+	}
+}
+void ABuilder::CreateRoofMesh_RawMeshImp()
+{
+	const FBuildingRebuildCache* rebuild_cache = m_use_rebuild_cache ? &m_rebuild_cache : nullptr;
+	int32 lod_count = m_lod_building_data.Num() + 1;
+	int32 tile_count = m_building_tiles.Num();
+	TArray<TArray<FRawMesh>> tile_meshes;
+	tile_meshes.SetNum(tile_count);
+	for (TArray<FRawMesh>& meshes : tile_meshes)
 	{
-		RawMesh.WedgeTangentX.Add(FVector(1, 0, 0));
-		RawMesh.WedgeTangentY.Add(FVector(0, 1, 0));
-		RawMesh.WedgeTangentZ.Add(FVector(0, 0, 1));
+		meshes.SetNum(lod_count);
+	}
+	TArray<bool> tile_dirty;
+	int32 dirty_count = getDirtyTiles("roof_", tile_dirty);
+	UE_LOG(LogClass, Log, TEXT("rebuild roof: %d of %d tiles changed"), dirty_count, tile_count);
 
-		RawMesh.WedgeColors.Add(FColor(1.0f, 1.0f, 1.0f, 1.0f));
+	for (int32 lod = 0; lod < lod_count; lod++)
+	{
+		if (isBuildCancelled())
+		{
+			return;
+		}
+		double start_time = FPlatformTime::Seconds();
+		uint64 start_memory = FPlatformMemory::GetStats().UsedPhysical;
+
+		TArray<FRoofChunkTriangles> tile_triangles;
+		TArray<FMeshSize> tile_sizes;
+		tile_triangles.SetNum(tile_count);
+		tile_sizes.SetNum(tile_count);
+		ParallelFor(tile_count, [&](int32 tile_index)
+		{
+			if (!tile_dirty[tile_index])
+			{
+				return;
+			}
+			SCOPE_CYCLE_COUNTER(STAT_BuildingMeshCount);
+			const FBuildingTile& tile = m_building_tiles[tile_index];
+			TArray<FBuildingView> buildings;
+			buildings.Reserve(tile.building_indices.Num());
+			for (int32 i = 0; i < tile.building_indices.Num(); i++)
+			{
+				buildings.Add(getTileBuilding(tile, i, lod));
+			}
+			CountRoofBuildings(buildings, rebuild_cache, tile_triangles[tile_index], tile_sizes[tile_index]);
+			AllocateRawMesh(tile_sizes[tile_index], tile_meshes[tile_index][lod]);
+		});
+		FMeshSize total = PrefixMeshSizes(tile_sizes);
+		//ǻд뻺棬´ؽʱֱʹ
+		if (m_use_rebuild_cache)
+		{
+			for (const FRoofChunkTriangles& roof_triangles : tile_triangles)
+			{
+				for (const TPair<uint64, int32>& triangulated : roof_triangles.triangulated)
+				{
+					int32 offset = roof_triangles.offsets[triangulated.Value];
+					TArrayView<const int32> triangles(roof_triangles.triangles.GetData() + offset, roof_triangles.offsets[triangulated.Value + 1] - offset);
+					m_rebuild_cache.AddTriangles(triangulated.Key, triangles);
+				}
+			}
+		}
+		//ԭͿеΪԭ
+		m_bake_report.AddRoofs(tile_triangles, lod == 0, [&](int32 tile_index, int32 i, FBuildingSlowRoof& building)
+		{
+			const FBuildingTile& tile = m_building_tiles[tile_index];
+			FBuildingView build = getTileBuilding(tile, i, lod);
+			building.layer_id = tile.layer_ids[i];
+			building.building_index = tile.building_indices[i];
+			building.code = build.code;
+			building.vertices = build.coords.Num();
+		});
+		double count_time = FPlatformTime::Seconds();
+
+		ParallelFor(tile_count, [&](int32 tile_index)
+		{
+			if (!tile_dirty[tile_index])
+			{
+				return;
+			}
+			SCOPE_CYCLE_COUNTER(STAT_BuildingMeshFill);
+			const FBuildingTile& tile = m_building_tiles[tile_index];
+			const FRoofChunkTriangles& roof_triangles = tile_triangles[tile_index];
+			FRawMeshView RawMesh = MakeRawMeshView(tile_meshes[tile_index][lod]);
+			FMeshSize cursor;
+			for (int32 i = 0; i < tile.building_indices.Num(); i++)
+			{
+				FBuildingView build = getTileBuilding(tile, i, lod);
+				if (roof_triangles.convex[i])
+				{
+					DivideConvexPolygon_RawMesh(build.coords, build.height, RawMesh, cursor);
+				}
+				else
+				{
+					TArrayView<const int32> triangles(roof_triangles.triangles.GetData() + roof_triangles.offsets[i], roof_triangles.offsets[i + 1] - roof_triangles.offsets[i]);
+					DivideConcavePolygon_RawMesh(build.coords, triangles, build.height, RawMesh, cursor);
+				}
+			}
+			OffsetRawMesh(tile_meshes[tile_index][lod], tile.origin);
+		});
+		tile_triangles.Empty();
+		LogMeshEmission(*FString::Printf(TEXT("roof lod %d (raw mesh)"), lod), total, start_time, count_time, start_memory, m_bake_report.roof);
+	}
+
+	TSharedRef<UMaterialInterface*> Material = enqueueLoadMaterial("roof_material");
+	for (int32 tile_index = 0; tile_index < tile_count; tile_index++)
+	{
+		const FBuildingTile& tile = m_building_tiles[tile_index];
+		if (!tile_dirty[tile_index])
+		{
+			if (tile.instances.Num() > 0)
+			{
+				enqueueReloadPrototype("roof_mesh_" + tile.name, tile_index);
+			}
+			continue;
+		}
+		if (tile_meshes[tile_index][0].VertexPositions.Num() > 0)
+		{
+			enqueueSaveMesh("roof_mesh_" + tile.name, Material, MoveTemp(tile_meshes[tile_index]), tile_index);
+		}
+		else
+		{
+			m_stale_mesh_names.Add("roof_mesh_" + tile.name);
+		}
+		if (m_use_rebuild_cache)
+		{
+			m_rebuild_cache.SetMeshHash("roof_" + tile.name, m_tile_hashes[tile_index]);
+		}
+	}
+}
+uint64 ABuilder::getBuildSettingsHash() const
+{
+	uint64 hash = HashBuildValue(mesh_generator_version, 0);
+	hash = HashBuildValue(m_wall_crease_angle, hash);
+	for (const FWallBand& band : m_wall_bands)
+	{
+		hash = HashBuildValue(GetTypeHash(band.mesh_name), hash);
+		hash = HashBuildValue(band.bottom, hash);
+		hash = HashBuildValue(band.bottom_from_roof, hash);
+		hash = HashBuildValue(band.top, hash);
+		hash = HashBuildValue(band.top_from_roof, hash);
+		hash = HashBuildValue(band.variant_count, hash);
+		hash = HashBuildValue(band.enabled, hash);
+	}
+	for (float scale : m_lod_tolerance_scales)
+	{
+		hash = HashBuildValue(scale, hash);
+	}
+	for (float screen_size : m_lod_screen_sizes)
+	{
+		hash = HashBuildValue(screen_size, hash);
+	}
+	hash = HashBuildValue(m_lod_proxy_size, hash);
+	for (auto it = m_building_layer_info.begin(); it != m_building_layer_info.end(); ++it)
+	{
+		hash = HashBuildValue(it->Key, hash);
+		hash = HashBuildValue(it->Value.simplify_tolerance, hash);
+	}
+	return hash;
+}
+void ABuilder::getTileHashes(TArray<uint64>& tile_hashes, TSet<uint64>& roof_ring_hashes) const
+{
+	uint64 settings_hash = getBuildSettingsHash();
+	int32 lod_count = m_lod_building_data.Num() + 1;
+	int32 tile_count = m_building_tiles.Num();
+	TArray<TArray<uint64>> tile_ring_hashes;
+	tile_hashes.SetNum(tile_count);
+	tile_ring_hashes.SetNum(tile_count);
+	ParallelFor(tile_count, [&](int32 tile_index)
+	{
+		const FBuildingTile& tile = m_building_tiles[tile_index];
+		uint64 hash = settings_hash;
+		for (int32 i = 0; i < tile.building_indices.Num(); i++)
+		{
+			//ǽݹϣͼӰݲͼеŲӰ
+			hash = HashBuildValue(HashBuilding(getTileBuilding(tile, i, 0)), hash);
+			hash = HashBuildValue(tile.layer_ids[i], hash);
+			for (int32 lod = 0; lod < lod_count; lod++)
+			{
+				FBuildingView build = getTileBuilding(tile, i, lod);
+				if (!IsConvexPolygon(build.coords))
+				{
+					tile_ring_hashes[tile_index].Add(HashBuildingRing(build.coords));
+				}
+			}
+		}
+		tile_hashes[tile_index] = hash;
+	});
+	roof_ring_hashes.Reset();
+	for (const TArray<uint64>& ring_hashes : tile_ring_hashes)
+	{
+		roof_ring_hashes.Append(ring_hashes);
 	}
-	
+}
+int32 ABuilder::getDirtyTiles(const FString& prefix, TArray<bool>& tile_dirty) const
+{
+	int32 dirty_count = 0;
+	tile_dirty.SetNum(m_building_tiles.Num());
+	for (int32 tile_index = 0; tile_index < m_building_tiles.Num(); tile_index++)
+	{
+		tile_dirty[tile_index] = !m_use_rebuild_cache || !m_rebuild_cache.IsMeshUpToDate(prefix + m_building_tiles[tile_index].name, m_tile_hashes[tile_index]);
+		dirty_count += tile_dirty[tile_index] ? 1 : 0;
+	}
+	return dirty_count;
+}
+void ABuilder::getCachedMeshPackages(const FString& cache_name, TArray<FString>& mesh_names) const
+{
+	FString prefix, tile_name;
+	if (!cache_name.Split(TEXT("_"), &prefix, &tile_name))
+	{
+		return;
+	}
+	if (prefix == TEXT("wall"))
+	{
+		for (const FWallBand& band : m_wall_bands)
+		{
+			for (int32 i = 0; i < band.variant_count; i++)
+			{
+				mesh_names.Add(GetWallBandMeshName(band, i) + "_" + tile_name);
+			}
+		}
+	}
+	else if (prefix == TEXT("roof"))
+	{
+		mesh_names.Add("roof_mesh_" + tile_name);
+	}
+}
+void ABuilder::deleteMeshPackages(TArrayView<const FString> mesh_names)
+{
+	TArray<UObject*> meshes;
+	for (const FString& mesh_name : mesh_names)
+	{
+		UStaticMesh* StaticMesh = LoadSavedStaticMesh(mesh_name);
+		if (StaticMesh != nullptr)
+		{
+			meshes.AddUnique(StaticMesh);
+		}
+	}
+	if (meshes.Num() == 0)
+	{
+		return;
+	}
+	//ǿɾؿеãӴ̺ԴעƳ
+	int32 deleted = ObjectTools::ForceDeleteObjects(meshes, false);
+	UE_LOG(LogClass, Log, TEXT("delete %d of %d stale meshes"), deleted, meshes.Num());
+}
+FBuildingView ABuilder::getTileBuilding(const FBuildingTile& tile, int32 index, int32 lod) const
+{
+	const TMap<int32, FBuildingLayer>* layer_data;
+	if (lod == 0)
+	{
+		layer_data = tile.instances.Num() > 0 ? &m_prototype_data : &m_building_layer_data;
+	}
+	else
+	{
+		layer_data = tile.instances.Num() > 0 ? &m_lod_prototype_data[lod - 1] : &m_lod_building_data[lod - 1];
+	}
+	return layer_data->FindChecked(tile.layer_ids[index])[tile.building_indices[index]];
 }
 
-void ABuilder::SaveStaticMeshWithRawMesh(FString MeshName, FString MaterialName, FRawMesh RawMesh)
+UStaticMesh* ABuilder::SaveStaticMeshWithRawMesh(const FString& MeshName, UMaterialInterface* Material, TArrayView<FRawMesh> LodMeshes, const FBuildingTile& Tile)
 {
-	FString PackageName = "/Game/Mesh/" + MeshName;
+	FString PackageName = getPackageName(TEXT("Mesh"), MeshName);
 	UPackage* MeshPackage = CreatePackage(nullptr, *PackageName);
 	UStaticMesh* StaticMesh = NewObject< UStaticMesh >(MeshPackage, FName(*MeshName), RF_Public | RF_Standalone);
 	FAssetRegistryModule::AssetCreated(StaticMesh);
 	StaticMesh->PreEditChange(nullptr);
-	FStaticMeshSourceModel& SrcModel = StaticMesh->AddSourceModel();
-	SrcModel.SaveRawMesh(RawMesh);
 
-	//ʱô
-	FString image_name = MaterialName + ".png";
-	UTexture2D* texture = nullptr;
-	int32 width, height;
-	if (LoadImageToTexture2D(image_name, texture, width, height))
+	//ÿLODһԴģͣʹù̶ĻߴֵΪյLOD
+	StaticMesh->bAutoComputeLODScreenSize = false;
+	FString lod_triangles;
+	for (int32 lod = 0; lod < LodMeshes.Num() && LodMeshes[lod].FaceMaterialIndices.Num() > 0; lod++)
 	{
-	 	UMaterialInterface* Material = CreateMaterial(texture, MaterialName, 0.7, 0.4);
-	 	StaticMesh->AddMaterial(Material);
+		FStaticMeshSourceModel& SrcModel = StaticMesh->AddSourceModel();
+		SrcModel.ScreenSize.Default = lod == 0 ? 1.0f : m_lod_screen_sizes[lod - 1];
+		SrcModel.SaveRawMesh(LodMeshes[lod]);
+		lod_triangles += FString::Printf(TEXT(" %d"), LodMeshes[lod].FaceMaterialIndices.Num());
+	}
+	UE_LOG(LogClass, Log, TEXT("save %s: lod triangles%s"), *MeshName, *lod_triangles);
+
+	if (Material != nullptr)
+	{
+		StaticMesh->AddMaterial(Material);
 	}
 	TArray< FText > BuildErrors;
-	StaticMesh->Build(true, &BuildErrors);
+	double build_start_time = FPlatformTime::Seconds();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BuildingStaticMeshBuild);
+		StaticMesh->Build(true, &BuildErrors);
+	}
+	m_bake_report.static_meshes++;
+	m_bake_report.static_mesh_build_seconds += FPlatformTime::Seconds() - build_start_time;
+
+	//񶥵Էֿԭ㣬ʱҪƽƵõ
+	UMetaData* MetaData = MeshPackage->GetMetaData();
+	MetaData->SetValue(StaticMesh, TEXT("TileOrigin"), *Tile.origin.ToString());
+	MetaData->SetValue(StaticMesh, TEXT("TileBounds"), *Tile.bounds.ToString());
+	if (Tile.instances.Num() > 0)
+	{
+		MetaData->SetValue(StaticMesh, TEXT("InstanceCount"), *FString::FromInt(Tile.instances.Num()));
+	}
 	
 	StaticMesh->MarkPackageDirty();
-	FString PackageFileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
-	bool Saved = UPackage::SavePackage(MeshPackage, StaticMesh, EObjectFlags::RF_Public | EObjectFlags::RF_Standalone, *PackageFileName);
+	addDirtyPackage(StaticMesh);
+	return StaticMesh;
 }
-
-bool ABuilder::LoadImageToTexture2D(const FString& ImageName, UTexture2D*& InTexture, int32& Width, int32& Height)
+void ABuilder::AddPrototypeInstances(UStaticMesh* StaticMesh, int32 VertexCount, int32 WedgeCount, const FBuildingTile& Tile)
 {
-    FString ImagePath = FPaths::ProjectContentDir() + "Image/" + ImageName;
-	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-	if (!PlatformFile.FileExists(*ImagePath))
+	if (Tile.instances.Num() == 0)
 	{
-		return false;
+		return;
+	}
+	UHierarchicalInstancedStaticMeshComponent* instance_component = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+	instance_component->SetStaticMesh(StaticMesh);
+	instance_component->SetupAttachment(GetRootComponent());
+	instance_component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	instance_component->RegisterComponent();
+	AddInstanceComponent(instance_component);
+	instance_component->AddInstances(Tile.instances, false);
+	instance_components.Add(instance_component);
+
+	//ϲÿʵᱣһλШζ
+	int64 saved_copies = Tile.instances.Num() - 1;
+	int64 wedge_bytes = sizeof(uint32) + sizeof(FVector2D) + 3 * sizeof(FVector) + sizeof(FColor);
+	m_instance_saved_vertices += saved_copies * VertexCount;
+	m_instance_saved_bytes += saved_copies * (VertexCount * sizeof(FVector) + WedgeCount * wedge_bytes);
+}
+void ABuilder::getMeshImagePaths(TArray<FString>& image_paths) const
+{
+	if (m_use_pmc)
+	{
+		image_paths.Add(GetImagePath("1.png"));
+		image_paths.Add(GetImagePath("2.png"));
+		return;
 	}
-	TArray<uint8> ImageResultData;
-	FFileHelper::LoadFileToArray(ImageResultData, *ImagePath);
-	FString Ex = FPaths::GetExtension(ImagePath, false);
-	EImageFormat ImageFormat = EImageFormat::Invalid;
-	if (Ex.Equals(TEXT("jpg"), ESearchCase::IgnoreCase) || Ex.Equals(TEXT("jpeg"), ESearchCase::IgnoreCase))
+	for (const FWallBand& band : m_wall_bands)
 	{
-		ImageFormat = EImageFormat::JPEG;
+		for (int32 i = 0; band.enabled && i < band.variant_count; i++)
+		{
+			FString material_name = band.variant_count > 1 ? band.material_name + FString::FromInt(i) : band.material_name;
+			image_paths.AddUnique(GetImagePath(material_name + ".png"));
+		}
 	}
-	else if (Ex.Equals(TEXT("png"), ESearchCase::IgnoreCase))
+	image_paths.Add(GetImagePath("roof_material.png"));
+}
+TSharedRef<UMaterialInterface*> ABuilder::enqueueLoadMaterial(const FString& material_name)
+{
+	TSharedRef<UMaterialInterface*> material = MakeShared<UMaterialInterface*>(nullptr);
+	enqueueGameThreadTask([this, material, material_name]()
+	{
+		*material = LoadMeshMaterial(material_name);
+	});
+	return material;
+}
+void ABuilder::enqueueSaveMesh(const FString& mesh_name, TSharedRef<UMaterialInterface*> material, TArray<FRawMesh>&& lod_meshes, int32 tile_index)
+{
+	enqueueGameThreadTask([this, mesh_name, material, lod_meshes = MoveTemp(lod_meshes), tile_index]() mutable
+	{
+		const FBuildingTile& tile = m_building_tiles[tile_index];
+		UStaticMesh* StaticMesh = SaveStaticMeshWithRawMesh(mesh_name, *material, lod_meshes, tile);
+		AddPrototypeInstances(StaticMesh, lod_meshes[0].VertexPositions.Num(), lod_meshes[0].WedgeIndices.Num(), tile);
+	});
+}
+void ABuilder::enqueueReloadPrototype(const FString& mesh_name, int32 tile_index)
+{
+	enqueueGameThreadTask([this, mesh_name, tile_index]()
+	{
+		//¼صûRawMeshȾݹ
+		UStaticMesh* StaticMesh = LoadSavedStaticMesh(mesh_name);
+		if (StaticMesh != nullptr)
+		{
+			AddPrototypeInstances(StaticMesh, StaticMesh->GetNumVertices(0), StaticMesh->GetNumVertices(0), m_building_tiles[tile_index]);
+		}
+	});
+}
+FString ABuilder::getPackageName(const TCHAR* folder, const FString& asset_name) const
+{
+	return m_package_root / folder / asset_name;
+}
+UStaticMesh* ABuilder::LoadSavedStaticMesh(const FString& MeshName)
+{
+	FString PackageName = getPackageName(TEXT("Mesh"), MeshName);
+	if (!FPackageName::DoesPackageExist(PackageName))
+	{
+		return nullptr;
+	}
+	return LoadObject<UStaticMesh>(nullptr, *(PackageName + "." + MeshName));
+}
+
+UMaterialInterface* ABuilder::LoadMeshMaterial(const FString& MaterialName)
+{
+	//ʱô
+	FString image_name = MaterialName + ".png";
+	UTexture2D* texture = nullptr;
+	int32 width, height;
+	if (LoadImageToTexture2D(image_name, texture, width, height))
 	{
-		ImageFormat = EImageFormat::PNG;
+		return CreateMaterial(texture, MaterialName, 0.7, 0.4);
 	}
-	else if (Ex.Equals(TEXT("bmp"), ESearchCase::IgnoreCase))
+	return nullptr;
+}
+
+bool ABuilder::LoadImageToTexture2D(const FString& ImageName, UTexture2D*& InTexture, int32& Width, int32& Height)
+{
+	FString ImagePath = GetImagePath(ImageName);
+	//ʹų́ԤȽĽ
+	FDecodedImage decoded_image;
+	const FDecodedImage* image = m_decoded_images.Find(ImagePath);
+	if (image == nullptr)
 	{
-		ImageFormat = EImageFormat::BMP;
+		if (!DecodeImage(ImagePath, decoded_image))
+		{
+			return false;
+		}
+		image = &decoded_image;
 	}
-	if (ImageFormat == EImageFormat::Invalid)
+	Width = image->width;
+	Height = image->height;
+
+	//ͬһļͬһֻһͼԴ
+	FString cache_key = FString::Printf(TEXT("Image/%s#%08x"), *ImageName, image->hash);
+	if (UTexture2D** cached_texture = texture_cache.Find(cache_key))
 	{
-		return false;
+		InTexture = *cached_texture;
+		return true;
 	}
-	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>("ImageWrapper");
-	TSharedPtr<IImageWrapper> ImageWrapperPtr = ImageWrapperModule.CreateImageWrapper(ImageFormat);
 
-	if (ImageWrapperPtr.IsValid() && ImageWrapperPtr->SetCompressed(ImageResultData.GetData(), ImageResultData.Num()))
+	int32 index = 0;
+	ImageName.FindChar('.', index);
+	FString AssetName = ImageName.Left(index);
+	FString PackageName = getPackageName(TEXT("Texture"), AssetName);
+	//֮ǰͼδ仯ʱֱӼ
+	InTexture = LoadCachedAsset<UTexture2D>(PackageName, AssetName, cache_key);
+	if (InTexture == nullptr)
 	{
-		int32 index = 0;
-		ImageName.FindChar('.', index);
-		FString AssetName = ImageName.Left(index);
-		FString PackageName = "/Game/Texture/" + AssetName;
 		UPackage* Package = CreatePackage(NULL, *PackageName);
-
-		TArray<uint8> OutRawData;
-		ImageWrapperPtr->GetRaw(ERGBFormat::BGRA, 8, OutRawData);
-		Width = ImageWrapperPtr->GetWidth();
-		Height = ImageWrapperPtr->GetHeight();
-	
 		InTexture = NewObject<UTexture2D>(Package,*AssetName,RF_Standalone | RF_Public);
 		FAssetRegistryModule::AssetCreated(InTexture);
 		InTexture->PlatformData = new FTexturePlatformData();
@@ -938,21 +1752,20 @@ bool ABuilder::LoadImageToTexture2D(const FString& ImageName, UTexture2D*& InTex
 		Mip->SizeY = Height;
 		Mip->BulkData.Lock(LOCK_READ_WRITE);
 		void* TextureData = Mip->BulkData.Realloc(Width * Height * 4);
-		FMemory::Memcpy(TextureData, OutRawData.GetData(), OutRawData.Num());
+		FMemory::Memcpy(TextureData, image->pixels.GetData(), image->pixels.Num());
 		Mip->BulkData.Unlock();
 		InTexture->PlatformData->Mips.Add(Mip);
 
 		InTexture->MipGenSettings = TMGS_NoMipmaps;
-		InTexture->Source.Init(Width,Height,1,1,ETextureSourceFormat::TSF_BGRA8, OutRawData.GetData());
+		InTexture->Source.Init(Width,Height,1,1,ETextureSourceFormat::TSF_BGRA8, image->pixels.GetData());
 
 		InTexture->UpdateResource();
+		Package->GetMetaData()->SetValue(InTexture, TEXT("CacheKey"), *cache_key);
 		InTexture->MarkPackageDirty();
-		FString PackageFileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
-		bool Saved = UPackage::SavePackage(Package, InTexture, EObjectFlags::RF_Public | EObjectFlags::RF_Standalone, *PackageFileName);
-		return Saved;
-		
+		addDirtyPackage(InTexture);
 	}
-	return false;
+	texture_cache.Add(cache_key, InTexture);
+	return true;
 }
 UMaterialInterface* ABuilder::CreateMaterialInstanceDynamic(UTexture2D* InTexture, float Roughness, float Metallic)
 {
@@ -969,9 +1782,24 @@ UMaterialInterface* ABuilder::CreateMaterialInstanceDynamic(UTexture2D* InTextur
 
 	return material_instance_dynamic;
 }
-UMaterialInterface* ABuilder::CreateMaterial(UTexture2D*& InTexture, FString material_name, float Roughness, float Metallic)
+UMaterialInterface* ABuilder::CreateMaterial(UTexture2D*& InTexture, const FString& material_name, float Roughness, float Metallic)
 {
-	FString PackageName = "/Game/Material/" + material_name;
+	//ÿƶӦһͬһơͼֻһΣͬƵĲֻͼ
+	FString texture_key = InTexture->GetOutermost()->GetMetaData()->GetValue(InTexture, TEXT("CacheKey"));
+	FString cache_key = FString::Printf(TEXT("%s_%.3f_%.3f_%.3f"), *texture_key, Roughness, Metallic, material_opacity);
+	FString material_key = material_name + TEXT("/") + cache_key;
+	if (UMaterialInterface** cached_material = material_cache.Find(material_key))
+	{
+		return *cached_material;
+	}
+	FString PackageName = getPackageName(TEXT("Material"), material_name);
+	UMaterialInterface* cached_asset = LoadCachedAsset<UMaterial>(PackageName, material_name, cache_key);
+	if (cached_asset != nullptr)
+	{
+		material_cache.Add(material_key, cached_asset);
+		return cached_asset;
+	}
+
 	UPackage* Package = CreatePackage(NULL, *PackageName);
 	//UMaterialFactoryNew* MaterialFactory = NewObject<UMaterialFactoryNew>();
 	//UMaterial* material = (UMaterial*)MaterialFactory->FactoryCreateNew(UMaterial::StaticClass(),Package,*material_name,RF_Standalone | RF_Public,nullptr,nullptr);
@@ -986,7 +1814,7 @@ UMaterialInterface* ABuilder::CreateMaterial(UTexture2D*& InTexture, FString mat
 
 	
  	UMaterialExpressionConstant* opacity = NewObject<UMaterialExpressionConstant>(material);
- 	opacity->R = 0.5;
+ 	opacity->R = material_opacity;
  	material->Opacity.Expression = opacity;
 	material->Expressions.Add(opacity);
 
@@ -1006,220 +1834,78 @@ UMaterialInterface* ABuilder::CreateMaterial(UTexture2D*& InTexture, FString mat
 	material->SetFlags(RF_Standalone | RF_Public);
 	material->PreEditChange(nullptr);
 	material->PostEditChange();
+	Package->GetMetaData()->SetValue(material, TEXT("CacheKey"), *cache_key);
 	material->MarkPackageDirty();
-
-	FString PackageFileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
-	bool Saved = UPackage::SavePackage(Package, InTexture, EObjectFlags::RF_Public | EObjectFlags::RF_Standalone, *PackageFileName);
-	
+	addDirtyPackage(material);
+	material_cache.Add(material_key, material);
 	return material;
 }
 
 
-FRaySegmentCrossType ABuilder::segmentCrossWithYFowardRayWithoutZ(FVector pStart, FVector pEnd, FVector point)
-{
-	//߶ֱΪ϶غΪ0㣬һûн
-	if (abs(pStart.X - pEnd.X) < threshold)
-	{
-		return FRaySegmentCrossType::Cross_None;
-	}
 
-	//ཻ
-	if (point.Y < pStart.Y && abs(point.X - pStart.X) <= threshold)
-	{
-		return FRaySegmentCrossType::Cross_WithStart;
-	}
 
-	//ཻյ
-	if (point.Y < pStart.Y && abs(point.X - pStart.X) <= threshold)
-	{
-		return FRaySegmentCrossType::Cross_WithStart;
-	}
 
-	//ɸѡ
-	//ˮƽλ˵֮䣬߶ʱtrue
-	if (point.Y < pStart.Y && point.Y < pEnd.Y)
-	{
-		if ((point.X - pStart.X) * (point.X - pEnd.X) <= threshold)
-		{
-			return FRaySegmentCrossType::Cross_Nomal;
-		}
-		else
-		{
-			return FRaySegmentCrossType::Cross_None;
-		}
-	}
-
-	//߶ֱߵĽ㣬Yֵλ߶ֹ֮䣬н
-	float ratio = (pEnd.Y - pStart.Y) / (pEnd.X - pStart.X);
-	float pY = pStart.Y + ratio * (point.X - pStart.X);
-	if ((pY - pStart.Y) * (pY - pEnd.Y) <= threshold)
-	{
-		return FRaySegmentCrossType::Cross_Nomal;
-	}
-	else
-	{
-		return FRaySegmentCrossType::Cross_None;
-	}
-}
-bool ABuilder::isSegmentCrossWithoutZ(FVector pStart1, FVector pEnd1, FVector pStart2, FVector pEnd2)
+void ABuilder::addDirtyPackage(UObject* Asset)
 {
-	//߶2ֹǷ߶1
-	FVector P1 = pStart2 - pStart1;
-	FVector P2 = pEnd2 - pStart1;
-	FVector Q = pEnd1 - pStart1;
-	float mark = (P1.X * Q.Y - P1.Y * Q.X) * (P2.X * Q.Y - P2.X * Q.Y);
-	if (mark > 0)
-	{
-		return false;
-	}
-
-	//߶1ֹǷ߶2
-	P1 = pStart1 - pStart2;
-	P2 = pEnd1 - pStart2;
-	Q = pEnd2 - pStart2;
-	mark = (P1.X * Q.Y - P1.Y * Q.X) * (P2.X * Q.Y - P2.X * Q.Y);
-	if (mark > 0)
+	UPackage* Package = Asset->GetOutermost();
+	if (dirty_packages.Contains(Package))
 	{
-		return false;
+		m_duplicate_package_saves++;
 	}
-
-	return true;
+	dirty_packages.Add(Package, Asset);
 }
-bool ABuilder::pointInPolygon(TArray<FVector> polygon, FVector point)
-{
-	int cross_count = 0;
-	int count = polygon.Num();
-	for (int i = 0; i < count; i++)
-	{
-		int pre_index = i == 0 ? count - 1 : i - 1;
-		int start_index = i;
-		int end_index = i + 1 == count ? 0 : i + 1;
-		int next_index = end_index + 1 == count ? 0 : end_index + 1;
-		FVector pre_point = polygon[pre_index];
-		FVector start_point = polygon[start_index];
-		FVector end_point = polygon[end_index];
-		FVector next_point = polygon[next_index];
-		FRaySegmentCrossType type = segmentCrossWithYFowardRayWithoutZ(start_point, end_point, point);
-		switch (type)
-		{
-		case FRaySegmentCrossType::Cross_None:
-			break;
-		case FRaySegmentCrossType::Cross_WithStart:
-		{
-			//͹㲻㽻
-			if ((pre_point.X > start_point.X) == (end_point.X > start_point.X))
-			{
-				continue;
-			}
-			cross_count++;
-		}
-		break;
-		case FRaySegmentCrossType::Cross_WithEnd:
-			//˵ֻʼ¼
-			break;
-		case FRaySegmentCrossType::Cross_Nomal:
-			cross_count++;
-			break;
-		default:
-			break;
-		}
-	}
-	return cross_count % 2 == 0;
-}
-
-bool ABuilder::pointRightOfLine(FVector pStart, FVector pEnd, FVector point)
+//һαаɸĵȴ
+struct FPackageSaveState
 {
-
-	pStart -= point;
-	pEnd -= point;
-
-	double mark = pStart.X * pEnd.Y - pStart.Y * pEnd.X;
-	return mark < 0.0;
-}
-bool ABuilder::pointInTriangle(TArray<FVector> triangle, FVector point)
+	double start_time;
+	TArray<UPackage*> packages;
+	TArray<UObject*> assets;
+	TArray<FString> file_names;
+	TArray<bool> saved;
+};
+
+void ABuilder::enqueueSaveDirtyPackages(TUniqueFunction<void(bool)>&& on_saved)
 {
-	if (triangle.Num() != 3)
-	{
-		UE_LOG(LogClass, Error, TEXT("ζȷ"));
-		return false;
-	}
-
-	bool r1 = pointRightOfLine(triangle[0], triangle[1], point);
-	bool r2 = pointRightOfLine(triangle[1], triangle[2], point);
-	bool r3 = pointRightOfLine(triangle[2], triangle[0], point);
-	//˳ʱ˳
-	if (r1 && r2 && r3)
+	check(IsInGameThread());
+	TSharedRef<FPackageSaveState> state = MakeShared<FPackageSaveState>();
+	state->start_time = FPlatformTime::Seconds();
+	dirty_packages.GenerateKeyArray(state->packages);
+	dirty_packages.GenerateValueArray(state->assets);
+	for (UPackage* Package : state->packages)
 	{
-		return true;
-	}
-	//ʱ˳
-	if (!r1 && !r2 && !r3)
-	{
-		return true;
+		state->file_names.Add(FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension()));
 	}
+	state->saved.SetNumZeroed(state->packages.Num());
+	dirty_packages.Empty();
 
-	return false;
-}
-bool ABuilder::isConvexPoint(TArray<FVector> polygon, int32 index)
-{
-	int count = polygon.Num();
-	int32 pre_index = index == 0 ? count - 1 : index - 1;
-	int32 next_index = index + 1 == count ? 0 : index + 1;
-	FVector vec1 = polygon[pre_index] - polygon[index];
-	FVector vec2 = polygon[next_index] - polygon[index];
-
-	float mark = vec1.X * vec2.Y - vec1.Y * vec2.X;
-	return mark < 0.0f;
-}
-bool ABuilder::isConvexPolygon(TArray<FVector> polygon)
-{
-	for (int32 i = 0; i < polygon.Num(); i++)
+	//SavePackageֻϷ߳ϵãÿһ첽ʱÿ֡ʱԤڰ֮飻
+	//лļں̨д룬ȫύһͳһȴ
+	for (int32 i = 0; i < state->packages.Num(); i++)
 	{
-		if (!isConvexPoint(polygon, i))
+		enqueueGameThreadTask([state, i]()
 		{
-			return false;
-		}
+			SCOPE_CYCLE_COUNTER(STAT_BuildingSave);
+			const EObjectFlags save_flags = EObjectFlags::RF_Public | EObjectFlags::RF_Standalone;
+			state->saved[i] = UPackage::SavePackage(state->packages[i], state->assets[i], save_flags, *state->file_names[i], GError, nullptr, false, true, SAVE_NoError | SAVE_Async);
+		});
 	}
-	return true;
-}
-bool ABuilder::isDivisiblePoint(TArray<FVector> polygon, int32 index)
-{
-	bool convex = isConvexPoint(polygon, index);
-	if (!convex)
-	{
-		return false;
-	}
-
-	int count = polygon.Num();
-	int32 pre_index = index == 0 ? count - 1 : index - 1;
-	int32 next_index = index + 1 == count ? 0 : index + 1;
-	TArray<FVector> triangle;
-	triangle.Emplace(polygon[pre_index]);
-	triangle.Emplace(polygon[index]);
-	triangle.Emplace(polygon[next_index]);
-	for (int i = 0; i < count; i++)
+	enqueueGameThreadTask([this, state, on_saved = MoveTemp(on_saved)]()
 	{
-		if (i == index || i == pre_index || i == next_index)
+		SCOPE_CYCLE_COUNTER(STAT_BuildingSave);
+		UPackage::WaitForAsyncFileWrites();
+		int32 failed = 0;
+		for (int32 i = 0; i < state->packages.Num(); i++)
 		{
-			continue;
-		}
-		if (pointInTriangle(triangle, polygon[i]))
-		{
-			return false;
+			if (!state->saved[i])
+			{
+				UE_LOG(LogClass, Warning, TEXT("save package failed: %s"), *state->file_names[i]);
+				failed++;
+			}
 		}
-	}
-	return true;
-}
-bool ABuilder::isSurplusPoint(TArray<FVector> polygon, int32 index)
-{
-	int count = polygon.Num();
-	int32 pre_index = index == 0 ? count - 1 : index - 1;
-	int32 next_index = index + 1 == count ? 0 : index + 1;
-	FVector vec1 = polygon[index] - polygon[pre_index];
-	FVector vec2 = polygon[next_index] - polygon[index];
-
-	float mark = vec1.X * vec2.Y - vec1.Y * vec2.X;
-	return abs(mark) < threshold;
+		UE_LOG(LogClass, Log, TEXT("save %d packages (%d failed, %d repeated saves skipped): %.3f s"),
+			state->packages.Num(), failed, m_duplicate_package_saves, FPlatformTime::Seconds() - state->start_time);
+		addStageTime(TEXT("save"), state->start_time);
+		m_duplicate_package_saves = 0;
+		on_saved(failed == 0);
+	});
 }
-
-
@@ -5,17 +5,19 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "ProceduralMeshComponent.h"
+#include "BuildingLayer.h"
+#include "BuildingTiles.h"
+#include "BuildingInstances.h"
+#include "BuildingRebuildCache.h"
+#include "BuildingImageDecoder.h"
+#include "BuildingBuildTask.h"
+#include "BuildingBakeReport.h"
+#include "BuildingSpatialIndex.h"
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "Async/Future.h"
 #include "Builder.generated.h"
 
-USTRUCT(BlueprintType)
-struct FBuildingInfo
-{
-GENERATED_BODY();
-	int32 code;
-	double height;
-	TArray<FVector> coords;
-};
-
 USTRUCT(BlueprintType)
 struct FGeoBuildingLayerInfo
 {
@@ -31,17 +33,44 @@ GENERATED_BODY()
 	float wall_roughness;
 	float wall_metalness;
 	TMap<float, FString> wall_condition;
+
+	float simplify_tolerance;
+};
+
+//ǽ߶ȷֶΣfrom_roofΪtrueʱ߶Ϊ¥ľ룬Ϊĸ߶
+USTRUCT(BlueprintType)
+struct FWallBand
+{
+GENERATED_BODY()
+	FString name;
+	FString mesh_name;
+	FString material_name;
+	float bottom;
+	bool bottom_from_roof;
+	float top;
+	bool top_from_roof;
+	//1ʱд
+	int32 variant_count;
+	bool enabled;
 };
 
-UENUM(BlueprintType)
-enum class FRaySegmentCrossType :uint8
+//ռѯеĽͼ㡢ͼе룬distanceΪľ룬ʱΪ0
+USTRUCT(BlueprintType)
+struct FBuildingQueryHit
 {
-	Cross_None = 0,       //ཻ
-	Cross_WithStart = 1,  //ཻ߶
-	Cross_WithEnd = 2,    //߶յ
-	Cross_Nomal = 3       //߶ν    
+GENERATED_BODY()
+	UPROPERTY(BlueprintReadOnly, Category = "Builder")
+		int32 layer_id = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Builder")
+		int32 index = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Builder")
+		int32 code = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Builder")
+		float distance = 0.0f;
 };
 
+class UHierarchicalInstancedStaticMeshComponent;
+
 UCLASS()
 class BUILDINGBUILDER_API ABuilder : public AActor
 {
@@ -69,67 +98,184 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Builder")
 		void CreateMesh();
 
+	//ں̨񣬱UObjectϷ̰߳ʱԤִ
+	UFUNCTION(BlueprintCallable, Category = "Builder")
+		UBuildingBuildTask* CreateMeshAsync();
+
+	virtual void BeginDestroy() override;
+
+	//ռѯΪ꣬Actorı任תͶӰֻȽˮƽλãã첽ɹзؿ
+	UFUNCTION(BlueprintCallable, Category = "Builder")
+		bool PickBuilding(const FVector& location, FBuildingQueryHit& hit) const;
+	UFUNCTION(BlueprintCallable, Category = "Builder")
+		TArray<FBuildingQueryHit> QueryBuildingsInBox(const FVector& min, const FVector& max) const;
+	UFUNCTION(BlueprintCallable, Category = "Builder")
+		TArray<FBuildingQueryHit> QueryBuildingsInRadius(const FVector& center, float radius) const;
+	//ľӽԶ
+	UFUNCTION(BlueprintCallable, Category = "Builder")
+		TArray<FBuildingQueryHit> QueryNearestBuildings(const FVector& location, int32 count) const;
+
+	//һνɸ׶εĺʱ룩ִ˳game_threadΪͬʱϷ߳ϵԴ뱣棬save
+	const TArray<TPair<FString, double>>& GetStageTimes() const { return m_stage_times; }
+	//һɵͳƣɽͬʱдGetBakeReportFileName()
+	const FBuildingBakeReport& GetBakeReport() const { return m_bake_report; }
+
 
 
 
 protected:
 	bool ParseMapJson();
 	bool ParseBuildingsJson();
-	bool getJsonRootObjectFromFile(FString file_name, TSharedPtr<FJsonObject>& json_roo);
+	bool ParseBuildingsFile_DOMImp(const FString& file_name, FBuildingLayer& building_data, uint64& peak_memory);
+	bool ParseBuildingsFile_StreamImp(const FString& file_name, FBuildingLayer& building_data, uint64& peak_memory);
+	//peak_memoryļַDOMͬʱʱ
+	bool getJsonRootObjectFromFile(const FString& file_name, TSharedPtr<FJsonObject>& json_roo, uint64& peak_memory);
 	
+	//ͶӰʵֿ顢LOD㣬UObjectŶӵϷ߳
+	void GenerateMesh();
+	bool TickBuildTask(float DeltaTime);
+	//ͬʱһִ꣬첽ʱÿִ֡budget룻budgetΪ0ʱȫִУضǷѿ
+	void enqueueGameThreadTask(TUniqueFunction<void()>&& task);
+	bool runGameThreadTasks(double budget);
+	bool isBuildCancelled() const;
+	void setBuildProgress(const TCHAR* stage, float progress);
+	//¼start_timeڵĺʱͬ׶θ
+	void addStageTime(const TCHAR* stage, double start_time);
+	void writeBakeReport();
+	//õͼ
+	void getMeshImagePaths(TArray<FString>& image_paths) const;
+	//Ϸ߳ϴصָڸִкЧ
+	TSharedRef<UMaterialInterface*> enqueueLoadMaterial(const FString& material_name);
+	void enqueueSaveMesh(const FString& mesh_name, TSharedRef<UMaterialInterface*> material, TArray<FRawMesh>&& lod_meshes, int32 tile_index);
+	void enqueueReloadPrototype(const FString& mesh_name, int32 tile_index);
+
 	FVector Lonlat2Mercator(double lon,double lat, double height = 0.0);
 	void ProcessCoords(double ref_x = 0.0,double ref_y = 0.0);
+	bool isBuildingIndexReady() const;
+	FVector2D getProjectedLocation(const FVector& location) const;
+	void getQueryHits(TArrayView<const FBuildingHit> hits, TArray<FBuildingQueryHit>& query_hits) const;
 
 	void CreateWallMesh();
 	void CreateWallMesh_PMCImp();
 	void CreateWallMesh_RawMeshImp();
-	void divideRect_RawMeshImp(FVector cur_coord, FVector next_coord, double bottom, double top, FRawMesh& RawMesh);
+	//ǽ۽ֵm_wall_crease_angle
+	float getWallCreaseCos() const;
+	//m_wall_top_dism_wall_bottom_disĬϷֶ
+	void InitWallBands();
+	FWallBand MakeWallBand(const FString& name, const FString& mesh_name, const FString& material_name, float bottom, bool bottom_from_roof, float top, bool top_from_roof, int32 variant_count);
+	//ֶڸýϵʵʸ߶ȷΧ߶Ȳʱfalse
+	bool getWallBandRange(const FWallBand& band, double height, double& bottom, double& top) const;
 
 	void CreateRoofMesh();
 	void CreateRoofMesh_PMCImp();
 	void CreateRoofMesh_RawMeshImp();
-	void divideConvexPolygon_PMCImp(TArray<FVector> polygon, double height, TArray<FVector>& Vertex, TArray<int32>& Index, TArray<FVector2D>& UV);
-	void divideConvexPolygon_RawMeshImp(TArray<FVector> polygon, double height, FRawMesh& RawMesh);
-	void divideConcavePolygon_PMCImp(TArray<FVector> polygon, double height, TArray<FVector>& Vertex, TArray<int32>& Index, TArray<FVector2D>& UV);
-	void divideConcavePolygon_RawMeshImp(TArray<FVector> polygon, double height, FRawMesh& RawMesh);
+	//ӰùϣǽֶΡ۽ǡLOD뻯ݲ
+	uint64 getBuildSettingsHash() const;
+	//ÿֿݹϣԼLODаݶĹϣǻ棩
+	void getTileHashes(TArray<uint64>& tile_hashes, TSet<uint64>& roof_ring_hashes) const;
+	//ݹϣϴαʱͬķֿҪɣ
+	int32 getDirtyTiles(const FString& prefix, TArray<bool>& tile_dirty) const;
+	//ؽеwall_<>roof_<>Ӧ
+	void getCachedMeshPackages(const FString& cache_name, TArray<FString>& mesh_names) const;
+	//ɾ֮ǰ桢βɵڱɺϷ߳ϵ
+	void deleteMeshPackages(TArrayView<const FString> mesh_names);
+	//ֿڵindexָLOD
+	FBuildingView getTileBuilding(const FBuildingTile& tile, int32 index, int32 lod) const;
 
-	void SaveStaticMeshWithRawMesh(FString MeshName,FString MaterialName, FRawMesh RawMesh);
+	//ֿ񣬷ֿԭΧдԪ
+	UStaticMesh* SaveStaticMeshWithRawMesh(const FString& MeshName, UMaterialInterface* Material, TArrayView<FRawMesh> LodMeshes, const FBuildingTile& Tile);
+	//ԭͿHISMʵ任ãͳƽʡĶ
+	void AddPrototypeInstances(UStaticMesh* StaticMesh, int32 VertexCount, int32 WedgeCount, const FBuildingTile& Tile);
+	//Դİm_package_root/folder/asset_name
+	FString getPackageName(const TCHAR* folder, const FString& asset_name) const;
+	//ȡ֮ǰ񣬰ʱؿ
+	UStaticMesh* LoadSavedStaticMesh(const FString& MeshName);
+	//ȡͬͼʣͼʱؿ
+	UMaterialInterface* LoadMeshMaterial(const FString& MaterialName);
 
 	bool LoadImageToTexture2D(const FString& ImageName, UTexture2D*& InTexture, int32& Width, int32& Height);
 	UMaterialInterface* CreateMaterialInstanceDynamic(UTexture2D* InTexture,float Roughness,float Metallic );
-	UMaterialInterface* CreateMaterial(UTexture2D*& InTexture, FString material_name, float Roughness, float Metallic);
-
-	//ǷߵҲ
-	bool pointRightOfLine(FVector pStart, FVector pEnd, FVector point);
-	//Ƿ--ζΪ˳ʱ
-	bool pointInTriangle(TArray<FVector> triangle, FVector point);	
-	//߶ǷĳYཻ
-	FRaySegmentCrossType segmentCrossWithYFowardRayWithoutZ(FVector pStart, FVector pEnd, FVector point);
-	//߶߶Ƿཻ
-	bool isSegmentCrossWithoutZ(FVector pStart1, FVector pEnd1, FVector pStart2, FVector pEnd2);
-	// Ƿڶ
-	bool pointInPolygon(TArray<FVector> polygon, FVector point);
-	//ǷΪ͹
-	bool isConvexPoint(TArray<FVector> polygon, int32 index);
-	//ǷΪ͹
-	bool isConvexPolygon(TArray<FVector> polygon);
-	//ǷΪɷָ
-	bool isDivisiblePoint(TArray<FVector> polygon, int32 index);
-	//ǷΪĵ㣨ߵ㣩
-	bool isSurplusPoint(TArray<FVector> polygon, int32 index);
+	UMaterialInterface* CreateMaterial(UTexture2D*& InTexture, const FString& material_name, float Roughness, float Metallic);
+	//Դڵİɽʱͳһ棬ͬһֻдһ
+	void addDirtyPackage(UObject* Asset);
+	//Ϸ߳ϵãÿŶһ֮ȴ̨дɲصǷȫɹ
+	void enqueueSaveDirtyPackages(TUniqueFunction<void(bool)>&& on_saved);
+
 protected:
 	UPROPERTY(EditAnywhere)
 		UProceduralMeshComponent* wall_pmc;
 	UPROPERTY(EditAnywhere)
 		UProceduralMeshComponent* roof_pmc;
+	UPROPERTY()
+		TArray<UHierarchicalInstancedStaticMeshComponent*> instance_components;
+	UPROPERTY()
+		UBuildingBuildTask* build_task;
+	//Ѵͼʣͼ·ݹϣʲ
+	UPROPERTY()
+		TMap<FString, UTexture2D*> texture_cache;
+	UPROPERTY()
+		TMap<FString, UMaterialInterface*> material_cache;
+	//İԴ
+	UPROPERTY()
+		TMap<UPackage*, UObject*> dirty_packages;
 
 private:
 	FString m_file_path;
+	//ɵͼڵİĿ¼ĬΪ/Game
+	FString m_package_root;
 	TMap<int32, FGeoBuildingLayerInfo> m_building_layer_info;
-	TMap<int32, TArray<FBuildingInfo>> m_building_layer_data;
+	TMap<int32, FBuildingLayer> m_building_layer_data;
+	//ͶӰָm_building_layer_data½ʱ
+	FBuildingSpatialIndex m_building_index;
 	bool m_use_pmc;
+	bool m_use_stream_reader;
+	bool m_use_layer_cache;
 	float m_wall_top_dis;
 	float m_wall_bottom_dis;
+	float m_wall_crease_angle;
+	TArray<FWallBand> m_wall_bands;
+	int32 m_tile_max_vertices;
+	int32 m_tile_max_triangles;
+	int32 m_tile_max_depth;
+	TArray<FBuildingTile> m_building_tiles;
+	float m_lod_tolerance;
+	float m_lod_proxy_size;
+	TArray<float> m_lod_tolerance_scales;
+	TArray<float> m_lod_screen_sizes;
+	//1ʼĸLOD
+	TArray<TMap<int32, FBuildingLayer>> m_lod_building_data;
+	bool m_use_instancing;
+	//ʵظ״Ƚϵ
+	int32 m_instance_min_count;
+	float m_instance_quantize;
+	TMap<int32, FBuildingLayer> m_prototype_data;
+	TMap<int32, TArray<FBuildingInstances>> m_prototype_instances;
+	TArray<TMap<int32, FBuildingLayer>> m_lod_prototype_data;
+	int64 m_instance_saved_vertices;
+	int64 m_instance_saved_bytes;
+	bool m_use_rebuild_cache;
+	//PMCǰ㻺붥㣻̬񹹽ʱŻȾţFRawMesh
+	bool m_optimize_vertex_cache;
+	FBuildingRebuildCache m_rebuild_cache;
+	//m_building_tilesһһӦ
+	TArray<uint64> m_tile_hashes;
+	//ɵĿбΪյķֶλݶ񣬱ɺɾ֮ǰİ
+	TArray<FString> m_stale_mesh_names;
+	//첽ɣϷ߳ÿ֡ڱʱ
+	double m_game_thread_budget;
+	//̨߳Ϸ߳ϵı񶼻Ŷ
+	TQueue<TUniqueFunction<void()>, EQueueMode::Mpsc> m_game_thread_tasks;
+	FThreadSafeCounter m_enqueued_tasks;
+	FThreadSafeCounter m_finished_tasks;
+	FThreadSafeBool m_background_done;
+	bool m_build_succeeded;
+	TFuture<void> m_build_future;
+	FDelegateHandle m_build_ticker;
+	//̨ԤȽͼ·
+	TMap<FString, FDecodedImage> m_decoded_images;
+	int32 m_duplicate_package_saves;
+	TArray<TPair<FString, double>> m_stage_times;
+	FBuildingBakeReport m_bake_report;
 };
 
 
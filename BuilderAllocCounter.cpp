@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuilderAllocCounter.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+//תеõԭֻӼͷŵڴһ䣬˱ȫ͸
+class FCountingMalloc final : public FMalloc
+{
+public:
+	explicit FCountingMalloc(FMalloc* inner)
+		: m_inner(inner)
+	{
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		m_allocations.Increment();
+		m_bytes.Add(Count);
+		return m_inner->Malloc(Count, Alignment);
+	}
+	virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+	{
+		m_allocations.Increment();
+		m_bytes.Add(Count);
+		return m_inner->TryMalloc(Count, Alignment);
+	}
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		//Ҳһµķ
+		if (Count > 0)
+		{
+			m_allocations.Increment();
+			m_bytes.Add(Count);
+		}
+		return m_inner->Realloc(Original, Count, Alignment);
+	}
+	virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if (Count > 0)
+		{
+			m_allocations.Increment();
+			m_bytes.Add(Count);
+		}
+		return m_inner->TryRealloc(Original, Count, Alignment);
+	}
+	virtual void Free(void* Original) override
+	{
+		m_inner->Free(Original);
+	}
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+	{
+		return m_inner->QuantizeSize(Count, Alignment);
+	}
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+	{
+		return m_inner->GetAllocationSize(Original, SizeOut);
+	}
+	virtual void Trim(bool bTrimThreadCaches) override
+	{
+		m_inner->Trim(bTrimThreadCaches);
+	}
+	virtual void SetupTLSCachesOnCurrentThread() override
+	{
+		m_inner->SetupTLSCachesOnCurrentThread();
+	}
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+	{
+		m_inner->ClearAndDisableTLSCachesOnCurrentThread();
+	}
+	virtual void GetAllocatorStats(FGenericMemoryStats& out_Stats) override
+	{
+		m_inner->GetAllocatorStats(out_Stats);
+	}
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override
+	{
+		m_inner->DumpAllocatorStats(Ar);
+	}
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		return m_inner->IsInternallyThreadSafe();
+	}
+	virtual bool ValidateHeap() override
+	{
+		return m_inner->ValidateHeap();
+	}
+	virtual const TCHAR* GetDescriptiveName() override
+	{
+		return m_inner->GetDescriptiveName();
+	}
+
+	FMalloc* GetInner() const { return m_inner; }
+	uint64 GetAllocations() const { return m_allocations.GetValue(); }
+	uint64 GetAllocatedBytes() const { return m_bytes.GetValue(); }
+
+private:
+	FMalloc* m_inner;
+	FThreadSafeCounter64 m_allocations;
+	FThreadSafeCounter64 m_bytes;
+};
+
+//ͷţ滻ԭ߳̿ͨ
+static FCountingMalloc* GetCountingMalloc()
+{
+	static FCountingMalloc* counting_malloc = new FCountingMalloc(GMalloc);
+	return counting_malloc;
+}
+
+static FThreadSafeCounter GCountingScopes;
+
+FScopedAllocationCounter::FScopedAllocationCounter()
+{
+	FCountingMalloc* counting_malloc = GetCountingMalloc();
+	m_start_allocations = counting_malloc->GetAllocations();
+	m_start_bytes = counting_malloc->GetAllocatedBytes();
+	if (GCountingScopes.Increment() == 1 && GMalloc == counting_malloc->GetInner())
+	{
+		GMalloc = counting_malloc;
+	}
+}
+
+FScopedAllocationCounter::~FScopedAllocationCounter()
+{
+	FCountingMalloc* counting_malloc = GetCountingMalloc();
+	if (GCountingScopes.Decrement() == 0 && GMalloc == counting_malloc)
+	{
+		GMalloc = counting_malloc->GetInner();
+	}
+}
+
+uint64 FScopedAllocationCounter::GetAllocations() const
+{
+	return GetCountingMalloc()->GetAllocations() - m_start_allocations;
+}
+
+uint64 FScopedAllocationCounter::GetAllocatedBytes() const
+{
+	return GetCountingMalloc()->GetAllocatedBytes() - m_start_bytes;
+}
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//ͳڵĶѷֽ
+//ڼGMalloc滻Ϊת̵߳ķҲᱻ
+class FScopedAllocationCounter
+{
+public:
+	FScopedAllocationCounter();
+	~FScopedAllocationCounter();
+
+	uint64 GetAllocations() const;
+	uint64 GetAllocatedBytes() const;
+
+private:
+	uint64 m_start_allocations;
+	uint64 m_start_bytes;
+};
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+//к決ֻCoreJsonUObjectLinuxޱ༭
+[SupportedPlatforms(UnrealPlatformClass.Desktop)]
+public class BuildingBakeTarget : TargetRules
+{
+	public BuildingBakeTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Program;
+		LinkType = TargetLinkType.Monolithic;
+		LaunchModuleName = "BuildingBake";
+
+		bBuildDeveloperTools = false;
+		bBuildWithEditorOnlyData = false;
+		bCompileAgainstEngine = false;
+		bCompileAgainstCoreUObject = false;
+		bCompileAgainstApplicationCore = false;
+		bIsBuildingConsoleApplication = true;
+	}
+}
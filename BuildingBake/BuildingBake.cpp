@@ -0,0 +1,330 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "RequiredProgramMainCPPInclude.h"
+#include "BuildingGeometry.h"
+#include "BuildingLayer.h"
+#include "BuildingMeshChunks.h"
+#include "BuildingProjection.h"
+#include "BuildingBakeReport.h"
+#include "BuildingGltf.h"
+#include "BuildingVertexCache.h"
+#include "BuildingTiles.h"
+#include "BuildingInstances.h"
+#include "GeoJsonStreamReader.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Templates/UniquePtr.h"
+
+//к決BuildingBake -path=<Ŀ¼> [-output=<Ŀ¼>] [-format=obj|glb -quantize]
+//	[-no_vertex_cache] [-tile_vertices=65535] [-crease=30 -ref_lon=114.3 -ref_lat=30.6]
+//ֻʹüκģȡmap.jsonеͼ㣬ͶӰǽݶÿͼ㣨ָԤʱÿֿ飩дһOBJGLB
+//Ŀ¼дbake_report.jsonUObjectڹֱУͼʧʱ1
+IMPLEMENT_APPLICATION(BuildingBake, "BuildingBake");
+
+//ÿдôˢһλ
+const int32 bake_flush_count = 4096;
+
+//map.jsonеĽͼ㣺ļ
+static bool LoadBakeLayers(const FString& file_name, TArray<TPair<int32, FString>>& layers)
+{
+	FString map_json;
+	TSharedPtr<FJsonObject> root;
+	if (!FFileHelper::LoadFileToString(map_json, *file_name) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(map_json), root) || !root.IsValid())
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("load map json failed: %s"), *file_name);
+		return false;
+	}
+	const TSharedPtr<FJsonObject>* data;
+	const TArray<TSharedPtr<FJsonValue>>* layer_values;
+	if (!root->TryGetObjectField(TEXT("data"), data) || !data->Get()->TryGetArrayField(TEXT("layers"), layer_values))
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("map json has no layers: %s"), *file_name);
+		return false;
+	}
+	for (const TSharedPtr<FJsonValue>& layer_value : *layer_values)
+	{
+		const TSharedPtr<FJsonObject>* layer;
+		if (!layer_value->TryGetObject(layer) || layer->Get()->GetStringField(TEXT("geometryType")) != TEXT("GeoBuilding"))
+		{
+			continue;
+		}
+		layers.Emplace(layer->Get()->GetIntegerField(TEXT("id")), layer->Get()->GetStringField(TEXT("url")));
+	}
+	return true;
+}
+
+static bool WriteUtf8(FArchive& writer, FString& buffer)
+{
+	FTCHARToUTF8 utf8(*buffer);
+	writer.Serialize((void*)utf8.Get(), utf8.Length());
+	buffer.Reset();
+	return !writer.IsError();
+}
+
+//ûзߵֻдꣻPMCһ£ϵת
+static bool WriteLayerObj(const FString& file_name, const FPMCMeshChunk& wall, const FPMCMeshChunk& roof)
+{
+	TUniquePtr<FArchive> writer(IFileManager::Get().CreateFileWriter(*file_name));
+	if (!writer)
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("create obj failed: %s"), *file_name);
+		return false;
+	}
+
+	FString buffer;
+	const FPMCMeshChunk* meshes[] = { &wall, &roof };
+	const TCHAR* names[] = { TEXT("wall"), TEXT("roof") };
+	//OBJŴ1ʼݶǽ֮
+	int32 vertex_offset = 1;
+	for (int32 mesh_index = 0; mesh_index < 2; mesh_index++)
+	{
+		const FPMCMeshChunk& mesh = *meshes[mesh_index];
+		bool with_normals = mesh.Normals.Num() == mesh.Vertices.Num();
+		buffer += FString::Printf(TEXT("o %s\n"), names[mesh_index]);
+		for (int32 i = 0; i < mesh.Vertices.Num(); i++)
+		{
+			const FVector& vertex = mesh.Vertices[i];
+			buffer += FString::Printf(TEXT("v %.3f %.3f %.3f\nvt %.5f %.5f\n"), vertex.X, vertex.Y, vertex.Z, mesh.UV[i].X, mesh.UV[i].Y);
+			if (with_normals)
+			{
+				const FVector& normal = mesh.Normals[i];
+				buffer += FString::Printf(TEXT("vn %.4f %.4f %.4f\n"), normal.X, normal.Y, normal.Z);
+			}
+			if (i % bake_flush_count == 0 && !WriteUtf8(*writer, buffer))
+			{
+				return false;
+			}
+		}
+		for (int32 i = 0; i + 2 < mesh.Index.Num(); i += 3)
+		{
+			int32 a = mesh.Index[i] + vertex_offset;
+			int32 b = mesh.Index[i + 1] + vertex_offset;
+			int32 c = mesh.Index[i + 2] + vertex_offset;
+			buffer += with_normals ? FString::Printf(TEXT("f %d/%d/%d %d/%d/%d %d/%d/%d\n"), a, a, a, b, b, b, c, c, c)
+				: FString::Printf(TEXT("f %d/%d %d/%d %d/%d\n"), a, a, b, b, c, c);
+			if (i / 3 % bake_flush_count == 0 && !WriteUtf8(*writer, buffer))
+			{
+				return false;
+			}
+		}
+		vertex_offset += mesh.Vertices.Num();
+	}
+	return WriteUtf8(*writer, buffer) && writer->Close();
+}
+
+//׶κʱۼӵͬ׶
+static void AddBakeStageTime(TArray<TPair<FString, double>>& stage_times, const TCHAR* stage, double seconds)
+{
+	for (TPair<FString, double>& stage_time : stage_times)
+	{
+		if (stage_time.Key == stage)
+		{
+			stage_time.Value += seconds;
+			return;
+		}
+	}
+	stage_times.Emplace(stage, seconds);
+}
+
+struct FBakeOptions
+{
+	FString output;
+	float crease_cos = 1.0f;
+	bool glb = false;
+	bool quantize = false;
+	bool optimize_vertex_cache = true;
+};
+
+//һ齨ǽݶдһļdescribeӳԴͼеĽ
+static bool BakeBuildings(const FString& name, int32 layer_id, const FBuildingLayer& buildings, const FBakeOptions& options,
+	TFunctionRef<void(int32 index, FBuildingSlowRoof& building)> describe, FBuildingBakeReport& report, TArray<TPair<FString, double>>& stage_times)
+{
+	TArray<FBuildingChunk> chunks;
+	MakeBuildingChunks(layer_id, buildings, chunks);
+
+	double start_time = FPlatformTime::Seconds();
+	FPMCMeshChunk wall;
+	double count_time = 0.0;
+	FMeshSize wall_size = MakeWallMesh_PMC(chunks, options.crease_cos, wall, count_time);
+	report.wall.vertices += wall_size.vertices;
+	report.wall.triangles += wall_size.indices / 3;
+	report.wall.count_seconds += count_time - start_time;
+	report.wall.write_seconds += FPlatformTime::Seconds() - count_time;
+	AddBakeStageTime(stage_times, TEXT("wall"), FPlatformTime::Seconds() - start_time);
+
+	start_time = FPlatformTime::Seconds();
+	FPMCMeshChunk roof;
+	TArray<FRoofChunkTriangles> chunk_triangles;
+	FMeshSize roof_size = MakeRoofMesh_PMC(chunks, nullptr, chunk_triangles, roof, count_time);
+	report.roof.vertices += roof_size.vertices;
+	report.roof.triangles += roof_size.indices / 3;
+	report.roof.count_seconds += count_time - start_time;
+	report.roof.write_seconds += FPlatformTime::Seconds() - count_time;
+	report.AddRoofs(chunk_triangles, true, [&](int32 chunk_index, int32 i, FBuildingSlowRoof& building)
+	{
+		describe(chunks[chunk_index].begin + i, building);
+	});
+	AddBakeStageTime(stage_times, TEXT("roof"), FPlatformTime::Seconds() - start_time);
+
+	//ݶ߳ϣABuilderеݶһ
+	roof.Normals.Init(FVector(0.0f, 0.0f, 1.0f), roof.Vertices.Num());
+	if (options.optimize_vertex_cache)
+	{
+		start_time = FPlatformTime::Seconds();
+		OptimizePMCMesh(wall, report.vertex_cache);
+		OptimizePMCMesh(roof, report.vertex_cache);
+		AddBakeStageTime(stage_times, TEXT("vertex_cache"), FPlatformTime::Seconds() - start_time);
+	}
+
+	start_time = FPlatformTime::Seconds();
+	bool succeeded = false;
+	FString file_name = options.output / name + (options.glb ? TEXT(".glb") : TEXT(".obj"));
+	if (options.glb)
+	{
+		FBuildingGltfMesh meshes[] = { MakeGltfMesh(name + TEXT("_wall"), wall), MakeGltfMesh(name + TEXT("_roof"), roof) };
+		succeeded = WriteBuildingGlb(file_name, meshes, options.quantize);
+	}
+	else
+	{
+		succeeded = WriteLayerObj(file_name, wall, roof);
+	}
+	AddBakeStageTime(stage_times, TEXT("write"), FPlatformTime::Seconds() - start_time);
+	UE_LOG(LogBuildingCore, Display, TEXT("bake %s: %d buildings, wall %d / roof %d triangles -> %s"),
+		*name, buildings.Num(), wall_size.indices / 3, roof_size.indices / 3, *file_name);
+	return succeeded;
+}
+
+//ͶӰдļؽ˳
+static int32 RunBake(const TCHAR* Params)
+{
+	FString path;
+	if (!FParse::Value(Params, TEXT("-path="), path))
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("usage: BuildingBake -path=<dir> [-output=<dir>] [-format=obj|glb] [-quantize] [-no_vertex_cache] [-tile_vertices=65535] [-crease=30] [-ref_lon=114.3 -ref_lat=30.6]"));
+		return 1;
+	}
+	FBakeOptions options;
+	options.output = FPaths::ProjectSavedDir() / TEXT("BuildingBake");
+	FString format = TEXT("obj");
+	float crease_angle = 30.0f;
+	int32 tile_vertices = 0;
+	double ref_lon = 114.3;
+	double ref_lat = 30.6;
+	FParse::Value(Params, TEXT("-output="), options.output);
+	FParse::Value(Params, TEXT("-format="), format);
+	FParse::Value(Params, TEXT("-crease="), crease_angle);
+	FParse::Value(Params, TEXT("-tile_vertices="), tile_vertices);
+	FParse::Value(Params, TEXT("-ref_lon="), ref_lon);
+	FParse::Value(Params, TEXT("-ref_lat="), ref_lat);
+	options.glb = format == TEXT("glb");
+	options.quantize = FParse::Param(Params, TEXT("quantize"));
+	options.optimize_vertex_cache = !FParse::Param(Params, TEXT("no_vertex_cache"));
+	options.crease_cos = FMath::Cos(FMath::DegreesToRadians(crease_angle));
+	IFileManager::Get().MakeDirectory(*options.output, true);
+
+	TArray<TPair<int32, FString>> layers;
+	if (!LoadBakeLayers(path / TEXT("map.json"), layers))
+	{
+		return 1;
+	}
+
+	double ref_north, ref_east;
+	LonLatToMercator(ref_lon, ref_lat, ref_north, ref_east);
+
+	FBuildingBakeReport report;
+	TArray<TPair<FString, double>> stage_times;
+	TMap<int32, FBuildingLayer> layer_data;
+	int32 failed_count = 0;
+	for (const TPair<int32, FString>& layer_info : layers)
+	{
+		int32 layer_id = layer_info.Key;
+		FString file_name = path / layer_info.Value;
+
+		double start_time = FPlatformTime::Seconds();
+		FBuildingLayer layer;
+		FGeoJsonStreamReader reader;
+		{
+			SCOPE_CYCLE_COUNTER(STAT_BuildingParse);
+			if (!reader.Open(file_name) || !reader.ReadBuildings(layer))
+			{
+				UE_LOG(LogBuildingCore, Error, TEXT("parse layer %d failed: %s %s"), layer_id, *file_name, *reader.GetError());
+				failed_count++;
+				continue;
+			}
+		}
+		reader.Close();
+		AddBakeStageTime(stage_times, TEXT("parse"), FPlatformTime::Seconds() - start_time);
+
+		start_time = FPlatformTime::Seconds();
+		{
+			SCOPE_CYCLE_COUNTER(STAT_BuildingProjection);
+			ProjectBuildingLayer(layer, ref_north, ref_east);
+		}
+		AddBakeStageTime(stage_times, TEXT("projection"), FPlatformTime::Seconds() - start_time);
+		report.buildings += layer.Num();
+		report.vertices += layer.NumCoords();
+		layer_data.Add(layer_id, MoveTemp(layer));
+	}
+
+	if (tile_vertices <= 0)
+	{
+		for (auto it_layer_data = layer_data.begin(); it_layer_data != layer_data.end(); ++it_layer_data)
+		{
+			int32 layer_id = it_layer_data->Key;
+			const FBuildingLayer& layer = it_layer_data->Value;
+			bool succeeded = BakeBuildings(FString::Printf(TEXT("layer_%d"), layer_id), layer_id, layer, options, [&](int32 index, FBuildingSlowRoof& building)
+			{
+				building.layer_id = layer_id;
+				building.building_index = index;
+				building.code = layer.GetCode(index);
+				building.vertices = layer.GetRingSize(index);
+			}, report, stage_times);
+			failed_count += succeeded ? 0 : 1;
+		}
+	}
+	else
+	{
+		//Ԥֿ飬Ԥ㲻65535ʱÿ鶼ʹ16λ
+		double start_time = FPlatformTime::Seconds();
+		FBuildingTileBudget budget;
+		budget.max_vertices = tile_vertices;
+		budget.max_triangles = tile_vertices * 2;
+		budget.max_depth = 16;
+		TArray<FBuildingTile> tiles;
+		MakeBuildingTiles(layer_data, TMap<int32, TArray<FBuildingInstances>>(), budget, tiles);
+		AddBakeStageTime(stage_times, TEXT("tiles"), FPlatformTime::Seconds() - start_time);
+
+		for (const FBuildingTile& tile : tiles)
+		{
+			FBuildingLayer tile_buildings;
+			for (int32 k = 0; k < tile.building_indices.Num(); k++)
+			{
+				FBuildingView building = layer_data[tile.layer_ids[k]][tile.building_indices[k]];
+				tile_buildings.AddBuilding(building.code, building.height, building.coords);
+			}
+			bool succeeded = BakeBuildings(TEXT("tile_") + tile.name, 0, tile_buildings, options, [&](int32 index, FBuildingSlowRoof& building)
+			{
+				building.layer_id = tile.layer_ids[index];
+				building.building_index = tile.building_indices[index];
+				building.code = tile_buildings.GetCode(index);
+				building.vertices = tile_buildings.GetRingSize(index);
+			}, report, stage_times);
+			failed_count += succeeded ? 0 : 1;
+		}
+	}
+
+	WriteBakeReport(options.output / TEXT("bake_report.json"), report, stage_times);
+	return failed_count > 0 ? 1 : 0;
+}
+
+INT32_MAIN_INT32_ARGC_TCHAR_ARGV()
+{
+	GEngineLoop.PreInit(ArgC, ArgV);
+	int32 result = RunBake(FCommandLine::Get());
+	FEngineLoop::AppPreExit();
+	FModuleManager::Get().UnloadModulesAtShutdown();
+	FEngineLoop::AppExit();
+	return result;
+}
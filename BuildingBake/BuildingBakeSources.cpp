@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+//buildingbuilderģ鹲õļκġֿЩļֻCoreJsonκUObject
+#include "../BuildingLayer.cpp"
+#include "../BuildingProjection.cpp"
+#include "../BuildingScratch.cpp"
+#include "../PolygonTriangulator.cpp"
+#include "../BuildingMeshChunks.cpp"
+#include "../BuildingRebuildCache.cpp"
+#include "../BuildingBakeReport.cpp"
+#include "../BuildingGeometry.cpp"
+#include "../GeoJsonStreamReader.cpp"
+#include "../BuildingVertexCache.cpp"
+#include "../BuildingInstances.cpp"
+#include "../BuildingTiles.cpp"
+#include "../BuildingGltf.cpp"
@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingBakeReport.h"
+#include "BuildingMeshChunks.h"
+#include "BuildingGeometry.h"
+#include "BuildingVertexCache.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_STAT(STAT_BuildingParse);
+DEFINE_STAT(STAT_BuildingProjection);
+DEFINE_STAT(STAT_BuildingMeshCount);
+DEFINE_STAT(STAT_BuildingMeshFill);
+DEFINE_STAT(STAT_BuildingStaticMeshBuild);
+DEFINE_STAT(STAT_BuildingImageDecode);
+DEFINE_STAT(STAT_BuildingSave);
+
+DEFINE_STAT(STAT_BuildingBuildings);
+DEFINE_STAT(STAT_BuildingVertices);
+DEFINE_STAT(STAT_BuildingTriangles);
+DEFINE_STAT(STAT_BuildingConvexRoofs);
+DEFINE_STAT(STAT_BuildingConcaveRoofs);
+
+//б
+const int32 bake_report_slowest_count = 20;
+
+void FBuildingBakeReport::AddSlowRoof(const FBuildingSlowRoof& roof)
+{
+	if (slowest_roofs.Num() == bake_report_slowest_count && slowest_roofs.Last().milliseconds >= roof.milliseconds)
+	{
+		return;
+	}
+	int32 index = 0;
+	while (index < slowest_roofs.Num() && slowest_roofs[index].milliseconds >= roof.milliseconds)
+	{
+		index++;
+	}
+	slowest_roofs.Insert(roof, index);
+	if (slowest_roofs.Num() > bake_report_slowest_count)
+	{
+		slowest_roofs.Pop(false);
+	}
+}
+
+void FBuildingBakeReport::AddRoofs(TArrayView<const FRoofChunkTriangles> roofs, bool lod0, TFunctionRef<void(int32 roof_index, int32 i, FBuildingSlowRoof& building)> describe)
+{
+	for (int32 roof_index = 0; roof_index < roofs.Num(); roof_index++)
+	{
+		const FRoofChunkTriangles& roof = roofs[roof_index];
+		convex_test_seconds += FPlatformTime::ToSeconds64(roof.convex_test_cycles);
+		ear_clipping_seconds += FPlatformTime::ToSeconds64(roof.ear_clipping_cycles);
+		if (!lod0)
+		{
+			continue;
+		}
+		//δɵķֿûм
+		for (int32 i = 0; i < roof.convex.Num(); i++)
+		{
+			convex_roofs += roof.convex[i] ? 1 : 0;
+			concave_roofs += roof.convex[i] ? 0 : 1;
+			failed_roofs += !roof.convex[i] && roof.offsets[i + 1] == roof.offsets[i] ? 1 : 0;
+		}
+		triangulated_roofs += roof.triangulated.Num();
+		for (int32 k = 0; k < roof.triangulated.Num(); k++)
+		{
+			FBuildingSlowRoof building;
+			building.milliseconds = FPlatformTime::ToMilliseconds64(roof.triangulate_cycles[k]);
+			describe(roof_index, roof.triangulated[k].Value, building);
+			AddSlowRoof(building);
+		}
+	}
+}
+
+static TSharedRef<FJsonObject> MakeEmissionJson(const FBuildingEmissionStats& stats)
+{
+	TSharedRef<FJsonObject> object = MakeShared<FJsonObject>();
+	object->SetNumberField(TEXT("vertices"), (double)stats.vertices);
+	object->SetNumberField(TEXT("triangles"), (double)stats.triangles);
+	object->SetNumberField(TEXT("count_seconds"), stats.count_seconds);
+	object->SetNumberField(TEXT("write_seconds"), stats.write_seconds);
+	object->SetNumberField(TEXT("peak_memory_mb"), stats.peak_memory / (1024.0 * 1024.0));
+	return object;
+}
+
+TSharedRef<FJsonObject> MakeBakeReportJson(const FBuildingBakeReport& report, TArrayView<const TPair<FString, double>> stage_times)
+{
+	TSharedRef<FJsonObject> stages = MakeShared<FJsonObject>();
+	double total_seconds = 0.0;
+	for (const TPair<FString, double>& stage_time : stage_times)
+	{
+		stages->SetNumberField(stage_time.Key, stage_time.Value);
+		total_seconds += stage_time.Value;
+	}
+
+	TSharedRef<FJsonObject> roofs = MakeShared<FJsonObject>();
+	roofs->SetNumberField(TEXT("convex"), report.convex_roofs);
+	roofs->SetNumberField(TEXT("concave"), report.concave_roofs);
+	roofs->SetNumberField(TEXT("triangulated"), report.triangulated_roofs);
+	roofs->SetNumberField(TEXT("failed"), report.failed_roofs);
+	roofs->SetNumberField(TEXT("convex_test_seconds"), report.convex_test_seconds);
+	roofs->SetNumberField(TEXT("ear_clipping_seconds"), report.ear_clipping_seconds);
+
+	TArray<TSharedPtr<FJsonValue>> slowest;
+	for (const FBuildingSlowRoof& roof : report.slowest_roofs)
+	{
+		TSharedRef<FJsonObject> object = MakeShared<FJsonObject>();
+		object->SetNumberField(TEXT("layer"), roof.layer_id);
+		object->SetNumberField(TEXT("index"), roof.building_index);
+		object->SetNumberField(TEXT("code"), roof.code);
+		object->SetNumberField(TEXT("vertices"), roof.vertices);
+		object->SetNumberField(TEXT("milliseconds"), roof.milliseconds);
+		slowest.Add(MakeShared<FJsonValueObject>(object));
+	}
+
+	const FBuildingVertexCacheStats& cache = report.vertex_cache;
+	TSharedRef<FJsonObject> vertex_cache = MakeShared<FJsonObject>();
+	vertex_cache->SetNumberField(TEXT("triangles"), (double)cache.triangles);
+	vertex_cache->SetNumberField(TEXT("acmr_before"), cache.triangles > 0 ? (double)cache.misses_before / cache.triangles : 0.0);
+	vertex_cache->SetNumberField(TEXT("acmr_after"), cache.triangles > 0 ? (double)cache.misses_after / cache.triangles : 0.0);
+	vertex_cache->SetNumberField(TEXT("seconds"), cache.seconds);
+
+	FPlatformMemoryStats memory = FPlatformMemory::GetStats();
+	TSharedRef<FJsonObject> root = MakeShared<FJsonObject>();
+	root->SetStringField(TEXT("date"), FDateTime::UtcNow().ToIso8601());
+	root->SetObjectField(TEXT("stages"), stages);
+	root->SetNumberField(TEXT("total_seconds"), total_seconds);
+	root->SetNumberField(TEXT("buildings"), report.buildings);
+	root->SetNumberField(TEXT("vertices"), (double)report.vertices);
+	root->SetNumberField(TEXT("triangles"), (double)(report.wall.triangles + report.roof.triangles));
+	root->SetObjectField(TEXT("wall"), MakeEmissionJson(report.wall));
+	root->SetObjectField(TEXT("roof"), MakeEmissionJson(report.roof));
+	root->SetObjectField(TEXT("roofs"), roofs);
+	root->SetObjectField(TEXT("vertex_cache"), vertex_cache);
+	root->SetNumberField(TEXT("static_meshes"), report.static_meshes);
+	root->SetNumberField(TEXT("static_mesh_build_seconds"), report.static_mesh_build_seconds);
+	root->SetNumberField(TEXT("peak_memory_mb"), memory.PeakUsedPhysical / (1024.0 * 1024.0));
+	root->SetArrayField(TEXT("slowest_roofs"), slowest);
+	return root;
+}
+
+bool WriteBakeReport(const FString& file_name, const FBuildingBakeReport& report, TArrayView<const TPair<FString, double>> stage_times)
+{
+	SET_DWORD_STAT(STAT_BuildingBuildings, report.buildings);
+	SET_DWORD_STAT(STAT_BuildingVertices, report.vertices);
+	SET_DWORD_STAT(STAT_BuildingTriangles, report.wall.triangles + report.roof.triangles);
+	SET_DWORD_STAT(STAT_BuildingConvexRoofs, report.convex_roofs);
+	SET_DWORD_STAT(STAT_BuildingConcaveRoofs, report.concave_roofs);
+
+	FString stage_text;
+	for (const TPair<FString, double>& stage_time : stage_times)
+	{
+		stage_text += FString::Printf(TEXT(" %s %.3f"), *stage_time.Key, stage_time.Value);
+	}
+	UE_LOG(LogBuildingCore, Log, TEXT("bake stages (s):%s"), *stage_text);
+	UE_LOG(LogBuildingCore, Log, TEXT("bake: %d buildings, %lld vertices, %lld triangles, %d convex / %d concave roofs, convex test %.3f s, ear clipping %.3f s, %d static meshes built in %.3f s"),
+		report.buildings, report.vertices, report.wall.triangles + report.roof.triangles, report.convex_roofs, report.concave_roofs,
+		report.convex_test_seconds, report.ear_clipping_seconds, report.static_meshes, report.static_mesh_build_seconds);
+	if (report.vertex_cache.triangles > 0)
+	{
+		const FBuildingVertexCacheStats& cache = report.vertex_cache;
+		UE_LOG(LogBuildingCore, Log, TEXT("vertex cache: %lld triangles, ACMR %.3f -> %.3f (cache %d), %.3f s"), cache.triangles,
+			(double)cache.misses_before / cache.triangles, (double)cache.misses_after / cache.triangles, vertex_cache_size, cache.seconds);
+	}
+
+	FString json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+	if (!FJsonSerializer::Serialize(MakeBakeReportJson(report, stage_times), writer) || !FFileHelper::SaveStringToFile(json, *file_name))
+	{
+		UE_LOG(LogBuildingCore, Warning, TEXT("write bake report failed: %s"), *file_name);
+		return false;
+	}
+	return true;
+}
+
+FString GetBakeReportFileName()
+{
+	return FPaths::ProjectSavedDir() + "BuildingCache/bake_report.json";
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+class FJsonObject;
+struct FRoofChunkTriangles;
+
+//stat BuildingBuilder׶μʱͬʱΪCPU¼ʾUnreal Insights
+DECLARE_STATS_GROUP(TEXT("BuildingBuilder"), STATGROUP_BuildingBuilder, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Parse"), STAT_BuildingParse, STATGROUP_BuildingBuilder, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projection"), STAT_BuildingProjection, STATGROUP_BuildingBuilder, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh count"), STAT_BuildingMeshCount, STATGROUP_BuildingBuilder, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh fill"), STAT_BuildingMeshFill, STATGROUP_BuildingBuilder, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("StaticMesh build"), STAT_BuildingStaticMeshBuild, STATGROUP_BuildingBuilder, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Image decode"), STAT_BuildingImageDecode, STATGROUP_BuildingBuilder, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Save packages"), STAT_BuildingSave, STATGROUP_BuildingBuilder, );
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Buildings"), STAT_BuildingBuildings, STATGROUP_BuildingBuilder, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Vertices"), STAT_BuildingVertices, STATGROUP_BuildingBuilder, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Triangles"), STAT_BuildingTriangles, STATGROUP_BuildingBuilder, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Convex roofs"), STAT_BuildingConvexRoofs, STATGROUP_BuildingBuilder, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Concave roofs"), STAT_BuildingConcaveRoofs, STATGROUP_BuildingBuilder, );
+
+//ͳƣLODۼ
+struct FBuildingEmissionStats
+{
+	int64 vertices = 0;
+	int64 triangles = 0;
+	//ݶǻдݵĺʱ
+	double count_seconds = 0.0;
+	double write_seconds = 0.0;
+	//ɹڴ
+	uint64 peak_memory = 0;
+};
+
+//Ķ㻺Żģ⻺ͳŻǰδдΪACMR
+struct FBuildingVertexCacheStats
+{
+	int64 triangles = 0;
+	int64 misses_before = 0;
+	int64 misses_after = 0;
+	double seconds = 0.0;
+
+	FBuildingVertexCacheStats& operator+=(const FBuildingVertexCacheStats& other)
+	{
+		triangles += other.triangles;
+		misses_before += other.misses_before;
+		misses_after += other.misses_after;
+		seconds += other.seconds;
+		return *this;
+	}
+};
+
+//ǻʱϳĽ
+struct FBuildingSlowRoof
+{
+	int32 layer_id = 0;
+	int32 building_index = 0;
+	int32 code = 0;
+	int32 vertices = 0;
+	double milliseconds = 0.0;
+};
+
+//һκ決ͳƣɽд뱨
+struct FBuildingBakeReport
+{
+	int32 buildings = 0;
+	int64 vertices = 0;
+	//LOD0ݶ͹ΡΣбζеǻʧܵ
+	int32 convex_roofs = 0;
+	int32 concave_roofs = 0;
+	int32 triangulated_roofs = 0;
+	int32 failed_roofs = 0;
+	//߳ۼӵ͹кʱLOD
+	double convex_test_seconds = 0.0;
+	double ear_clipping_seconds = 0.0;
+	FBuildingEmissionStats wall;
+	FBuildingEmissionStats roof;
+	//ֻͳPMCе񣬾̬湹
+	FBuildingVertexCacheStats vertex_cache;
+	int32 static_meshes = 0;
+	double static_mesh_build_seconds = 0.0;
+	//ʱӴС
+	TArray<FBuildingSlowRoof> slowest_roofs;
+
+	void AddSlowRoof(const FBuildingSlowRoof& roof);
+	//ݶ׶ε͹кʱLOD0ʱͳư͹Ľdescribeдڵiͼ㡢
+	void AddRoofs(TArrayView<const FRoofChunkTriangles> roofs, bool lod0, TFunctionRef<void(int32 roof_index, int32 i, FBuildingSlowRoof& building)> describe);
+};
+
+TSharedRef<FJsonObject> MakeBakeReportJson(const FBuildingBakeReport& report, TArrayView<const TPair<FString, double>> stage_times);
+//дJSON沢׶κʱ־ͬʱstat
+bool WriteBakeReport(const FString& file_name, const FBuildingBakeReport& report, TArrayView<const TPair<FString, double>> stage_times);
+FString GetBakeReportFileName();
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using System.IO;
+using UnrealBuildTool;
+
+public class BuildingBenchmark : ModuleRules
+{
+	public BuildingBenchmark(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PublicIncludePaths.Add("Runtime/Launch/Public");
+		PrivateIncludePaths.Add("Runtime/Launch/Private");
+
+		//ļλbuildingbuilderģĿ¼BuildingBenchmarkSources.cpp뱾
+		PrivateIncludePaths.Add(Path.GetFullPath(Path.Combine(ModuleDirectory, "..")));
+
+		PrivateDependencyModuleNames.AddRange(new string[] {
+			"Core",
+			"Json",
+			"Projects"
+		});
+	}
+}
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+//κĵܲԳֻCoreJsonUObjectԴBuildingCityBenchmarkй߲
+[SupportedPlatforms(UnrealPlatformClass.Desktop)]
+public class BuildingBenchmarkTarget : TargetRules
+{
+	public BuildingBenchmarkTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Program;
+		LinkType = TargetLinkType.Monolithic;
+		LaunchModuleName = "BuildingBenchmark";
+
+		bBuildDeveloperTools = false;
+		bBuildWithEditorOnlyData = false;
+		bCompileAgainstEngine = false;
+		bCompileAgainstCoreUObject = false;
+		bCompileAgainstApplicationCore = false;
+		bIsBuildingConsoleApplication = true;
+	}
+}
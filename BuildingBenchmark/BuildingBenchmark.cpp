@@ -0,0 +1,398 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "RequiredProgramMainCPPInclude.h"
+#include "PolygonTriangulator.h"
+#include "BuildingProjection.h"
+#include "BuildingLayer.h"
+#include "BuildingGeometry.h"
+#include "BuildingMeshChunks.h"
+#include "BuilderAllocCounter.h"
+#include "BuildingScratch.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformTime.h"
+
+//κĵܲԣBuildingBenchmark [-bench=triangulation|projection|layer|mesh]
+//Ĭȫԣ־Դ̼UBuildingCityBenchmarkCommandlet
+DEFINE_LOG_CATEGORY_STATIC(LogBuildingBenchmark, Log, All);
+
+IMPLEMENT_APPLICATION(BuildingBenchmark, "BuildingBenchmark");
+
+//ÿԴĶ֤СҲ㹻ظ
+const int32 benchmark_vertex_budget = 2000000;
+
+static void RunTriangulationBenchmark()
+{
+	const int32 vertex_counts[] = { 4, 16, 64, 256, 1024, 4096, 10000 };
+
+	UE_LOG(LogBuildingBenchmark, Display, TEXT("triangulation: vertices, iterations, us/polygon, ns/vertex, triangles, heap allocations/polygon"));
+	TArray<int32> triangles;
+	for (int32 count : vertex_counts)
+	{
+		//Σһ붥Ϊ
+		TArray<FVector2D> polygon;
+		polygon.Reserve(count);
+		for (int32 i = 0; i < count; i++)
+		{
+			double angle = 2.0 * PI * i / count;
+			double radius = i % 2 == 0 ? 100.0 : 60.0;
+			polygon.Add(FVector2D(radius * FMath::Cos(angle), radius * FMath::Sin(angle)));
+		}
+
+		//ݶͬÿһݴ
+		int32 iterations = FMath::Max(1, benchmark_vertex_budget / count);
+		triangles.Reserve((count - 2) * 3);
+		double start_time = FPlatformTime::Seconds();
+		uint64 allocations;
+		{
+			FScopedAllocationCounter counter;
+			for (int32 i = 0; i < iterations; i++)
+			{
+				FBuildingScratchMark scratch_mark;
+				triangles.Reset();
+				FPolygonTriangulator().Triangulate(polygon, triangles);
+			}
+			allocations = counter.GetAllocations();
+		}
+		double seconds = FPlatformTime::Seconds() - start_time;
+
+		UE_LOG(LogBuildingBenchmark, Display, TEXT("triangulation: %6d, %8d, %10.2f, %8.2f, %6d, %.3f"),
+			count, iterations, seconds * 1e6 / iterations, seconds * 1e9 / ((double)iterations * count), triangles.Num() / 3,
+			(double)allocations / iterations);
+	}
+}
+
+//ԭеͶӰγȾfloatת
+static FVector LegacyLonlat2Mercator(double lon, double lat)
+{
+	FVector mercator;
+	mercator.Y = lon * PI / 180 * earth_radius;
+	float alpha = lat * PI / 180;
+	mercator.X = earth_radius / 2 * log((1.0 + sin(alpha)) / (1.0 - sin(alpha)));
+	mercator.Z = 0.0f;
+	return mercator;
+}
+
+static void RunProjectionBenchmark()
+{
+	//зΧڵ㣬οȡΧģProcessCoords÷һ£ȡ˫ȣGeoJSONõԴͬ
+	const int32 count = benchmark_vertex_budget;
+	const double ref_lon = 116.4;
+	const double ref_lat = 39.9;
+	FRandomStream random(0);
+	TArray<double> lon, lat;
+	lon.SetNumUninitialized(count);
+	lat.SetNumUninitialized(count);
+	for (int32 i = 0; i < count; i++)
+	{
+		lon[i] = ref_lon + random.GetUnsignedInt() / 4294967296.0 - 0.5;
+		lat[i] = ref_lat + random.GetUnsignedInt() / 4294967296.0 - 0.5;
+	}
+	double ref_north, ref_east;
+	LonLatToMercator(ref_lon, ref_lat, ref_north, ref_east);
+
+	TArray<double> reference_north, reference_east;
+	reference_north.SetNumUninitialized(count);
+	reference_east.SetNumUninitialized(count);
+	ProjectMercatorScalar(lon.GetData(), lat.GetData(), count, ref_north, ref_east, reference_north.GetData(), reference_east.GetData());
+
+	UE_LOG(LogBuildingBenchmark, Display, TEXT("projection: method, Mvertices/s, max error (m); kernel %s"), GetMercatorKernelName());
+	TArray<double> north, east;
+	north.SetNumUninitialized(count);
+	east.SetNumUninitialized(count);
+	auto report = [&](const TCHAR* method, double seconds)
+	{
+		double max_error = 0.0;
+		for (int32 i = 0; i < count; i++)
+		{
+			max_error = FMath::Max(max_error, FMath::Max(FMath::Abs(north[i] - reference_north[i]), FMath::Abs(east[i] - reference_east[i])));
+		}
+		UE_LOG(LogBuildingBenchmark, Display, TEXT("projection: %-10s, %8.2f, %.3e"), method, count / seconds * 1e-6, max_error);
+	};
+
+	double start_time = FPlatformTime::Seconds();
+	FVector legacy_ref = LegacyLonlat2Mercator(ref_lon, ref_lat);
+	for (int32 i = 0; i < count; i++)
+	{
+		FVector point = LegacyLonlat2Mercator(lon[i], lat[i]) - legacy_ref;
+		north[i] = point.X;
+		east[i] = point.Y;
+	}
+	report(TEXT("legacy"), FPlatformTime::Seconds() - start_time);
+
+	start_time = FPlatformTime::Seconds();
+	ProjectMercatorScalar(lon.GetData(), lat.GetData(), count, ref_north, ref_east, north.GetData(), east.GetData());
+	report(TEXT("scalar"), FPlatformTime::Seconds() - start_time);
+
+	start_time = FPlatformTime::Seconds();
+	ProjectMercator(lon.GetData(), lat.GetData(), count, ref_north, ref_east, north.GetData(), east.GetData());
+	report(TEXT("simd"), FPlatformTime::Seconds() - start_time);
+
+	//ProcessCoordsͬĲ
+	const int32 block_size = 1024;
+	start_time = FPlatformTime::Seconds();
+	ParallelFor(FMath::DivideAndRoundUp(count, block_size), [&](int32 block)
+	{
+		int32 begin = block * block_size;
+		int32 block_count = FMath::Min(block_size, count - begin);
+		ProjectMercator(&lon[begin], &lat[begin], block_count, ref_north, ref_east, &north[begin], &east[begin]);
+	});
+	report(TEXT("simd x mt"), FPlatformTime::Seconds() - start_time);
+
+	//γתΪͶӰ֮ǰͼֻ浥ʱ
+	TArray<double> float_lon, float_lat;
+	float_lon.SetNumUninitialized(count);
+	float_lat.SetNumUninitialized(count);
+	for (int32 i = 0; i < count; i++)
+	{
+		float_lon[i] = (float)lon[i];
+		float_lat[i] = (float)lat[i];
+	}
+	start_time = FPlatformTime::Seconds();
+	ProjectMercator(float_lon.GetData(), float_lat.GetData(), count, ref_north, ref_east, north.GetData(), east.GetData());
+	report(TEXT("float in"), FPlatformTime::Seconds() - start_time);
+
+	//̣ͼ㱣˫Դ꣬ͶӰдصȵĻֻ꣬ĵ
+	const int32 ring_size = 16;
+	FBuildingLayer layer;
+	TArray<double> ring;
+	for (int32 begin = 0; begin < count; begin += ring_size)
+	{
+		ring.Reset();
+		for (int32 i = begin; i < FMath::Min(begin + ring_size, count); i++)
+		{
+			ring.Add(lon[i]);
+			ring.Add(lat[i]);
+		}
+		layer.AddSourceBuilding(0, 0.0, ring);
+	}
+	start_time = FPlatformTime::Seconds();
+	ProjectBuildingLayer(layer, ref_north, ref_east);
+	double layer_seconds = FPlatformTime::Seconds() - start_time;
+	TArrayView<const FVector2D> coords = layer.GetCoords();
+	for (int32 i = 0; i < count; i++)
+	{
+		north[i] = coords[i].X;
+		east[i] = coords[i].Y;
+	}
+	report(TEXT("layer"), layer_seconds);
+}
+
+//ԭеÿһ󡢸ԳĴ洢ʽ
+struct FLegacyBuildingInfo
+{
+	int32 code;
+	double height;
+	TArray<FVector> coords;
+};
+
+//ǽ׶ͬķʷʽ𶰱ÿߣۼӱ߳۽
+template<typename RingType>
+static void AccumulateRing(const RingType& ring, double& length, int32& creases)
+{
+	int32 count = ring.Num();
+	for (int32 i = 0; i < count; i++)
+	{
+		int32 next_index = i + 1 == count ? 0 : i + 1;
+		int32 pre_index = i == 0 ? count - 1 : i - 1;
+		double dx = (double)ring[next_index].X - ring[i].X;
+		double dy = (double)ring[next_index].Y - ring[i].Y;
+		double pre_dx = (double)ring[i].X - ring[pre_index].X;
+		double pre_dy = (double)ring[i].Y - ring[pre_index].Y;
+		length += FMath::Sqrt(dx * dx + dy * dy);
+		creases += dx * pre_dx + dy * pre_dy < 0.0 ? 1 : 0;
+	}
+}
+
+static void RunLayerBenchmark()
+{
+	const int32 building_count = 1000000;
+	//ÿ412Ĳ򻷣гɳн
+	FRandomStream random(2024);
+	TArray<int32> ring_sizes;
+	ring_sizes.SetNumUninitialized(building_count);
+	for (int32 i = 0; i < building_count; i++)
+	{
+		ring_sizes[i] = random.RandRange(4, 12);
+	}
+	auto make_ring = [](int32 building_index, int32 count, TArray<FVector2D>& ring)
+	{
+		ring.Reset(count);
+		double x = (building_index % 1000) * 30.0;
+		double y = (building_index / 1000) * 30.0;
+		for (int32 k = 0; k < count; k++)
+		{
+			double angle = 2.0 * PI * k / count;
+			double radius = k % 2 == 0 ? 10.0 : 8.0;
+			ring.Add(FVector2D(x + radius * FMath::Cos(angle), y + radius * FMath::Sin(angle)));
+		}
+	};
+
+	UE_LOG(LogBuildingBenchmark, Display, TEXT("layer: store, build s, allocations, bytes/building, pass Mbuildings/s, pass mt Mbuildings/s"));
+	TArray<FVector2D> ring;
+	//accumulate_buildings[begin, end)ڵĽ
+	auto report = [&](const TCHAR* store, double build_seconds, uint64 allocations, SIZE_T bytes,
+		TFunctionRef<void(int32, int32, double&, int32&)> accumulate_buildings)
+	{
+		//߳˳
+		double check_length = 0.0;
+		int32 creases = 0;
+		double start_time = FPlatformTime::Seconds();
+		accumulate_buildings(0, building_count, check_length, creases);
+		double pass_seconds = FPlatformTime::Seconds() - start_time;
+
+		//鲢
+		int32 chunk_count = FMath::DivideAndRoundUp(building_count, building_chunk_size);
+		TArray<double> chunk_lengths;
+		TArray<int32> chunk_creases;
+		chunk_lengths.SetNumZeroed(chunk_count);
+		chunk_creases.SetNumZeroed(chunk_count);
+		start_time = FPlatformTime::Seconds();
+		ParallelFor(chunk_count, [&](int32 chunk_index)
+		{
+			int32 end = FMath::Min((chunk_index + 1) * building_chunk_size, building_count);
+			accumulate_buildings(chunk_index * building_chunk_size, end, chunk_lengths[chunk_index], chunk_creases[chunk_index]);
+		});
+		double pass_mt_seconds = FPlatformTime::Seconds() - start_time;
+
+		UE_LOG(LogBuildingBenchmark, Display, TEXT("layer: %-8s, %6.3f, %9llu, %8.1f, %8.2f, %8.2f (length %.0f, creases %d)"), store, build_seconds,
+			allocations, (double)bytes / building_count, building_count / pass_seconds * 1e-6, building_count / pass_mt_seconds * 1e-6,
+			check_length, creases);
+	};
+
+	{
+		TArray<FLegacyBuildingInfo> legacy;
+		double start_time = FPlatformTime::Seconds();
+		uint64 allocations;
+		{
+			FScopedAllocationCounter counter;
+			for (int32 i = 0; i < building_count; i++)
+			{
+				make_ring(i, ring_sizes[i], ring);
+				FLegacyBuildingInfo& building = legacy.AddDefaulted_GetRef();
+				building.code = i;
+				building.height = 20.0;
+				for (const FVector2D& coord : ring)
+				{
+					building.coords.Emplace(coord.X, coord.Y, 0.0f);
+				}
+			}
+			allocations = counter.GetAllocations();
+		}
+		double build_seconds = FPlatformTime::Seconds() - start_time;
+		SIZE_T bytes = legacy.GetAllocatedSize();
+		for (const FLegacyBuildingInfo& building : legacy)
+		{
+			bytes += building.coords.GetAllocatedSize();
+		}
+		report(TEXT("legacy"), build_seconds, allocations, bytes, [&](int32 begin, int32 end, double& length, int32& creases)
+		{
+			for (int32 i = begin; i < end; i++)
+			{
+				AccumulateRing(legacy[i].coords, length, creases);
+			}
+		});
+	}
+
+	{
+		FBuildingLayer layer;
+		double start_time = FPlatformTime::Seconds();
+		uint64 allocations;
+		{
+			FScopedAllocationCounter counter;
+			for (int32 i = 0; i < building_count; i++)
+			{
+				make_ring(i, ring_sizes[i], ring);
+				layer.AddBuilding(i, 20.0, ring);
+			}
+			allocations = counter.GetAllocations();
+		}
+		double build_seconds = FPlatformTime::Seconds() - start_time;
+		report(TEXT("layer"), build_seconds, allocations, layer.GetAllocatedSize(), [&](int32 begin, int32 end, double& length, int32& creases)
+		{
+			for (int32 i = begin; i < end; i++)
+			{
+				AccumulateRing(layer.GetRing(i), length, creases);
+			}
+		});
+	}
+}
+
+static void RunMeshBenchmark()
+{
+	//412ĻԼ֮һΪεİΣгɳн
+	const int32 building_count = 200000;
+	FRandomStream random(7);
+	FBuildingLayer layer;
+	TArray<FVector2D> ring;
+	for (int32 i = 0; i < building_count; i++)
+	{
+		int32 count = random.RandRange(4, 12);
+		bool concave = count >= 6 && random.FRand() < 0.3f;
+		double x = (i % 1000) * 30.0;
+		double y = (i / 1000) * 30.0;
+		ring.Reset(count);
+		for (int32 k = 0; k < count; k++)
+		{
+			double angle = 2.0 * PI * k / count;
+			double radius = concave && k % 2 == 1 ? 5.0 : 10.0;
+			ring.Add(FVector2D(x + radius * FMath::Cos(angle), y + radius * FMath::Sin(angle)));
+		}
+		layer.AddBuilding(i, random.FRandRange(6.0f, 150.0f), ring);
+	}
+	TArray<FBuildingChunk> chunks;
+	MakeBuildingChunks(0, layer, chunks);
+
+	UE_LOG(LogBuildingBenchmark, Display, TEXT("mesh: part, count s, fill s, vertices, triangles, fill Mvertices/s, heap allocations"));
+	auto report = [&](const TCHAR* part, double start_time, double count_time, double end_time, const FMeshSize& size, uint64 allocations)
+	{
+		UE_LOG(LogBuildingBenchmark, Display, TEXT("mesh: %-4s, %6.3f, %6.3f, %9d, %9d, %8.2f, %llu"), part, count_time - start_time, end_time - count_time,
+			size.vertices, size.indices / 3, size.vertices / FMath::Max(end_time - count_time, 1e-9) * 1e-6, allocations);
+	};
+
+	//ǽ水30۽ɷߣк決Ĭһ
+	{
+		FPMCMeshChunk wall;
+		double count_time = 0.0;
+		double start_time = FPlatformTime::Seconds();
+		FScopedAllocationCounter counter;
+		FMeshSize size = MakeWallMesh_PMC(chunks, FMath::Cos(FMath::DegreesToRadians(30.0f)), wall, count_time);
+		report(TEXT("wall"), start_time, count_time, FPlatformTime::Seconds(), size, counter.GetAllocations());
+	}
+	{
+		FPMCMeshChunk roof;
+		TArray<FRoofChunkTriangles> chunk_triangles;
+		double count_time = 0.0;
+		double start_time = FPlatformTime::Seconds();
+		FScopedAllocationCounter counter;
+		FMeshSize size = MakeRoofMesh_PMC(chunks, nullptr, chunk_triangles, roof, count_time);
+		report(TEXT("roof"), start_time, count_time, FPlatformTime::Seconds(), size, counter.GetAllocations());
+	}
+}
+
+INT32_MAIN_INT32_ARGC_TCHAR_ARGV()
+{
+	GEngineLoop.PreInit(ArgC, ArgV);
+
+	FString bench = TEXT("all");
+	FParse::Value(FCommandLine::Get(), TEXT("-bench="), bench);
+	if (bench == TEXT("all") || bench == TEXT("triangulation"))
+	{
+		RunTriangulationBenchmark();
+	}
+	if (bench == TEXT("all") || bench == TEXT("projection"))
+	{
+		RunProjectionBenchmark();
+	}
+	if (bench == TEXT("all") || bench == TEXT("layer"))
+	{
+		RunLayerBenchmark();
+	}
+	if (bench == TEXT("all") || bench == TEXT("mesh"))
+	{
+		RunMeshBenchmark();
+	}
+
+	FEngineLoop::AppPreExit();
+	FModuleManager::Get().UnloadModulesAtShutdown();
+	FEngineLoop::AppExit();
+	return 0;
+}
@@ -0,0 +1,12 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+//buildingbuilderģ鹲õļκģЩļֻCoreJsonκUObject
+#include "../BuildingLayer.cpp"
+#include "../BuildingProjection.cpp"
+#include "../BuildingScratch.cpp"
+#include "../PolygonTriangulator.cpp"
+#include "../BuildingMeshChunks.cpp"
+#include "../BuildingRebuildCache.cpp"
+#include "../BuildingBakeReport.cpp"
+#include "../BuildingGeometry.cpp"
+#include "../BuilderAllocCounter.cpp"
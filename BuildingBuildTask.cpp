@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingBuildTask.h"
+#include "Misc/ScopeLock.h"
+
+void UBuildingBuildTask::Cancel()
+{
+	if (m_running)
+	{
+		m_cancelled = true;
+	}
+}
+
+float UBuildingBuildTask::GetProgress() const
+{
+	FScopeLock lock(&m_lock);
+	return m_progress;
+}
+
+FString UBuildingBuildTask::GetStage() const
+{
+	FScopeLock lock(&m_lock);
+	return m_stage;
+}
+
+bool UBuildingBuildTask::IsRunning() const
+{
+	return m_running;
+}
+
+bool UBuildingBuildTask::IsCancelled() const
+{
+	return m_cancelled;
+}
+
+void UBuildingBuildTask::SetProgress(const FString& Stage, float Progress)
+{
+	FScopeLock lock(&m_lock);
+	m_stage = Stage;
+	m_progress = FMath::Clamp(Progress, 0.0f, 1.0f);
+}
+
+void UBuildingBuildTask::BroadcastProgress()
+{
+	FString stage;
+	float progress;
+	{
+		FScopeLock lock(&m_lock);
+		stage = m_stage;
+		progress = m_progress;
+	}
+	OnProgress.Broadcast(progress, stage);
+}
+
+void UBuildingBuildTask::Finish(bool bSucceeded)
+{
+	m_running = false;
+	SetProgress(bSucceeded ? TEXT("done") : (m_cancelled ? TEXT("cancelled") : TEXT("failed")), bSucceeded ? 1.0f : GetProgress());
+	BroadcastProgress();
+	OnCompleted.Broadcast(bSucceeded);
+}
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "HAL/ThreadSafeBool.h"
+#include "BuildingBuildTask.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FBuildingBuildProgressDelegate, float, Progress, const FString&, Stage);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FBuildingBuildCompletedDelegate, bool, bSucceeded);
+
+//첽ľȡ֪ͨȡίжϷ̹߳㲥
+UCLASS(BlueprintType)
+class BUILDINGBUILDER_API UBuildingBuildTask : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintAssignable, Category = "Builder")
+		FBuildingBuildProgressDelegate OnProgress;
+	UPROPERTY(BlueprintAssignable, Category = "Builder")
+		FBuildingBuildCompletedDelegate OnCompleted;
+
+	//̨һ׶μֹͣδִеı治ִ
+	UFUNCTION(BlueprintCallable, Category = "Builder")
+		void Cancel();
+
+	UFUNCTION(BlueprintPure, Category = "Builder")
+		float GetProgress() const;
+	UFUNCTION(BlueprintPure, Category = "Builder")
+		FString GetStage() const;
+	UFUNCTION(BlueprintPure, Category = "Builder")
+		bool IsRunning() const;
+	UFUNCTION(BlueprintPure, Category = "Builder")
+		bool IsCancelled() const;
+
+	//̵߳
+	void SetProgress(const FString& Stage, float Progress);
+	//ֻϷ̵߳
+	void BroadcastProgress();
+	void Finish(bool bSucceeded);
+
+private:
+	mutable FCriticalSection m_lock;
+	FString m_stage;
+	float m_progress = 0.0f;
+	FThreadSafeBool m_cancelled;
+	bool m_running = true;
+};
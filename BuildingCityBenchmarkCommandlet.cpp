@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingCityBenchmarkCommandlet.h"
+#include "BuildingProjection.h"
+#include "BuildingBakeReport.h"
+#include "BuildingSyntheticCity.h"
+#include "Builder.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+
+UBuildingCityBenchmarkCommandlet::UBuildingCityBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+//ȡϴνи׶εĺʱ
+static bool LoadBenchmarkStages(const FString& file_name, TMap<FString, double>& stages)
+{
+	FString json;
+	TSharedPtr<FJsonObject> root;
+	if (!FFileHelper::LoadFileToString(json, *file_name) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(json), root) || !root.IsValid())
+	{
+		return false;
+	}
+	const TSharedPtr<FJsonObject>* stage_object;
+	if (!root->TryGetObjectField(TEXT("stages"), stage_object))
+	{
+		return false;
+	}
+	for (const auto& stage : (*stage_object)->Values)
+	{
+		stages.Add(stage.Key, stage.Value->AsNumber());
+	}
+	return true;
+}
+
+int32 UBuildingCityBenchmarkCommandlet::Main(const FString& Params)
+{
+	FSyntheticCitySettings settings;
+	FParse::Value(*Params, TEXT("buildings="), settings.building_count);
+	FParse::Value(*Params, TEXT("layers="), settings.layer_count);
+	FParse::Value(*Params, TEXT("min_vertices="), settings.min_vertices);
+	FParse::Value(*Params, TEXT("max_vertices="), settings.max_vertices);
+	FParse::Value(*Params, TEXT("concave="), settings.concave_ratio);
+	FParse::Value(*Params, TEXT("duplicate="), settings.duplicate_ratio);
+	FParse::Value(*Params, TEXT("min_height="), settings.min_height);
+	FParse::Value(*Params, TEXT("max_height="), settings.max_height);
+	FParse::Value(*Params, TEXT("height_skew="), settings.height_skew);
+	FParse::Value(*Params, TEXT("seed="), settings.seed);
+	FParse::Value(*Params, TEXT("package_root="), settings.package_root);
+	FString output_file = FPaths::ProjectSavedDir() / TEXT("BuildingBenchmark") / FString::Printf(TEXT("city_%s.json"), *FDateTime::Now().ToString());
+	FParse::Value(*Params, TEXT("output="), output_file);
+	FString baseline_file;
+	FParse::Value(*Params, TEXT("baseline="), baseline_file);
+	//ȻñĽ׶Ϊ˻10Ľ׶̫󲻱Ƚ
+	float tolerance = 0.2f;
+	FParse::Value(*Params, TEXT("tolerance="), tolerance);
+
+	FString directory = FPaths::ProjectSavedDir() / TEXT("BuildingBenchmark") / TEXT("city");
+	IFileManager::Get().DeleteDirectory(*directory, false, true);
+	IFileManager::Get().MakeDirectory(*directory, true);
+	FSyntheticCityStats city_stats;
+	double start_time = FPlatformTime::Seconds();
+	if (!WriteSyntheticCity(directory, settings, city_stats))
+	{
+		UE_LOG(LogClass, Error, TEXT("city: write synthetic city failed: %s"), *directory);
+		return 1;
+	}
+	double generate_seconds = FPlatformTime::Seconds() - start_time;
+	UE_LOG(LogClass, Display, TEXT("city: %d buildings, %lld vertices, %d concave, %d duplicates, generated in %.3f s"),
+		city_stats.buildings, city_stats.vertices, city_stats.concave, city_stats.duplicates, generate_seconds);
+
+	UWorld* world = UWorld::CreateWorld(EWorldType::Editor, false, TEXT("BuildingBenchmark"));
+	ABuilder* builder = world->SpawnActor<ABuilder>();
+	builder->SetPath(directory);
+	start_time = FPlatformTime::Seconds();
+	bool succeeded = builder->ParseJson();
+	if (succeeded)
+	{
+		builder->CreateMesh();
+	}
+	double total_seconds = FPlatformTime::Seconds() - start_time;
+	TArray<TPair<FString, double>> stage_times = builder->GetStageTimes();
+	TSharedRef<FJsonObject> report_object = MakeBakeReportJson(builder->GetBakeReport(), stage_times);
+	world->DestroyWorld(false);
+	world->RemoveFromRoot();
+	if (!succeeded)
+	{
+		UE_LOG(LogClass, Error, TEXT("city: parse failed"));
+		return 1;
+	}
+
+	TSharedPtr<FJsonObject> settings_object = MakeShared<FJsonObject>();
+	settings_object->SetNumberField(TEXT("buildings"), settings.building_count);
+	settings_object->SetNumberField(TEXT("layers"), settings.layer_count);
+	settings_object->SetNumberField(TEXT("min_vertices"), settings.min_vertices);
+	settings_object->SetNumberField(TEXT("max_vertices"), settings.max_vertices);
+	settings_object->SetNumberField(TEXT("concave"), settings.concave_ratio);
+	settings_object->SetNumberField(TEXT("duplicate"), settings.duplicate_ratio);
+	settings_object->SetNumberField(TEXT("min_height"), settings.min_height);
+	settings_object->SetNumberField(TEXT("max_height"), settings.max_height);
+	settings_object->SetNumberField(TEXT("height_skew"), settings.height_skew);
+	settings_object->SetNumberField(TEXT("seed"), settings.seed);
+
+	TSharedPtr<FJsonObject> input_object = MakeShared<FJsonObject>();
+	input_object->SetNumberField(TEXT("buildings"), city_stats.buildings);
+	input_object->SetNumberField(TEXT("vertices"), (double)city_stats.vertices);
+	input_object->SetNumberField(TEXT("concave"), city_stats.concave);
+	input_object->SetNumberField(TEXT("duplicates"), city_stats.duplicates);
+
+	TMap<FString, double> baseline;
+	if (!baseline_file.IsEmpty() && !LoadBenchmarkStages(baseline_file, baseline))
+	{
+		UE_LOG(LogClass, Warning, TEXT("city: load baseline failed: %s"), *baseline_file);
+	}
+	int32 regressions = 0;
+	TSharedPtr<FJsonObject> stage_object = MakeShared<FJsonObject>();
+	UE_LOG(LogClass, Display, TEXT("city: stage, seconds, baseline, change"));
+	for (const TPair<FString, double>& stage_time : stage_times)
+	{
+		stage_object->SetNumberField(stage_time.Key, stage_time.Value);
+		const double* baseline_seconds = baseline.Find(stage_time.Key);
+		if (baseline_seconds == nullptr || *baseline_seconds <= 0.0)
+		{
+			UE_LOG(LogClass, Display, TEXT("city: %-16s, %8.3f"), *stage_time.Key, stage_time.Value);
+			continue;
+		}
+		double change = stage_time.Value / *baseline_seconds - 1.0;
+		bool regressed = change > tolerance && stage_time.Value - *baseline_seconds > 0.01;
+		regressions += regressed ? 1 : 0;
+		UE_LOG(LogClass, Display, TEXT("city: %-16s, %8.3f, %8.3f, %+6.1f%%%s"), *stage_time.Key, stage_time.Value, *baseline_seconds,
+			change * 100.0, regressed ? TEXT(" REGRESSED") : TEXT(""));
+	}
+	UE_LOG(LogClass, Display, TEXT("city: total %.3f s"), total_seconds);
+
+	TSharedPtr<FJsonObject> root = MakeShared<FJsonObject>();
+	root->SetStringField(TEXT("benchmark"), TEXT("city"));
+	root->SetStringField(TEXT("date"), FDateTime::UtcNow().ToIso8601());
+	root->SetStringField(TEXT("projection_kernel"), GetMercatorKernelName());
+	root->SetNumberField(TEXT("threads"), FPlatformMisc::NumberOfWorkerThreadsToSpawn());
+	root->SetObjectField(TEXT("settings"), settings_object);
+	root->SetObjectField(TEXT("input"), input_object);
+	root->SetNumberField(TEXT("generate_input"), generate_seconds);
+	root->SetObjectField(TEXT("stages"), stage_object);
+	root->SetNumberField(TEXT("total"), total_seconds);
+	root->SetObjectField(TEXT("report"), report_object);
+	if (!baseline_file.IsEmpty())
+	{
+		root->SetStringField(TEXT("baseline"), baseline_file);
+		root->SetNumberField(TEXT("regressions"), regressions);
+	}
+
+	FString json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+	if (!FJsonSerializer::Serialize(root.ToSharedRef(), writer) || !FFileHelper::SaveStringToFile(json, *output_file))
+	{
+		UE_LOG(LogClass, Error, TEXT("city: write result failed: %s"), *output_file);
+		return 1;
+	}
+	UE_LOG(LogClass, Display, TEXT("city: result written to %s"), *output_file);
+	return regressions > 0 ? 1 : 0;
+}
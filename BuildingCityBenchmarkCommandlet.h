@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BuildingCityBenchmarkCommandlet.generated.h"
+
+//̵ܲԣUE4Editor-Cmd.exe <Project> -run=BuildingCityBenchmark [-buildings=100000 -layers=1 -min_vertices=4 -max_vertices=12
+//	-concave=0.3 -duplicate=0.2 -min_height=6 -max_height=150 -height_skew=2 -seed=1 -package_root=/Game/BuildingBenchmark
+//	-output=<.json> -baseline=<ϴν.json> -tolerance=0.2]
+//ɺϳɳݺABuilderɲԴ׶μʱдJSONн׶˻ʱ1
+//ʱpackage_root£Ӱ/GameеʽԴκĵĵԼBuildingBenchmark
+UCLASS()
+class BUILDINGBUILDER_API UBuildingCityBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBuildingCityBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+//buildingbuilderģ鹲õļκļԣЩļֻCoreJsonκUObject
+#include "../BuildingLayer.cpp"
+#include "../BuildingProjection.cpp"
+#include "../BuildingScratch.cpp"
+#include "../PolygonTriangulator.cpp"
+#include "../BuildingMeshChunks.cpp"
+#include "../BuildingRebuildCache.cpp"
+#include "../BuildingBakeReport.cpp"
+#include "../BuildingGeometry.cpp"
+#include "../GeoJsonStreamReader.cpp"
+#include "../BuildingLayerCache.cpp"
+#include "../BuildingSpatialIndex.cpp"
+
+#include "../Tests/BuildingGeometryTest.cpp"
+#include "../Tests/PolygonTriangulatorTest.cpp"
+#include "../Tests/GeoJsonStreamReaderTest.cpp"
+#include "../Tests/BuildingLayerTest.cpp"
+#include "../Tests/BuildingSpatialIndexTest.cpp"
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using System.IO;
+using UnrealBuildTool;
+
+public class BuildingCoreTests : ModuleRules
+{
+	public BuildingCoreTests(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PublicIncludePaths.Add("Runtime/Launch/Public");
+		PrivateIncludePaths.Add("Runtime/Launch/Private");
+
+		//ļλbuildingbuilderģĿ¼BuildingCoreSources.cpp뱾
+		PrivateIncludePaths.Add(Path.GetFullPath(Path.Combine(ModuleDirectory, "..")));
+
+		PrivateDependencyModuleNames.AddRange(new string[] {
+			"Core",
+			"Json",
+			"Projects"
+		});
+	}
+}
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+//κĵĶԳֻCoreJsonUObject
+[SupportedPlatforms(UnrealPlatformClass.Desktop)]
+public class BuildingCoreTestsTarget : TargetRules
+{
+	public BuildingCoreTestsTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Program;
+		LinkType = TargetLinkType.Monolithic;
+		LaunchModuleName = "BuildingCoreTests";
+
+		bBuildDeveloperTools = false;
+		bBuildWithEditorOnlyData = false;
+		bCompileAgainstEngine = false;
+		bCompileAgainstCoreUObject = false;
+		bCompileAgainstApplicationCore = false;
+		bForceCompileDevelopmentAutomationTests = true;
+		bIsBuildingConsoleApplication = true;
+	}
+}
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "RequiredProgramMainCPPInclude.h"
+#include "Misc/AutomationTest.h"
+
+//BuildingCoreTests [-filter=BuildingBuilder.Core.PolygonTriangulator]
+//filterͷȫԶԣĬBuildingBuilder.Coreвʧʱ1
+DEFINE_LOG_CATEGORY_STATIC(LogBuildingCoreTests, Log, All);
+
+IMPLEMENT_APPLICATION(BuildingCoreTests, "BuildingCoreTests");
+
+INT32_MAIN_INT32_ARGC_TCHAR_ARGV()
+{
+	GEngineLoop.PreInit(ArgC, ArgV);
+
+	FString filter = TEXT("BuildingBuilder.Core");
+	FParse::Value(FCommandLine::Get(), TEXT("-filter="), filter);
+
+	FAutomationTestFramework& framework = FAutomationTestFramework::Get();
+	framework.SetRequestedTestFilter(EAutomationTestFlags::EngineFilter);
+	TArray<FAutomationTestInfo> test_infos;
+	framework.GetValidTestNames(test_infos);
+
+	int32 test_count = 0;
+	int32 failed_count = 0;
+	for (const FAutomationTestInfo& test_info : test_infos)
+	{
+		if (!test_info.GetDisplayName().StartsWith(filter))
+		{
+			continue;
+		}
+		test_count++;
+		framework.StartTestByName(test_info.GetTestName(), 0);
+		FAutomationTestExecutionInfo execution_info;
+		bool succeeded = framework.StopTest(execution_info);
+		for (const FAutomationExecutionEntry& entry : execution_info.GetEntries())
+		{
+			if (entry.Event.Type == EAutomationEventType::Error)
+			{
+				UE_LOG(LogBuildingCoreTests, Error, TEXT("%s: %s"), *test_info.GetDisplayName(), *entry.Event.Message);
+			}
+		}
+		UE_LOG(LogBuildingCoreTests, Display, TEXT("%s %s"), succeeded ? TEXT("passed") : TEXT("FAILED"), *test_info.GetDisplayName());
+		failed_count += succeeded ? 0 : 1;
+	}
+	UE_LOG(LogBuildingCoreTests, Display, TEXT("%d tests, %d failed"), test_count, failed_count);
+
+	FEngineLoop::AppPreExit();
+	FModuleManager::Get().UnloadModulesAtShutdown();
+	FEngineLoop::AppExit();
+	return test_count > 0 && failed_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,724 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingGeometry.h"
+#include "BuildingLayer.h"
+#include "BuildingMeshChunks.h"
+#include "BuildingRebuildCache.h"
+#include "BuildingProjection.h"
+#include "PolygonTriangulator.h"
+#include "BuildingScratch.h"
+#include "BuildingBakeReport.h"
+#include "Async/ParallelFor.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+DEFINE_LOG_CATEGORY(LogBuildingCore);
+
+const float geometry_threshold = FLT_EPSILON;
+
+//дһШζ
+static void SetRawMeshWedge(const FRawMeshView& RawMesh, int32 wedge, int32 vertex_index, const FVector2D& uv)
+{
+	RawMesh.WedgeIndices[wedge] = vertex_index;
+	RawMesh.WedgeTexCoords[wedge] = uv;
+	RawMesh.WedgeTangentX[wedge] = FVector(1, 0, 0);
+	RawMesh.WedgeTangentY[wedge] = FVector(0, 1, 0);
+	RawMesh.WedgeTangentZ[wedge] = FVector(0, 0, 1);
+	RawMesh.WedgeColors[wedge] = FColor(1.0f, 1.0f, 1.0f, 1.0f);
+}
+
+//ݶ갴ΰΧйһ
+static void GetPolygonUVBounds(TArrayView<const FVector2D> polygon, FVector2D& min, FVector2D& size)
+{
+	min = FVector2D(FLT_MAX, FLT_MAX);
+	FVector2D max(-FLT_MAX, -FLT_MAX);
+	for (const FVector2D& point : polygon)
+	{
+		min.X = point.X < min.X ? point.X : min.X;
+		min.Y = point.Y < min.Y ? point.Y : min.Y;
+		max.X = point.X > max.X ? point.X : max.X;
+		max.Y = point.Y > max.Y ? point.Y : max.Y;
+	}
+	size = max - min;
+}
+
+static FVector2D GetPolygonUV(const FVector2D& point, const FVector2D& min, const FVector2D& size)
+{
+	return FVector2D((point.X - min.X) / size.X, (point.Y - min.Y) / size.Y);
+}
+
+//FRawMesh갴ШδţȶÿһΣШֱ
+static void GetPolygonUVs(TArrayView<const FVector2D> polygon, TBuildingScratchArray<FVector2D>& uvs)
+{
+	FVector2D min, size;
+	GetPolygonUVBounds(polygon, min, size);
+	uvs.SetNumUninitialized(polygon.Num());
+	for (int32 i = 0; i < polygon.Num(); i++)
+	{
+		uvs[i] = GetPolygonUV(polygon[i], min, size);
+	}
+}
+
+void ProjectBuildingLayer(FBuildingLayer& layer, double ref_north, double ref_east)
+{
+	//ͼţ̶ֿ鲢ͶӰתΪ˫Ȼ
+	//ʹýʱ˫ȾγȣȾγֻûԴͼ
+	const int32 block_size = 1024;
+	TArrayView<FVector2D> coords = layer.GetMutableCoords();
+	TArrayView<const double> source_coords = layer.GetSourceCoords();
+	bool has_source = layer.HasSourceCoords();
+	int32 block_count = FMath::DivideAndRoundUp(coords.Num(), block_size);
+	ParallelFor(block_count, [&](int32 block_index)
+	{
+		int32 begin = block_index * block_size;
+		int32 count = FMath::Min(begin + block_size, coords.Num()) - begin;
+		double lon[block_size], lat[block_size], north[block_size], east[block_size];
+		for (int32 i = 0; i < count; i++)
+		{
+			lon[i] = has_source ? source_coords[2 * (begin + i)] : coords[begin + i].X;
+			lat[i] = has_source ? source_coords[2 * (begin + i) + 1] : coords[begin + i].Y;
+		}
+
+		ProjectMercator(lon, lat, count, ref_north, ref_east, north, east);
+
+		for (int32 i = 0; i < count; i++)
+		{
+			coords[begin + i] = FVector2D(north[i], east[i]);
+		}
+	});
+	layer.ReleaseSourceCoords();
+	layer.UpdateBounds();
+}
+
+bool IsSegmentCross(const FVector2D& pStart1, const FVector2D& pEnd1, const FVector2D& pStart2, const FVector2D& pEnd2)
+{
+	//߶2ֹǷ߶1
+	FVector2D P1 = pStart2 - pStart1;
+	FVector2D P2 = pEnd2 - pStart1;
+	FVector2D Q = pEnd1 - pStart1;
+	double mark = (P1.X * Q.Y - P1.Y * Q.X) * (P2.X * Q.Y - P2.Y * Q.X);
+	if (mark > 0)
+	{
+		return false;
+	}
+
+	//߶1ֹǷ߶2
+	P1 = pStart1 - pStart2;
+	P2 = pEnd1 - pStart2;
+	Q = pEnd2 - pStart2;
+	mark = (P1.X * Q.Y - P1.Y * Q.X) * (P2.X * Q.Y - P2.Y * Q.X);
+	if (mark > 0)
+	{
+		return false;
+	}
+
+	return true;
+}
+bool PointInPolygon(TArrayView<const FVector2D> polygon, const FVector2D& point)
+{
+	//YߵĽΪʱڶڣߵĶ˵㰴뿪룬߾ʱظ
+	bool inside = false;
+	int32 count = polygon.Num();
+	for (int32 i = 0, pre_index = count - 1; i < count; pre_index = i++)
+	{
+		const FVector2D& start_point = polygon[pre_index];
+		const FVector2D& end_point = polygon[i];
+		if ((start_point.X > point.X) != (end_point.X > point.X))
+		{
+			double cross_y = start_point.Y + (double)(point.X - start_point.X) * (end_point.Y - start_point.Y) / (end_point.X - start_point.X);
+			if (cross_y > point.Y)
+			{
+				inside = !inside;
+			}
+		}
+	}
+	return inside;
+}
+double PointPolygonDistanceSquared(TArrayView<const FVector2D> polygon, const FVector2D& point)
+{
+	if (PointInPolygon(polygon, point))
+	{
+		return 0.0;
+	}
+	double min_distance = DBL_MAX;
+	int32 count = polygon.Num();
+	for (int32 i = 0, pre_index = count - 1; i < count; pre_index = i++)
+	{
+		FVector2D closest = FMath::ClosestPointOnSegment2D(point, polygon[pre_index], polygon[i]);
+		min_distance = FMath::Min(min_distance, (double)FVector2D::DistSquared(point, closest));
+	}
+	return min_distance;
+}
+bool PolygonIntersectBox(TArrayView<const FVector2D> polygon, const FBox2D& box)
+{
+	if (polygon.Num() == 0)
+	{
+		return false;
+	}
+	//жھڣڶ
+	for (const FVector2D& point : polygon)
+	{
+		if (box.IsInsideOrOn(point))
+		{
+			return true;
+		}
+	}
+	if (PointInPolygon(polygon, box.Min))
+	{
+		return true;
+	}
+	//˵㶼ھıߴ
+	const FVector2D corners[4] = { box.Min, FVector2D(box.Max.X, box.Min.Y), box.Max, FVector2D(box.Min.X, box.Max.Y) };
+	int32 count = polygon.Num();
+	for (int32 i = 0, pre_index = count - 1; i < count; pre_index = i++)
+	{
+		for (int32 k = 0; k < 4; k++)
+		{
+			if (IsSegmentCross(polygon[pre_index], polygon[i], corners[k], corners[(k + 1) % 4]))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+bool PointRightOfLine(const FVector2D& pStart, const FVector2D& pEnd, const FVector2D& point)
+{
+
+	FVector2D start = pStart - point;
+	FVector2D end = pEnd - point;
+
+	double mark = start.X * end.Y - start.Y * end.X;
+	return mark < 0.0;
+}
+bool PointInTriangle(TArrayView<const FVector2D> triangle, const FVector2D& point)
+{
+	if (triangle.Num() != 3)
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("ζȷ"));
+		return false;
+	}
+
+	bool r1 = PointRightOfLine(triangle[0], triangle[1], point);
+	bool r2 = PointRightOfLine(triangle[1], triangle[2], point);
+	bool r3 = PointRightOfLine(triangle[2], triangle[0], point);
+	//˳ʱ˳
+	if (r1 && r2 && r3)
+	{
+		return true;
+	}
+	//ʱ˳
+	if (!r1 && !r2 && !r3)
+	{
+		return true;
+	}
+
+	return false;
+}
+bool IsConvexPoint(TArrayView<const FVector2D> polygon, int32 index)
+{
+	int count = polygon.Num();
+	int32 pre_index = index == 0 ? count - 1 : index - 1;
+	int32 next_index = index + 1 == count ? 0 : index + 1;
+	FVector2D vec1 = polygon[pre_index] - polygon[index];
+	FVector2D vec2 = polygon[next_index] - polygon[index];
+
+	float mark = vec1.X * vec2.Y - vec1.Y * vec2.X;
+	return mark < 0.0f;
+}
+bool IsConvexPolygon(TArrayView<const FVector2D> polygon)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BuildingConvexTest);
+	for (int32 i = 0; i < polygon.Num(); i++)
+	{
+		if (!IsConvexPoint(polygon, i))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+bool IsDivisiblePoint(TArrayView<const FVector2D> polygon, int32 index)
+{
+	bool convex = IsConvexPoint(polygon, index);
+	if (!convex)
+	{
+		return false;
+	}
+
+	int count = polygon.Num();
+	int32 pre_index = index == 0 ? count - 1 : index - 1;
+	int32 next_index = index + 1 == count ? 0 : index + 1;
+	const FVector2D triangle[3] = { polygon[pre_index], polygon[index], polygon[next_index] };
+	for (int i = 0; i < count; i++)
+	{
+		if (i == index || i == pre_index || i == next_index)
+		{
+			continue;
+		}
+		if (PointInTriangle(triangle, polygon[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+bool IsCreasePoint(TArrayView<const FVector2D> polygon, int32 index, float crease_cos)
+{
+	int count = polygon.Num();
+	int32 pre_index = index == 0 ? count - 1 : index - 1;
+	int32 next_index = index + 1 == count ? 0 : index + 1;
+	FVector2D pre_dir = (polygon[index] - polygon[pre_index]).GetSafeNormal();
+	FVector2D next_dir = (polygon[next_index] - polygon[index]).GetSafeNormal();
+
+	//߷ļнǼǽ۽
+	return FVector2D::DotProduct(pre_dir, next_dir) < crease_cos;
+}
+bool IsSurplusPoint(TArrayView<const FVector2D> polygon, int32 index)
+{
+	int count = polygon.Num();
+	int32 pre_index = index == 0 ? count - 1 : index - 1;
+	int32 next_index = index + 1 == count ? 0 : index + 1;
+	FVector2D vec1 = polygon[index] - polygon[pre_index];
+	FVector2D vec2 = polygon[next_index] - polygon[index];
+
+	float mark = vec1.X * vec2.Y - vec1.Y * vec2.X;
+	return abs(mark) < geometry_threshold;
+}
+void CountWallStrip_PMC(TArrayView<const FVector2D> polygon, float crease_cos, FMeshSize& size)
+{
+	int32 count = polygon.Num();
+	if (count < 2)
+	{
+		return;
+	}
+	//ÿһյ㶥㣬㴦һбպӷ죬ÿ۽ٶһ
+	int32 columns = count + 1;
+	for (int32 i = 1; i < count; i++)
+	{
+		columns += IsCreasePoint(polygon, i, crease_cos) ? 1 : 0;
+	}
+	size.vertices += 2 * columns;
+	size.indices += 6 * count;
+	size.faces += 2 * count;
+}
+void CountWallStrip_RawMesh(TArrayView<const FVector2D> polygon, FMeshSize& size)
+{
+	int32 count = polygon.Num();
+	if (count < 2)
+	{
+		return;
+	}
+	//ШζԱ꣬λöÿ¸һ
+	size.vertices += 2 * count;
+	size.indices += 6 * count;
+	size.faces += 2 * count;
+}
+void DivideWallStrip_PMC(TArrayView<const FVector2D> polygon, float crease_cos, double bottom, double top, FPMCMeshChunk& mesh, FMeshSize& cursor)
+{
+	int32 count = polygon.Num();
+	if (count < 2)
+	{
+		return;
+	}
+
+	//һ㣬uػۼӣÿԸһ
+	int32 column = cursor.vertices;
+	auto add_column = [&](const FVector2D& point, float u, const FVector& normal)
+	{
+		mesh.Vertices[column] = FVector(point.X, point.Y, bottom);
+		mesh.Vertices[column + 1] = FVector(point.X, point.Y, top);
+		mesh.UV[column] = FVector2D(u, 0.0f);
+		mesh.UV[column + 1] = FVector2D(u, 1.0f);
+		mesh.Normals[column] = normal;
+		mesh.Normals[column + 1] = normal;
+		mesh.VertexColors[column] = FColor(1.0f, 1.0f, 1.0f, 1.0f);
+		mesh.VertexColors[column + 1] = FColor(1.0f, 1.0f, 1.0f, 1.0f);
+		int32 added = column;
+		column += 2;
+		return added;
+	};
+	auto edge_normal = [&](int32 i)
+	{
+		int32 next_index = i + 1 == count ? 0 : i + 1;
+		FVector2D direction = polygon[next_index] - polygon[i];
+		return FVector(-direction.Y, direction.X, 0.0f).GetSafeNormal2D();
+	};
+	//ƽı߹һж㣬ȡߵƽ
+	auto corner_normal = [](const FVector& pre_normal, const FVector& next_normal)
+	{
+		return (pre_normal + next_normal).GetSafeNormal2D();
+	};
+
+	bool first_crease = IsCreasePoint(polygon, 0, crease_cos);
+	FVector first_normal = edge_normal(0);
+	FVector last_normal = edge_normal(count - 1);
+	FVector seam_normal = corner_normal(last_normal, first_normal);
+
+	int32 index = cursor.indices;
+	FVector normal = first_normal;
+	int32 start = add_column(polygon[0], 0.0f, first_crease ? first_normal : seam_normal);
+	for (int32 i = 0; i < count; i++)
+	{
+		int32 next_index = i + 1 == count ? 0 : i + 1;
+		FVector next_normal = i + 1 == count ? first_normal : edge_normal(next_index);
+		bool crease = i + 1 == count ? first_crease : IsCreasePoint(polygon, next_index, crease_cos);
+		int32 end;
+		if (crease)
+		{
+			end = add_column(polygon[next_index], i + 1, normal);
+		}
+		else
+		{
+			end = add_column(polygon[next_index], i + 1, i + 1 == count ? seam_normal : corner_normal(normal, next_normal));
+		}
+
+		mesh.Index[index + 0] = start;
+		mesh.Index[index + 1] = start + 1;
+		mesh.Index[index + 2] = end;
+		mesh.Index[index + 3] = start + 1;
+		mesh.Index[index + 4] = end + 1;
+		mesh.Index[index + 5] = end;
+		index += 6;
+
+		//۽ǴΪһһ
+		start = crease && i + 1 < count ? add_column(polygon[next_index], i + 1, next_normal) : end;
+		normal = next_normal;
+	}
+
+	cursor.faces += (index - cursor.indices) / 3;
+	cursor.vertices = column;
+	cursor.indices = index;
+}
+void GetWallSmoothingMasks(TArrayView<const FVector2D> polygon, float crease_cos, TArrayView<uint32> smoothing_masks)
+{
+	int32 count = polygon.Num();
+	check(smoothing_masks.Num() == count);
+
+	//۽ǰѻֳƽΣڶʹòͬƽ飬۽ǴϿ
+	int32 first_crease = INDEX_NONE;
+	int32 run_count = 0;
+	for (int32 i = 0; i < count; i++)
+	{
+		//ݴ۽Ǳǣ水˳򸲸Ϊƽ
+		smoothing_masks[i] = IsCreasePoint(polygon, i, crease_cos) ? 1 : 0;
+		if (smoothing_masks[i] != 0)
+		{
+			first_crease = first_crease == INDEX_NONE ? i : first_crease;
+			run_count++;
+		}
+	}
+
+	int32 run = -1;
+	for (int32 step = 0; step < count; step++)
+	{
+		//ӵһ۽ǿʼ֤ÿ
+		int32 i = first_crease == INDEX_NONE ? step : (first_crease + step) % count;
+		if (smoothing_masks[i] != 0 && first_crease != INDEX_NONE)
+		{
+			run++;
+		}
+		uint32 smoothing_mask = 1;
+		if (run_count == 1)
+		{
+			//ֻһ۽ʱβӣֱʹòͬƽ飬мıͬʱ
+			smoothing_mask = step == 0 ? 1 : (step + 1 == count ? 2 : 3);
+		}
+		else if (run_count > 1)
+		{
+			//Ϊʱһ׶ڣʹõƽ
+			smoothing_mask = run_count % 2 == 1 && run == run_count - 1 ? 4 : 1 << (run % 2);
+		}
+		smoothing_masks[i] = smoothing_mask;
+	}
+}
+void DivideWallStrip_RawMesh(TArrayView<const FVector2D> polygon, TArrayView<const uint32> smoothing_masks, double bottom, double top, const FRawMeshView& RawMesh, FMeshSize& cursor)
+{
+	int32 count = polygon.Num();
+	if (count < 2)
+	{
+		return;
+	}
+
+	int32 delta = cursor.vertices;
+	for (int32 i = 0; i < count; i++)
+	{
+		RawMesh.VertexPositions[delta + 2 * i] = FVector(polygon[i].X, polygon[i].Y, bottom);
+		RawMesh.VertexPositions[delta + 2 * i + 1] = FVector(polygon[i].X, polygon[i].Y, top);
+	}
+
+	int32 wedge = cursor.indices;
+	int32 face = cursor.faces;
+	for (int32 i = 0; i < count; i++)
+	{
+		int32 next_index = i + 1 == count ? 0 : i + 1;
+		int32 cur = delta + 2 * i;
+		int32 next = delta + 2 * next_index;
+		SetRawMeshWedge(RawMesh, wedge + 0, cur, FVector2D(0.0f, 0.0f));
+		SetRawMeshWedge(RawMesh, wedge + 1, cur + 1, FVector2D(0.0f, 1.0f));
+		SetRawMeshWedge(RawMesh, wedge + 2, next, FVector2D(1.0f, 0.0f));
+		SetRawMeshWedge(RawMesh, wedge + 3, cur + 1, FVector2D(0.0f, 1.0f));
+		SetRawMeshWedge(RawMesh, wedge + 4, next + 1, FVector2D(1.0f, 1.0f));
+		SetRawMeshWedge(RawMesh, wedge + 5, next, FVector2D(1.0f, 0.0f));
+		wedge += 6;
+
+		for (int32 k = 0; k < 2; k++)
+		{
+			RawMesh.FaceMaterialIndices[face] = 0;
+			RawMesh.FaceSmoothingMasks[face] = smoothing_masks[i];
+			face++;
+		}
+	}
+
+	cursor.vertices += 2 * count;
+	cursor.indices = wedge;
+	cursor.faces = face;
+}
+void CountRoofBuildings(TArrayView<const FBuildingView> buildings, const FBuildingRebuildCache* rebuild_cache, FRoofChunkTriangles& roof, FMeshSize& size)
+{
+	int32 building_count = buildings.Num();
+	roof.offsets.SetNumUninitialized(building_count + 1);
+	roof.convex.SetNumUninitialized(building_count);
+	roof.triangulated.Reset();
+	roof.triangulate_cycles.Reset();
+	roof.convex_test_cycles = 0;
+	roof.ear_clipping_cycles = 0;
+
+	//n - 2
+	int32 max_triangle_count = 0;
+	for (int32 i = 0; i < building_count; i++)
+	{
+		max_triangle_count += FMath::Max(buildings[i].coords.Num() - 2, 0);
+	}
+	roof.triangles.Reset(max_triangle_count * 3);
+
+	for (int32 i = 0; i < building_count; i++)
+	{
+		//ǻʱÿͷ
+		FBuildingScratchMark scratch_mark;
+		TArrayView<const FVector2D> polygon = buildings[i].coords;
+		roof.offsets[i] = roof.triangles.Num();
+		uint64 convex_start_cycles = FPlatformTime::Cycles64();
+		roof.convex[i] = IsConvexPolygon(polygon);
+		roof.convex_test_cycles += FPlatformTime::Cycles64() - convex_start_cycles;
+		if (roof.convex[i])
+		{
+			//͹ǻ㹲
+			int32 triangle_count = FMath::Max(polygon.Num() - 2, 0);
+			size.vertices += polygon.Num();
+			size.indices += 3 * triangle_count;
+			size.faces += triangle_count;
+		}
+		else
+		{
+			//δ仯ʱֱʹûǻ
+			uint64 ring_hash = rebuild_cache != nullptr ? HashBuildingRing(polygon) : 0;
+			const TArray<int32>* cached_triangles = rebuild_cache != nullptr ? rebuild_cache->FindTriangles(ring_hash) : nullptr;
+			bool triangulated = cached_triangles != nullptr;
+			if (triangulated)
+			{
+				roof.triangles.Append(*cached_triangles);
+			}
+			else
+			{
+				uint64 triangulate_start_cycles = FPlatformTime::Cycles64();
+				triangulated = FPolygonTriangulator().Triangulate(polygon, roof.triangles);
+				uint64 triangulate_cycles = FPlatformTime::Cycles64() - triangulate_start_cycles;
+				roof.ear_clipping_cycles += triangulate_cycles;
+				if (triangulated)
+				{
+					roof.triangulated.Emplace(ring_hash, i);
+					roof.triangulate_cycles.Add(triangulate_cycles);
+				}
+			}
+			if (triangulated)
+			{
+				//ͬÿһ㣬ΰ
+				int32 index_count = roof.triangles.Num() - roof.offsets[i];
+				size.vertices += polygon.Num();
+				size.indices += index_count;
+				size.faces += index_count / 3;
+			}
+		}
+	}
+	roof.offsets[building_count] = roof.triangles.Num();
+}
+void DivideConvexPolygon_PMC(TArrayView<const FVector2D> polygon, double height, FPMCMeshChunk& mesh, FMeshSize& cursor)
+{
+	int32 count = polygon.Num();
+	int32 delta = cursor.vertices;
+	FVector2D min, uv_size;
+	GetPolygonUVBounds(polygon, min, uv_size);
+	for (int i = 0; i < count; i++)
+	{
+		mesh.Vertices[delta + i] = FVector(polygon[i].X, polygon[i].Y, height);
+		mesh.UV[delta + i] = GetPolygonUV(polygon[i], min, uv_size);
+	}
+
+	int32 index = cursor.indices;
+	for (int i = 0; i < count - 2; i++)
+	{
+		mesh.Index[index++] = delta;
+		mesh.Index[index++] = delta + i + 2;
+		mesh.Index[index++] = delta + i + 1;
+	}
+
+	cursor.vertices += count;
+	cursor.faces += (index - cursor.indices) / 3;
+	cursor.indices = index;
+}
+void DivideConvexPolygon_RawMesh(TArrayView<const FVector2D> polygon, double height, const FRawMeshView& RawMesh, FMeshSize& cursor)
+{
+	FBuildingScratchMark scratch_mark;
+	int32 count = polygon.Num();
+	int32 delta = cursor.vertices;
+	TBuildingScratchArray<FVector2D> uvs;
+	GetPolygonUVs(polygon, uvs);
+	for (int i = 0; i < count; i++)
+	{
+		RawMesh.VertexPositions[delta + i] = FVector(polygon[i].X, polygon[i].Y, height);
+	}
+
+	int32 wedge = cursor.indices;
+	int32 face = cursor.faces;
+	for (int i = 0; i < count - 2; i++)
+	{
+		SetRawMeshWedge(RawMesh, wedge++, delta, uvs[0]);
+		SetRawMeshWedge(RawMesh, wedge++, delta + i + 2, uvs[i + 2]);
+		SetRawMeshWedge(RawMesh, wedge++, delta + i + 1, uvs[i + 1]);
+
+		RawMesh.FaceMaterialIndices[face] = 0;
+		RawMesh.FaceSmoothingMasks[face] = 0;
+		face++;
+	}
+
+	cursor.vertices += count;
+	cursor.indices = wedge;
+	cursor.faces = face;
+}
+void DivideConcavePolygon_PMC(TArrayView<const FVector2D> polygon, TArrayView<const int32> triangles, double height, FPMCMeshChunk& mesh, FMeshSize& cursor)
+{
+	//ǻʧܵĽڼ׶ûм룬дκ
+	if (triangles.Num() == 0)
+	{
+		return;
+	}
+	int32 count = polygon.Num();
+	int32 delta = cursor.vertices;
+	FVector2D min, uv_size;
+	GetPolygonUVBounds(polygon, min, uv_size);
+	for (int32 i = 0; i < count; i++)
+	{
+		mesh.Vertices[delta + i] = FVector(polygon[i].X, polygon[i].Y, height);
+		mesh.UV[delta + i] = GetPolygonUV(polygon[i], min, uv_size);
+	}
+
+	//ǻΪţֱΪ
+	for (int32 i = 0; i < triangles.Num(); i++)
+	{
+		mesh.Index[cursor.indices + i] = delta + triangles[i];
+	}
+
+	cursor.vertices += count;
+	cursor.indices += triangles.Num();
+	cursor.faces += triangles.Num() / 3;
+}
+void DivideConcavePolygon_RawMesh(TArrayView<const FVector2D> polygon, TArrayView<const int32> triangles, double height, const FRawMeshView& RawMesh, FMeshSize& cursor)
+{
+	if (triangles.Num() == 0)
+	{
+		return;
+	}
+	FBuildingScratchMark scratch_mark;
+	int32 count = polygon.Num();
+	int32 delta = cursor.vertices;
+	TBuildingScratchArray<FVector2D> uvs;
+	GetPolygonUVs(polygon, uvs);
+	for (int32 i = 0; i < count; i++)
+	{
+		RawMesh.VertexPositions[delta + i] = FVector(polygon[i].X, polygon[i].Y, height);
+	}
+
+	for (int32 i = 0; i < triangles.Num(); i++)
+	{
+		SetRawMeshWedge(RawMesh, cursor.indices + i, delta + triangles[i], uvs[triangles[i]]);
+	}
+	for (int32 face = 0; face < triangles.Num() / 3; face++)
+	{
+		RawMesh.FaceMaterialIndices[cursor.faces + face] = 0;
+		RawMesh.FaceSmoothingMasks[cursor.faces + face] = 0;
+	}
+
+	cursor.vertices += count;
+	cursor.indices += triangles.Num();
+	cursor.faces += triangles.Num() / 3;
+}
+FMeshSize MakeWallMesh_PMC(TArrayView<const FBuildingChunk> chunks, float crease_cos, FPMCMeshChunk& wall, double& count_time)
+{
+	//ÿһ״ֻ۽Ǵֶ
+	TArray<FMeshSize> chunk_sizes;
+	chunk_sizes.SetNum(chunks.Num());
+	ParallelFor(chunks.Num(), [&](int32 chunk_index)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BuildingMeshCount);
+		const FBuildingChunk& chunk = chunks[chunk_index];
+		for (int32 building_index = chunk.begin; building_index < chunk.end; building_index++)
+		{
+			CountWallStrip_PMC(chunk.buildings->GetRing(building_index), crease_cos, chunk_sizes[chunk_index]);
+		}
+	});
+	FMeshSize total = PrefixMeshSizes(chunk_sizes);
+	AllocatePMCMesh(total, true, wall);
+	count_time = FPlatformTime::Seconds();
+
+	//д룺ÿԼʼλÿʼд
+	ParallelFor(chunks.Num(), [&](int32 chunk_index)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BuildingMeshFill);
+		const FBuildingChunk& chunk = chunks[chunk_index];
+		FMeshSize cursor = chunk_sizes[chunk_index];
+		for (int32 building_index = chunk.begin; building_index < chunk.end; building_index++)
+		{
+			FBuildingView build = (*chunk.buildings)[building_index];
+			DivideWallStrip_PMC(build.coords, crease_cos, 0, build.height, wall, cursor);
+		}
+	});
+	return total;
+}
+FMeshSize MakeRoofMesh_PMC(TArrayView<const FBuildingChunk> chunks, const FBuildingRebuildCache* rebuild_cache, TArray<FRoofChunkTriangles>& chunk_triangles, FPMCMeshChunk& roof, double& count_time)
+{
+	//׶ǻд׶ֻ
+	TArray<FMeshSize> chunk_sizes;
+	chunk_triangles.SetNum(chunks.Num());
+	chunk_sizes.SetNum(chunks.Num());
+	ParallelFor(chunks.Num(), [&](int32 chunk_index)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BuildingMeshCount);
+		TArray<FBuildingView> buildings;
+		GetChunkBuildings(chunks[chunk_index], buildings);
+		CountRoofBuildings(buildings, rebuild_cache, chunk_triangles[chunk_index], chunk_sizes[chunk_index]);
+	});
+	FMeshSize total = PrefixMeshSizes(chunk_sizes);
+	AllocatePMCMesh(total, false, roof);
+	count_time = FPlatformTime::Seconds();
+
+	ParallelFor(chunks.Num(), [&](int32 chunk_index)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BuildingMeshFill);
+		const FBuildingChunk& chunk = chunks[chunk_index];
+		const FRoofChunkTriangles& roof_triangles = chunk_triangles[chunk_index];
+		FMeshSize cursor = chunk_sizes[chunk_index];
+		for (int32 i = 0; i < chunk.end - chunk.begin; i++)
+		{
+			FBuildingView build = (*chunk.buildings)[chunk.begin + i];
+			if (roof_triangles.convex[i])
+			{
+				DivideConvexPolygon_PMC(build.coords, build.height, roof, cursor);
+			}
+			else
+			{
+				TArrayView<const int32> triangles(roof_triangles.triangles.GetData() + roof_triangles.offsets[i], roof_triangles.offsets[i + 1] - roof_triangles.offsets[i]);
+				DivideConcavePolygon_PMC(build.coords, triangles, build.height, roof, cursor);
+			}
+		}
+	});
+	return total;
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FBuildingChunk;
+struct FBuildingView;
+struct FMeshSize;
+struct FPMCMeshChunk;
+struct FRawMeshView;
+struct FRoofChunkTriangles;
+class FBuildingLayer;
+class FBuildingRebuildCache;
+
+//κģжǽ桢ݶɣABuilderк決
+//ͼ洢GeoJSONȡͶӰǻݴһֻCoreJsonģ飬κUObjectBuildingCoreTests򵥶ЩļTestsеĲ
+DECLARE_LOG_CATEGORY_EXTERN(LogBuildingCore, Log, All);
+
+//ͼľγȾ͵ͶӰΪԲοī겢°ΧУ˫ԴʱԴͶӰͶӰͷ
+void ProjectBuildingLayer(FBuildingLayer& layer, double ref_north, double ref_east);
+
+//ǷߵҲ
+bool PointRightOfLine(const FVector2D& pStart, const FVector2D& pEnd, const FVector2D& point);
+//Ƿ--ζΪ˳ʱ
+bool PointInTriangle(TArrayView<const FVector2D> triangle, const FVector2D& point);
+//߶߶Ƿཻ
+bool IsSegmentCross(const FVector2D& pStart1, const FVector2D& pEnd1, const FVector2D& pStart2, const FVector2D& pEnd2);
+// Ƿڶ
+bool PointInPolygon(TArrayView<const FVector2D> polygon, const FVector2D& point);
+//㵽εľƽڶʱΪ0
+double PointPolygonDistanceSquared(TArrayView<const FVector2D> polygon, const FVector2D& point);
+//Ƿཻϵ
+bool PolygonIntersectBox(TArrayView<const FVector2D> polygon, const FBox2D& box);
+//ǷΪ͹
+bool IsConvexPoint(TArrayView<const FVector2D> polygon, int32 index);
+//ǷΪ͹
+bool IsConvexPolygon(TArrayView<const FVector2D> polygon);
+//ǷΪɷָ
+bool IsDivisiblePoint(TArrayView<const FVector2D> polygon, int32 index);
+//ǽڸõǷΪ۽ǣcrease_cosΪ۽ֵ
+bool IsCreasePoint(TArrayView<const FVector2D> polygon, int32 index, float crease_cos);
+//ǷΪĵ㣨ߵ㣩
+bool IsSurplusPoint(TArrayView<const FVector2D> polygon, int32 index);
+
+//ǽ水ɴ״cursorΪдλãдǰ
+void CountWallStrip_PMC(TArrayView<const FVector2D> polygon, float crease_cos, FMeshSize& size);
+void CountWallStrip_RawMesh(TArrayView<const FVector2D> polygon, FMeshSize& size);
+void DivideWallStrip_PMC(TArrayView<const FVector2D> polygon, float crease_cos, double bottom, double top, FPMCMeshChunk& mesh, FMeshSize& cursor);
+//ÿߵƽ飬ͬһзֶιãsmoothing_masks뻷ĵͬ
+void GetWallSmoothingMasks(TArrayView<const FVector2D> polygon, float crease_cos, TArrayView<uint32> smoothing_masks);
+void DivideWallStrip_RawMesh(TArrayView<const FVector2D> polygon, TArrayView<const uint32> smoothing_masks, double bottom, double top, const FRawMeshView& RawMesh, FMeshSize& cursor);
+
+//ݶǻβͳƶ㡢rebuild_cacheΪʱʹûǻ
+void CountRoofBuildings(TArrayView<const FBuildingView> buildings, const FBuildingRebuildCache* rebuild_cache, FRoofChunkTriangles& roof, FMeshSize& size);
+void DivideConvexPolygon_PMC(TArrayView<const FVector2D> polygon, double height, FPMCMeshChunk& mesh, FMeshSize& cursor);
+void DivideConvexPolygon_RawMesh(TArrayView<const FVector2D> polygon, double height, const FRawMeshView& RawMesh, FMeshSize& cursor);
+//trianglesΪգǻʧܣʱд룬CountRoofBuildingsļһ
+void DivideConcavePolygon_PMC(TArrayView<const FVector2D> polygon, TArrayView<const int32> triangles, double height, FPMCMeshChunk& mesh, FMeshSize& cursor);
+void DivideConcavePolygon_RawMesh(TArrayView<const FVector2D> polygon, TArrayView<const int32> triangles, double height, const FRawMeshView& RawMesh, FMeshSize& cursor);
+
+//һPMC񣺲мһηд룬count_timeΪʱ
+FMeshSize MakeWallMesh_PMC(TArrayView<const FBuildingChunk> chunks, float crease_cos, FPMCMeshChunk& wall, double& count_time);
+//ݶɫchunk_trianglesǻʱ÷ͳ
+FMeshSize MakeRoofMesh_PMC(TArrayView<const FBuildingChunk> chunks, const FBuildingRebuildCache* rebuild_cache, TArray<FRoofChunkTriangles>& chunk_triangles, FPMCMeshChunk& roof, double& count_time);
@@ -0,0 +1,423 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingGltf.h"
+#include "BuildingGeometry.h"
+#include "BuildingMeshChunks.h"
+#include "HAL/FileManager.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+#include "Templates/UniquePtr.h"
+
+//GLBļͷ
+const uint32 glb_magic = 0x46546C67;
+const uint32 glb_version = 2;
+const uint32 glb_chunk_json = 0x4E4F534A;
+const uint32 glb_chunk_bin = 0x004E4942;
+//glTFķ뻺Ŀ
+const int32 gltf_byte = 5120;
+const int32 gltf_short = 5122;
+const int32 gltf_unsigned_short = 5123;
+const int32 gltf_unsigned_int = 5125;
+const int32 gltf_float = 5126;
+const int32 gltf_array_buffer = 34962;
+const int32 gltf_element_array_buffer = 34963;
+//ݴôСʱдļ
+const int32 glb_flush_size = 64 * 1024;
+
+FBuildingGltfMesh MakeGltfMesh(const FString& name, const FPMCMeshChunk& mesh)
+{
+	FBuildingGltfMesh gltf_mesh;
+	gltf_mesh.name = name;
+	gltf_mesh.positions = mesh.Vertices;
+	gltf_mesh.normals = mesh.Normals;
+	gltf_mesh.uvs = mesh.UV;
+	gltf_mesh.indices = mesh.Index;
+	return gltf_mesh;
+}
+
+//BINеĲ֣centerscaleminmaxԴ
+struct FGlbMeshLayout
+{
+	FVector center;
+	FVector scale;
+	FVector min;
+	FVector max;
+	bool normals = false;
+	bool short_uvs = false;
+	bool short_indices = false;
+	int32 position_stride = 0;
+	int32 normal_stride = 0;
+	int32 uv_stride = 0;
+	int32 index_size = 0;
+	int64 position_offset = 0;
+	int64 normal_offset = 0;
+	int64 uv_offset = 0;
+	int64 index_offset = 0;
+};
+
+//glTFҪÿbufferView鳤Ȱ4ֽڶ
+static int64 AlignGlb(int64 size)
+{
+	return (size + 3) & ~(int64)3;
+}
+
+static void MakeGlbLayout(const FBuildingGltfMesh& mesh, bool quantize, int64& offset, FGlbMeshLayout& layout)
+{
+	FBox bounds(ForceInit);
+	for (const FVector& position : mesh.positions)
+	{
+		bounds += position;
+	}
+	layout.center = bounds.GetCenter();
+	layout.min = bounds.Min;
+	layout.max = bounds.Max;
+	//귶ΧΪ[-32767, 32767]Ϊ0ķ
+	layout.scale = FVector(1.0f, 1.0f, 1.0f);
+	if (quantize)
+	{
+		FVector extent = bounds.GetExtent();
+		for (int32 axis = 0; axis < 3; axis++)
+		{
+			layout.scale[axis] = extent[axis] > 0.0f ? extent[axis] / 32767.0f : 1.0f;
+		}
+	}
+
+	layout.normals = mesh.normals.Num() == mesh.positions.Num();
+	layout.short_uvs = quantize;
+	for (int32 i = 0; i < mesh.uvs.Num() && layout.short_uvs; i++)
+	{
+		const FVector2D& uv = mesh.uvs[i];
+		layout.short_uvs = uv.X >= 0.0f && uv.X <= 1.0f && uv.Y >= 0.0f && uv.Y <= 1.0f;
+	}
+	//65535ͼԪΪ
+	layout.short_indices = mesh.positions.Num() <= 65535;
+
+	//16λ8λ뵽4ֽ
+	layout.position_stride = quantize ? 4 * sizeof(int16) : 3 * sizeof(float);
+	layout.normal_stride = quantize ? 4 * sizeof(int8) : 3 * sizeof(float);
+	layout.uv_stride = layout.short_uvs ? 2 * sizeof(uint16) : 2 * sizeof(float);
+	layout.index_size = layout.short_indices ? sizeof(uint16) : sizeof(uint32);
+
+	int64 count = mesh.positions.Num();
+	layout.position_offset = offset;
+	offset += count * layout.position_stride;
+	if (layout.normals)
+	{
+		layout.normal_offset = offset;
+		offset += count * layout.normal_stride;
+	}
+	layout.uv_offset = offset;
+	offset += count * layout.uv_stride;
+	layout.index_offset = offset;
+	offset = AlignGlb(offset + (int64)mesh.indices.Num() * layout.index_size);
+}
+
+//԰ΧĲڵź꣬дminmaxʹͬһ
+static FVector GetGlbPosition(const FVector& position, const FGlbMeshLayout& layout)
+{
+	return (position - layout.center) / layout.scale;
+}
+
+static int32 QuantizeGlb(float value, int32 limit)
+{
+	return FMath::Clamp(FMath::RoundToInt(value), -limit, limit);
+}
+
+//UEΪϵZϣglTFΪϵYϣYZ
+static TArray<TSharedPtr<FJsonValue>> MakeGlbVector(const FVector& value)
+{
+	return { MakeShared<FJsonValueNumber>(value.X), MakeShared<FJsonValueNumber>(value.Z), MakeShared<FJsonValueNumber>(value.Y) };
+}
+
+static int32 AddGlbView(TArray<TSharedPtr<FJsonValue>>& views, int64 offset, int64 length, int32 stride, int32 target)
+{
+	TSharedRef<FJsonObject> view = MakeShared<FJsonObject>();
+	view->SetNumberField(TEXT("buffer"), 0);
+	view->SetNumberField(TEXT("byteOffset"), (double)offset);
+	view->SetNumberField(TEXT("byteLength"), (double)length);
+	if (stride > 0)
+	{
+		view->SetNumberField(TEXT("byteStride"), stride);
+	}
+	view->SetNumberField(TEXT("target"), target);
+	views.Add(MakeShared<FJsonValueObject>(view));
+	return views.Num() - 1;
+}
+
+static TSharedRef<FJsonObject> AddGlbAccessor(TArray<TSharedPtr<FJsonValue>>& accessors, int32 view, int32 component_type, bool normalized, int32 count, const TCHAR* type)
+{
+	TSharedRef<FJsonObject> accessor = MakeShared<FJsonObject>();
+	accessor->SetNumberField(TEXT("bufferView"), view);
+	accessor->SetNumberField(TEXT("componentType"), component_type);
+	if (normalized)
+	{
+		accessor->SetBoolField(TEXT("normalized"), true);
+	}
+	accessor->SetNumberField(TEXT("count"), count);
+	accessor->SetStringField(TEXT("type"), type);
+	accessors.Add(MakeShared<FJsonValueObject>(accessor));
+	return accessor;
+}
+
+static FString MakeGlbJson(TArrayView<const FBuildingGltfMesh> meshes, TArrayView<const FGlbMeshLayout> layouts, bool quantize, int64 bin_length)
+{
+	TArray<TSharedPtr<FJsonValue>> views;
+	TArray<TSharedPtr<FJsonValue>> accessors;
+	TArray<TSharedPtr<FJsonValue>> gltf_meshes;
+	TArray<TSharedPtr<FJsonValue>> nodes;
+	TArray<TSharedPtr<FJsonValue>> scene_nodes;
+	for (int32 mesh_index = 0; mesh_index < meshes.Num(); mesh_index++)
+	{
+		const FBuildingGltfMesh& mesh = meshes[mesh_index];
+		const FGlbMeshLayout& layout = layouts[mesh_index];
+		int32 count = mesh.positions.Num();
+		TSharedRef<FJsonObject> attributes = MakeShared<FJsonObject>();
+
+		int32 view = AddGlbView(views, layout.position_offset, (int64)count * layout.position_stride, layout.position_stride, gltf_array_buffer);
+		TSharedRef<FJsonObject> position = AddGlbAccessor(accessors, view, quantize ? gltf_short : gltf_float, false, count, TEXT("VEC3"));
+		FVector min = GetGlbPosition(layout.min, layout);
+		FVector max = GetGlbPosition(layout.max, layout);
+		if (quantize)
+		{
+			min = FVector(QuantizeGlb(min.X, 32767), QuantizeGlb(min.Y, 32767), QuantizeGlb(min.Z, 32767));
+			max = FVector(QuantizeGlb(max.X, 32767), QuantizeGlb(max.Y, 32767), QuantizeGlb(max.Z, 32767));
+		}
+		position->SetArrayField(TEXT("min"), MakeGlbVector(min));
+		position->SetArrayField(TEXT("max"), MakeGlbVector(max));
+		attributes->SetNumberField(TEXT("POSITION"), accessors.Num() - 1);
+
+		if (layout.normals)
+		{
+			view = AddGlbView(views, layout.normal_offset, (int64)count * layout.normal_stride, layout.normal_stride, gltf_array_buffer);
+			AddGlbAccessor(accessors, view, quantize ? gltf_byte : gltf_float, quantize, count, TEXT("VEC3"));
+			attributes->SetNumberField(TEXT("NORMAL"), accessors.Num() - 1);
+		}
+
+		view = AddGlbView(views, layout.uv_offset, (int64)count * layout.uv_stride, layout.uv_stride, gltf_array_buffer);
+		AddGlbAccessor(accessors, view, layout.short_uvs ? gltf_unsigned_short : gltf_float, layout.short_uvs, count, TEXT("VEC2"));
+		attributes->SetNumberField(TEXT("TEXCOORD_0"), accessors.Num() - 1);
+
+		view = AddGlbView(views, layout.index_offset, (int64)mesh.indices.Num() * layout.index_size, 0, gltf_element_array_buffer);
+		AddGlbAccessor(accessors, view, layout.short_indices ? gltf_unsigned_short : gltf_unsigned_int, false, mesh.indices.Num(), TEXT("SCALAR"));
+
+		TSharedRef<FJsonObject> primitive = MakeShared<FJsonObject>();
+		primitive->SetObjectField(TEXT("attributes"), attributes);
+		primitive->SetNumberField(TEXT("indices"), accessors.Num() - 1);
+		primitive->SetNumberField(TEXT("mode"), 4);
+		TSharedRef<FJsonObject> gltf_mesh = MakeShared<FJsonObject>();
+		gltf_mesh->SetStringField(TEXT("name"), mesh.name);
+		gltf_mesh->SetArrayField(TEXT("primitives"), { MakeShared<FJsonValueObject>(primitive) });
+		gltf_meshes.Add(MakeShared<FJsonValueObject>(gltf_mesh));
+
+		TSharedRef<FJsonObject> node = MakeShared<FJsonObject>();
+		node->SetStringField(TEXT("name"), mesh.name);
+		node->SetNumberField(TEXT("mesh"), mesh_index);
+		node->SetArrayField(TEXT("translation"), MakeGlbVector(layout.center));
+		if (quantize)
+		{
+			node->SetArrayField(TEXT("scale"), MakeGlbVector(layout.scale));
+		}
+		nodes.Add(MakeShared<FJsonValueObject>(node));
+		scene_nodes.Add(MakeShared<FJsonValueNumber>(mesh_index));
+	}
+
+	TSharedRef<FJsonObject> asset = MakeShared<FJsonObject>();
+	asset->SetStringField(TEXT("version"), TEXT("2.0"));
+	asset->SetStringField(TEXT("generator"), TEXT("buildingbuilder"));
+	TSharedRef<FJsonObject> scene = MakeShared<FJsonObject>();
+	scene->SetArrayField(TEXT("nodes"), scene_nodes);
+
+	TSharedRef<FJsonObject> root = MakeShared<FJsonObject>();
+	root->SetObjectField(TEXT("asset"), asset);
+	root->SetNumberField(TEXT("scene"), 0);
+	root->SetArrayField(TEXT("scenes"), { MakeShared<FJsonValueObject>(scene) });
+	root->SetArrayField(TEXT("nodes"), nodes);
+	if (meshes.Num() > 0)
+	{
+		TSharedRef<FJsonObject> buffer = MakeShared<FJsonObject>();
+		buffer->SetNumberField(TEXT("byteLength"), (double)bin_length);
+		root->SetArrayField(TEXT("meshes"), gltf_meshes);
+		root->SetArrayField(TEXT("accessors"), accessors);
+		root->SetArrayField(TEXT("bufferViews"), views);
+		root->SetArrayField(TEXT("buffers"), { MakeShared<FJsonValueObject>(buffer) });
+	}
+	if (quantize)
+	{
+		TArray<TSharedPtr<FJsonValue>> extensions = { MakeShared<FJsonValueString>(TEXT("KHR_mesh_quantization")) };
+		root->SetArrayField(TEXT("extensionsUsed"), extensions);
+		root->SetArrayField(TEXT("extensionsRequired"), extensions);
+	}
+
+	FString json;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&json);
+	FJsonSerializer::Serialize(root, writer);
+	return json;
+}
+
+template<typename ValueType>
+static void AppendGlb(TArray<uint8>& block, const ValueType* values, int32 count)
+{
+	block.Append(reinterpret_cast<const uint8*>(values), sizeof(ValueType) * count);
+}
+
+static bool FlushGlb(FArchive& writer, TArray<uint8>& block, bool force)
+{
+	if (force || block.Num() >= glb_flush_size)
+	{
+		writer.Serialize(block.GetData(), block.Num());
+		block.Reset();
+	}
+	return !writer.IsError();
+}
+
+//ֵ˳תд룬ݴֻһС
+static bool WriteGlbMesh(FArchive& writer, const FBuildingGltfMesh& mesh, const FGlbMeshLayout& layout, bool quantize, TArray<uint8>& block)
+{
+	for (int32 i = 0; i < mesh.positions.Num(); i++)
+	{
+		FVector position = GetGlbPosition(mesh.positions[i], layout);
+		if (quantize)
+		{
+			int16 value[4] = { (int16)QuantizeGlb(position.X, 32767), (int16)QuantizeGlb(position.Z, 32767), (int16)QuantizeGlb(position.Y, 32767), 0 };
+			AppendGlb(block, value, 4);
+		}
+		else
+		{
+			float value[3] = { position.X, position.Z, position.Y };
+			AppendGlb(block, value, 3);
+		}
+		if (!FlushGlb(writer, block, false))
+		{
+			return false;
+		}
+	}
+
+	for (int32 i = 0; layout.normals && i < mesh.normals.Num(); i++)
+	{
+		if (quantize)
+		{
+			//ڵķǵȱŻᰴתõϣԤȳŵ
+			FVector normal = (mesh.normals[i] * layout.scale).GetSafeNormal();
+			int8 value[4] = { (int8)QuantizeGlb(normal.X * 127.0f, 127), (int8)QuantizeGlb(normal.Z * 127.0f, 127), (int8)QuantizeGlb(normal.Y * 127.0f, 127), 0 };
+			AppendGlb(block, value, 4);
+		}
+		else
+		{
+			const FVector& normal = mesh.normals[i];
+			float value[3] = { normal.X, normal.Z, normal.Y };
+			AppendGlb(block, value, 3);
+		}
+		if (!FlushGlb(writer, block, false))
+		{
+			return false;
+		}
+	}
+
+	for (int32 i = 0; i < mesh.positions.Num(); i++)
+	{
+		FVector2D uv = i < mesh.uvs.Num() ? mesh.uvs[i] : FVector2D::ZeroVector;
+		if (layout.short_uvs)
+		{
+			uint16 value[2] = { (uint16)FMath::RoundToInt(uv.X * 65535.0f), (uint16)FMath::RoundToInt(uv.Y * 65535.0f) };
+			AppendGlb(block, value, 2);
+		}
+		else
+		{
+			float value[2] = { uv.X, uv.Y };
+			AppendGlb(block, value, 2);
+		}
+		if (!FlushGlb(writer, block, false))
+		{
+			return false;
+		}
+	}
+
+	for (int32 i = 0; i < mesh.indices.Num(); i++)
+	{
+		if (layout.short_indices)
+		{
+			uint16 value = (uint16)mesh.indices[i];
+			AppendGlb(block, &value, 1);
+		}
+		else
+		{
+			uint32 value = (uint32)mesh.indices[i];
+			AppendGlb(block, &value, 1);
+		}
+		if (!FlushGlb(writer, block, false))
+		{
+			return false;
+		}
+	}
+	int64 index_length = (int64)mesh.indices.Num() * layout.index_size;
+	block.AddZeroed(AlignGlb(index_length) - index_length);
+	return true;
+}
+
+bool WriteBuildingGlb(const FString& file_name, TArrayView<const FBuildingGltfMesh> meshes, bool quantize)
+{
+	//glTFķһԪأ
+	TArray<FBuildingGltfMesh> valid_meshes;
+	for (const FBuildingGltfMesh& mesh : meshes)
+	{
+		if (mesh.positions.Num() > 0 && mesh.indices.Num() > 0)
+		{
+			valid_meshes.Add(mesh);
+		}
+	}
+
+	//ȷBINеλãJSONдBIN֮ǰ
+	TArray<FGlbMeshLayout> layouts;
+	layouts.SetNum(valid_meshes.Num());
+	int64 bin_length = 0;
+	for (int32 mesh_index = 0; mesh_index < valid_meshes.Num(); mesh_index++)
+	{
+		MakeGlbLayout(valid_meshes[mesh_index], quantize, bin_length, layouts[mesh_index]);
+	}
+	FTCHARToUTF8 json(*MakeGlbJson(valid_meshes, layouts, quantize, bin_length));
+	int64 json_length = AlignGlb(json.Length());
+	int64 file_length = 12 + 8 + json_length + (bin_length > 0 ? 8 + bin_length : 0);
+	if (file_length > MAX_uint32)
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("glb larger than 4 GB: %s"), *file_name);
+		return false;
+	}
+
+	TUniquePtr<FArchive> writer(IFileManager::Get().CreateFileWriter(*file_name));
+	if (!writer)
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("create glb failed: %s"), *file_name);
+		return false;
+	}
+	uint32 header[5] = { glb_magic, glb_version, (uint32)file_length, (uint32)json_length, glb_chunk_json };
+	writer->Serialize(header, sizeof(header));
+	writer->Serialize((void*)json.Get(), json.Length());
+	//JSONÿո
+	for (int64 i = json.Length(); i < json_length; i++)
+	{
+		uint8 space = ' ';
+		writer->Serialize(&space, 1);
+	}
+
+	if (bin_length > 0)
+	{
+		uint32 bin_header[2] = { (uint32)bin_length, glb_chunk_bin };
+		writer->Serialize(bin_header, sizeof(bin_header));
+		TArray<uint8> block;
+		block.Reserve(glb_flush_size + 64);
+		for (int32 mesh_index = 0; mesh_index < valid_meshes.Num(); mesh_index++)
+		{
+			if (!WriteGlbMesh(*writer, valid_meshes[mesh_index], layouts[mesh_index], quantize, block))
+			{
+				break;
+			}
+		}
+		FlushGlb(*writer, block, true);
+	}
+
+	if (writer->IsError() || !writer->Close())
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("write glb failed: %s"), *file_name);
+		return false;
+	}
+	return true;
+}
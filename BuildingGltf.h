@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FPMCMeshChunk;
+
+//һglTFֻһͼԪnormalsΪʱдߣΪͶӰ꣨ףZϣ
+struct FBuildingGltfMesh
+{
+	FString name;
+	TArrayView<const FVector> positions;
+	TArrayView<const FVector> normals;
+	TArrayView<const FVector2D> uvs;
+	TArrayView<const int32> indices;
+};
+
+FBuildingGltfMesh MakeGltfMesh(const FString& name, const FPMCMeshChunk& mesh);
+
+//дglTFÿһڵ㣬Χı棬ƽƷڽڵϣ65535ʱʹ16λ
+//ݲм仺תֱдBIN飻ÿԵһbufferViewmeshoptȹ߰ѹ
+//quantizeʱKHR_mesh_quantization棺Ϊ16λŷڽڵϣΪ8λ[0,1]ʱΪ16λ
+bool WriteBuildingGlb(const FString& file_name, TArrayView<const FBuildingGltfMesh> meshes, bool quantize);
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingImageDecoder.h"
+#include "BuildingBakeReport.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/Crc.h"
+#include "Async/ParallelFor.h"
+
+static EImageFormat GetImageFormat(const FString& image_path)
+{
+	FString Ex = FPaths::GetExtension(image_path, false);
+	if (Ex.Equals(TEXT("jpg"), ESearchCase::IgnoreCase) || Ex.Equals(TEXT("jpeg"), ESearchCase::IgnoreCase))
+	{
+		return EImageFormat::JPEG;
+	}
+	if (Ex.Equals(TEXT("png"), ESearchCase::IgnoreCase))
+	{
+		return EImageFormat::PNG;
+	}
+	if (Ex.Equals(TEXT("bmp"), ESearchCase::IgnoreCase))
+	{
+		return EImageFormat::BMP;
+	}
+	return EImageFormat::Invalid;
+}
+
+bool DecodeImage(const FString& image_path, FDecodedImage& image)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BuildingImageDecode);
+	EImageFormat ImageFormat = GetImageFormat(image_path);
+	if (ImageFormat == EImageFormat::Invalid)
+	{
+		return false;
+	}
+	TArray<uint8> ImageResultData;
+	if (!FFileHelper::LoadFileToArray(ImageResultData, *image_path, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>("ImageWrapper");
+	TSharedPtr<IImageWrapper> ImageWrapperPtr = ImageWrapperModule.CreateImageWrapper(ImageFormat);
+	if (!ImageWrapperPtr.IsValid() || !ImageWrapperPtr->SetCompressed(ImageResultData.GetData(), ImageResultData.Num())
+		|| !ImageWrapperPtr->GetRaw(ERGBFormat::BGRA, 8, image.pixels))
+	{
+		return false;
+	}
+	image.path = image_path;
+	image.hash = FCrc::MemCrc32(ImageResultData.GetData(), ImageResultData.Num());
+	image.width = ImageWrapperPtr->GetWidth();
+	image.height = ImageWrapperPtr->GetHeight();
+	return true;
+}
+
+void DecodeImages(TArrayView<const FString> image_paths, TMap<FString, FDecodedImage>& images)
+{
+	TArray<FDecodedImage> decoded;
+	TArray<bool> succeeded;
+	decoded.SetNum(image_paths.Num());
+	succeeded.SetNumZeroed(image_paths.Num());
+	ParallelFor(image_paths.Num(), [&](int32 i)
+	{
+		succeeded[i] = DecodeImage(image_paths[i], decoded[i]);
+	});
+	for (int32 i = 0; i < image_paths.Num(); i++)
+	{
+		if (succeeded[i])
+		{
+			images.Add(image_paths[i], MoveTemp(decoded[i]));
+		}
+	}
+}
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//ͼΪBGRA8hashΪԴļݹϣжѱͼԴǷ
+struct FDecodedImage
+{
+	FString path;
+	uint32 hash = 0;
+	int32 width = 0;
+	int32 height = 0;
+	TArray<uint8> pixels;
+};
+
+//ȡ뵥ͼ֧pngjpgbmpļڻʽ֧ʱfalse
+//ImageWrapperģϷ̼߳
+bool DecodeImage(const FString& image_path, FDecodedImage& image);
+//ͼڹ߳ϲн룬ʧܵͼimages
+void DecodeImages(TArrayView<const FString> image_paths, TMap<FString, FDecodedImage>& images);
@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingInstances.h"
+#include "BuildingLayer.h"
+#include "BuildingMeshChunks.h"
+#include "BuildingScratch.h"
+#include "Async/ParallelFor.h"
+
+//ģ׵ԱȣΪ0ʱȡƽ
+static FVector GetRingCentroid(TArrayView<const FVector2D> ring)
+{
+	const FVector2D& base = ring[0];
+	double area = 0.0;
+	double x = 0.0;
+	double y = 0.0;
+	double mean_x = 0.0;
+	double mean_y = 0.0;
+	for (int32 i = 0, j = ring.Num() - 1; i < ring.Num(); j = i++)
+	{
+		double xi = (double)ring[i].X - base.X;
+		double yi = (double)ring[i].Y - base.Y;
+		double xj = (double)ring[j].X - base.X;
+		double yj = (double)ring[j].Y - base.Y;
+		double cross = xj * yi - xi * yj;
+		area += cross;
+		x += (xj + xi) * cross;
+		y += (yj + yi) * cross;
+		mean_x += xi;
+		mean_y += yi;
+	}
+	if (FMath::Abs(area) <= DBL_EPSILON)
+	{
+		return FVector(base.X + mean_x / ring.Num(), base.Y + mean_y / ring.Num(), 0.0f);
+	}
+	return FVector(base.X + x / (3.0 * area), base.Y + y / (3.0 * area), 0.0f);
+}
+
+//еֵȽ
+static bool IsKeyLess(TArrayView<const int32> a, TArrayView<const int32> b)
+{
+	for (int32 i = 0; i < a.Num() && i < b.Num(); i++)
+	{
+		if (a[i] != b[i])
+		{
+			return a[i] < b[i];
+		}
+	}
+	return a.Num() < b.Num();
+}
+
+bool CanonicalizeRing(TArrayView<const FVector2D> ring, double quantize_size, TArray<FVector2D>& canonical, TArray<int32>& key, FTransform& transform)
+{
+	int32 count = ring.Num();
+	canonical.Reset(count);
+	key.Reset(2 * count);
+	if (count < 3 || quantize_size <= 0.0)
+	{
+		return false;
+	}
+	FVector centroid = GetRingCentroid(ring);
+
+	//̲ȵı߶ΪѡεȶԳ״ֻ
+	double max_length = 0.0;
+	for (int32 i = 0; i < count; i++)
+	{
+		max_length = FMath::Max(max_length, (double)FVector2D::Distance(ring[i], ring[i + 1 == count ? 0 : i + 1]));
+	}
+	if (max_length <= quantize_size)
+	{
+		return false;
+	}
+
+	//ѡ̬ʱݴݴ䣬ÿͷ
+	FBuildingScratchMark scratch_mark;
+	TBuildingScratchArray<FVector2D> local;
+	TBuildingScratchArray<FVector2D> best_local;
+	TBuildingScratchArray<int32> candidate;
+	TBuildingScratchArray<int32> best_candidate;
+	double best_angle = 0.0;
+	bool found = false;
+	for (int32 i = 0; i < count; i++)
+	{
+		const FVector2D& start = ring[i];
+		const FVector2D& end = ring[i + 1 == count ? 0 : i + 1];
+		double dx = (double)end.X - start.X;
+		double dy = (double)end.Y - start.Y;
+		if (FMath::Sqrt(dx * dx + dy * dy) < max_length - quantize_size)
+		{
+			continue;
+		}
+
+		//ת-angleʹʼX
+		double angle = FMath::Atan2(dy, dx);
+		double cos_angle = FMath::Cos(angle);
+		double sin_angle = FMath::Sin(angle);
+		local.Reset(count);
+		candidate.Reset(2 * count);
+		for (int32 k = 0; k < count; k++)
+		{
+			const FVector2D& point = ring[(i + k) % count];
+			double x = (double)point.X - centroid.X;
+			double y = (double)point.Y - centroid.Y;
+			double local_x = cos_angle * x + sin_angle * y;
+			double local_y = cos_angle * y - sin_angle * x;
+			local.Add(FVector2D(local_x, local_y));
+			candidate.Add(FMath::RoundToInt(local_x / quantize_size));
+			candidate.Add(FMath::RoundToInt(local_y / quantize_size));
+		}
+		if (!found || IsKeyLess(candidate, best_candidate))
+		{
+			Swap(best_candidate, candidate);
+			Swap(best_local, local);
+			best_angle = angle;
+			found = true;
+		}
+	}
+
+	key.Append(best_candidate);
+	canonical.Append(best_local);
+	transform = FTransform(FQuat(FVector::UpVector, best_angle), centroid);
+	return found;
+}
+
+void FindBuildingPrototypes(const TMap<int32, FBuildingLayer>& layer_data, double quantize_size, int32 min_instances,
+	TMap<int32, FBuildingLayer>& prototype_data, TMap<int32, TArray<FBuildingInstances>>& prototype_instances)
+{
+	prototype_data.Empty();
+	prototype_instances.Empty();
+	//ֻһʵ״ֵõԭ
+	min_instances = FMath::Max(min_instances, 2);
+
+	for (auto it_layer_data = layer_data.begin(); it_layer_data != layer_data.end(); ++it_layer_data)
+	{
+		const FBuildingLayer& buildings = it_layer_data->Value;
+		TArray<TArray<int32>> keys;
+		TArray<FTransform> transforms;
+		keys.SetNum(buildings.Num());
+		transforms.SetNum(buildings.Num());
+		int32 chunk_count = FMath::DivideAndRoundUp(buildings.Num(), building_chunk_size);
+		ParallelFor(chunk_count, [&](int32 chunk_index)
+		{
+			int32 end = FMath::Min((chunk_index + 1) * building_chunk_size, buildings.Num());
+			TArray<FVector2D> canonical;
+			for (int32 i = chunk_index * building_chunk_size; i < end; i++)
+			{
+				if (CanonicalizeRing(buildings.GetRing(i), quantize_size, canonical, keys[i], transforms[i]))
+				{
+					keys[i].Add(FMath::RoundToInt(buildings.GetHeight(i) / quantize_size));
+				}
+			}
+		});
+
+		//ϣͬʱٱȽkeyײѲͬ״ϲ
+		TMap<uint32, TArray<int32>> hash_groups;
+		TArray<TArray<int32>> groups;
+		for (int32 i = 0; i < buildings.Num(); i++)
+		{
+			if (keys[i].Num() == 0)
+			{
+				continue;
+			}
+			uint32 hash = FCrc::MemCrc32(keys[i].GetData(), keys[i].Num() * sizeof(int32));
+			TArray<int32>& candidates = hash_groups.FindOrAdd(hash);
+			int32 group = INDEX_NONE;
+			for (int32 candidate : candidates)
+			{
+				if (keys[groups[candidate][0]] == keys[i])
+				{
+					group = candidate;
+					break;
+				}
+			}
+			if (group == INDEX_NONE)
+			{
+				group = groups.AddDefaulted();
+				candidates.Add(group);
+			}
+			groups[group].Add(i);
+		}
+
+		FBuildingLayer prototypes;
+		TArray<FBuildingInstances> instances;
+		TArray<FVector2D> canonical;
+		TArray<int32> key;
+		FTransform transform;
+		for (const TArray<int32>& group : groups)
+		{
+			if (group.Num() < min_instances)
+			{
+				continue;
+			}
+			//ԭȡһʵı׼̬ʵĲ
+			FBuildingView first = buildings[group[0]];
+			CanonicalizeRing(first.coords, quantize_size, canonical, key, transform);
+			prototypes.AddBuilding(first.code, first.height, canonical);
+
+			FBuildingInstances& prototype_instance = instances.AddDefaulted_GetRef();
+			prototype_instance.building_indices = group;
+			prototype_instance.transforms.Reserve(group.Num());
+			for (int32 index : group)
+			{
+				prototype_instance.transforms.Add(transforms[index]);
+			}
+		}
+		if (prototypes.Num() > 0)
+		{
+			prototype_data.Add(it_layer_data->Key, MoveTemp(prototypes));
+			prototype_instances.Add(it_layer_data->Key, MoveTemp(instances));
+		}
+	}
+}
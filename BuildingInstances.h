@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBuildingLayer;
+
+//ͬһԭ͵ʵͼеñ任ZתƽƵģ
+struct FBuildingInstances
+{
+	TArray<int32> building_indices;
+	TArray<FTransform> transforms;
+};
+
+//ѻƽƵġתXᣬȡֵСһ֣
+//keyΪУkeyͬΪͬһ״
+bool CanonicalizeRing(TArrayView<const FVector2D> ring, double quantize_size, TArray<FVector2D>& canonical, TArray<int32>& key, FTransform& transform);
+
+//ͼ״߶ͬĽʵmin_instancesԭ
+//prototype_dataͼݽṹһ£ԭΪ׼̬µĽprototype_instances֮һһӦ
+void FindBuildingPrototypes(const TMap<int32, FBuildingLayer>& layer_data, double quantize_size, int32 min_instances,
+	TMap<int32, FBuildingLayer>& prototype_data, TMap<int32, TArray<FBuildingInstances>>& prototype_instances);
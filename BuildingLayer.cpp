@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingLayer.h"
+
+static FBox2D GetRingBounds(TArrayView<const FVector2D> ring)
+{
+	FBox2D bounds(ForceInit);
+	for (const FVector2D& coord : ring)
+	{
+		bounds += coord;
+	}
+	return bounds;
+}
+
+FBuildingLayer::FBuildingLayer()
+{
+	m_ring_offsets.Add(0);
+}
+
+void FBuildingLayer::Empty(int32 building_count, int32 coord_count)
+{
+	m_coords.Empty(coord_count);
+	ReleaseSourceCoords();
+	m_ring_offsets.Empty(building_count + 1);
+	m_ring_offsets.Add(0);
+	m_heights.Empty(building_count);
+	m_codes.Empty(building_count);
+	m_bounds.Empty(building_count);
+}
+
+void FBuildingLayer::Truncate(int32 building_count)
+{
+	if (building_count >= Num())
+	{
+		return;
+	}
+	m_coords.SetNum(m_ring_offsets[building_count], false);
+	if (m_source_storage.IsValid())
+	{
+		m_source_view = m_source_view.Slice(0, m_ring_offsets[building_count] * 2);
+	}
+	else if (HasSourceCoords())
+	{
+		m_source_coords.SetNum(m_ring_offsets[building_count] * 2, false);
+	}
+	m_ring_offsets.SetNum(building_count + 1, false);
+	m_heights.SetNum(building_count, false);
+	m_codes.SetNum(building_count, false);
+	m_bounds.SetNum(building_count, false);
+}
+
+int32 FBuildingLayer::AddBuilding(int32 code, double height, TArrayView<const FVector2D> ring)
+{
+	check(!HasSourceCoords());
+	m_coords.Append(ring.GetData(), ring.Num());
+	m_ring_offsets.Add(m_coords.Num());
+	m_heights.Add(height);
+	m_bounds.Add(GetRingBounds(ring));
+	return m_codes.Add(code);
+}
+
+int32 FBuildingLayer::AddSourceBuilding(int32 code, double height, TArrayView<const double> lonlat)
+{
+	check(HasSourceCoords() || NumCoords() == 0);
+	detachSourceCoords();
+	int32 count = lonlat.Num() / 2;
+	int32 first = m_coords.Num();
+	m_source_coords.Append(lonlat.GetData(), count * 2);
+	m_coords.SetNumUninitialized(first + count);
+	for (int32 i = 0; i < count; i++)
+	{
+		m_coords[first + i] = FVector2D(lonlat[2 * i], lonlat[2 * i + 1]);
+	}
+	m_ring_offsets.Add(m_coords.Num());
+	m_heights.Add(height);
+	m_bounds.Add(GetRingBounds(GetRing(m_codes.Num())));
+	return m_codes.Add(code);
+}
+
+void FBuildingLayer::Append(const FBuildingLayer& other)
+{
+	//ͼ㶼γȣΪգʱϲ
+	bool keep_source = (HasSourceCoords() || NumCoords() == 0) && (other.HasSourceCoords() || other.NumCoords() == 0);
+	int32 coord_offset = m_coords.Num();
+	m_coords.Append(other.m_coords);
+	if (keep_source)
+	{
+		detachSourceCoords();
+		TArrayView<const double> other_source = other.GetSourceCoords();
+		m_source_coords.Append(other_source.GetData(), other_source.Num());
+	}
+	else
+	{
+		ReleaseSourceCoords();
+	}
+	m_ring_offsets.Reserve(m_ring_offsets.Num() + other.Num());
+	for (int32 i = 1; i < other.m_ring_offsets.Num(); i++)
+	{
+		m_ring_offsets.Add(coord_offset + other.m_ring_offsets[i]);
+	}
+	m_heights.Append(other.m_heights);
+	m_codes.Append(other.m_codes);
+	m_bounds.Append(other.m_bounds);
+}
+
+void FBuildingLayer::SetAttributes(int32 index, int32 code, double height)
+{
+	m_codes[index] = code;
+	m_heights[index] = height;
+}
+
+void FBuildingLayer::UpdateBounds()
+{
+	for (int32 i = 0; i < Num(); i++)
+	{
+		m_bounds[i] = GetRingBounds(GetRing(i));
+	}
+}
+
+void FBuildingLayer::ReleaseSourceCoords()
+{
+	m_source_coords.Empty();
+	m_source_storage.Reset();
+	m_source_view = TArrayView<const double>();
+}
+
+void FBuildingLayer::detachSourceCoords()
+{
+	if (m_source_storage.IsValid())
+	{
+		TArrayView<const double> source = m_source_view;
+		m_source_coords = TArray<double>(source.GetData(), source.Num());
+		m_source_storage.Reset();
+		m_source_view = TArrayView<const double>();
+	}
+}
+
+bool FBuildingLayer::SetData(TArrayView<const int32> codes, TArrayView<const double> heights, TArrayView<const uint64> offsets, TArrayView<const double> lonlat,
+	TSharedPtr<IBuildingSourceStorage> lonlat_storage)
+{
+	int32 building_count = codes.Num();
+	int32 coord_count = lonlat.Num() / 2;
+	if (heights.Num() != building_count || offsets.Num() != building_count + 1 || offsets[0] != 0 || offsets[building_count] != (uint64)coord_count)
+	{
+		return false;
+	}
+	Empty(building_count, coord_count);
+	for (int32 i = 0; i < building_count; i++)
+	{
+		if (offsets[i] > offsets[i + 1])
+		{
+			Empty();
+			return false;
+		}
+		m_ring_offsets.Add((int32)offsets[i + 1]);
+	}
+	if (lonlat_storage.IsValid())
+	{
+		m_source_storage = MoveTemp(lonlat_storage);
+		m_source_view = lonlat.Slice(0, coord_count * 2);
+	}
+	else
+	{
+		m_source_coords.SetNumUninitialized(coord_count * 2);
+		FMemory::Memcpy(m_source_coords.GetData(), lonlat.GetData(), coord_count * 2 * sizeof(double));
+	}
+	m_coords.SetNumUninitialized(coord_count);
+	for (int32 i = 0; i < coord_count; i++)
+	{
+		m_coords[i] = FVector2D(lonlat[2 * i], lonlat[2 * i + 1]);
+	}
+	m_codes.Append(codes.GetData(), building_count);
+	m_heights.Append(heights.GetData(), building_count);
+	m_bounds.SetNumUninitialized(building_count);
+	UpdateBounds();
+	return true;
+}
+
+SIZE_T FBuildingLayer::GetAllocatedSize() const
+{
+	return m_coords.GetAllocatedSize() + m_source_coords.GetAllocatedSize() + m_ring_offsets.GetAllocatedSize() + m_heights.GetAllocatedSize()
+		+ m_codes.GetAllocatedSize() + m_bounds.GetAllocatedSize();
+}
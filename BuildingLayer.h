@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//ֻͼָͼ飬ͼ޸ĺʧЧ
+struct FBuildingView
+{
+	int32 code;
+	double height;
+	TArrayView<const FVector2D> coords;
+	FBox2D bounds;
+};
+
+//ͼõⲿγȴ洢绺ļڴӳ䣩ͼڼ䱣Ч
+class IBuildingSourceStorage
+{
+public:
+	virtual ~IBuildingSourceStorage() {}
+};
+
+//ͼ㽨洢⻷δһУiΪ[ring_offsets[i], ring_offsets[i + 1])
+//߶ȡ롢ΧаŴڲУÿͼֻй̶ζѷ
+class FBuildingLayer
+{
+public:
+	FBuildingLayer();
+
+	int32 Num() const { return m_codes.Num(); }
+	int32 NumCoords() const { return m_coords.Num(); }
+	void Empty(int32 building_count = 0, int32 coord_count = 0);
+	//ֻǰbuilding_count
+	void Truncate(int32 building_count);
+
+	//׷һ
+	int32 AddBuilding(int32 code, double height, TArrayView<const FVector2D> ring);
+	//׷һγȽlonlatΪȡγȽ˫ꣻͼеĽȫַʽ
+	int32 AddSourceBuilding(int32 code, double height, TArrayView<const double> lonlat);
+	//˳׷һͼȫ
+	void Append(const FBuildingLayer& other);
+	void SetAttributes(int32 index, int32 code, double height);
+
+	FBuildingView operator[](int32 index) const
+	{
+		return FBuildingView{ m_codes[index], m_heights[index], GetRing(index), m_bounds[index] };
+	}
+	TArrayView<const FVector2D> GetRing(int32 index) const
+	{
+		return TArrayView<const FVector2D>(m_coords.GetData() + m_ring_offsets[index], m_ring_offsets[index + 1] - m_ring_offsets[index]);
+	}
+	int32 GetRingSize(int32 index) const { return m_ring_offsets[index + 1] - m_ring_offsets[index]; }
+	int32 GetCode(int32 index) const { return m_codes[index]; }
+	double GetHeight(int32 index) const { return m_heights[index]; }
+	const FBox2D& GetBounds(int32 index) const { return m_bounds[index]; }
+
+	//ȫ꣬˳ţֱ޸ĺUpdateBounds
+	TArrayView<const FVector2D> GetCoords() const { return m_coords; }
+	TArrayView<FVector2D> GetMutableCoords() { return m_coords; }
+	void UpdateBounds();
+
+	//õ˫ȾγȣGetCoordsһһӦȡγȽţȵľγԼ1ͶӰֻʹ
+	//ͶӰͷţ֮Ϊ
+	bool HasSourceCoords() const { return GetSourceCoords().Num() > 0; }
+	TArrayView<const double> GetSourceCoords() const { return m_source_storage.IsValid() ? m_source_view : TArrayView<const double>(m_source_coords); }
+	void ReleaseSourceCoords();
+
+	//洢Ķ룬offsetsbuilding_count + 1Ϊ0ĩΪlonlatΪ˫Ⱦγ
+	//lonlat_storageΪʱֱlonlatиô洢γȣͶӰReleaseSourceCoordsͷ
+	bool SetData(TArrayView<const int32> codes, TArrayView<const double> heights, TArrayView<const uint64> offsets, TArrayView<const double> lonlat,
+		TSharedPtr<IBuildingSourceStorage> lonlat_storage = nullptr);
+
+	SIZE_T GetAllocatedSize() const;
+
+	//˳for (FBuildingView building : layer)
+	class FIterator
+	{
+	public:
+		FIterator(const FBuildingLayer& layer, int32 index) : m_layer(layer), m_index(index) {}
+		FBuildingView operator*() const { return m_layer[m_index]; }
+		FIterator& operator++() { m_index++; return *this; }
+		bool operator!=(const FIterator& other) const { return m_index != other.m_index; }
+
+	private:
+		const FBuildingLayer& m_layer;
+		int32 m_index;
+	};
+	FIterator begin() const { return FIterator(*this, 0); }
+	FIterator end() const { return FIterator(*this, Num()); }
+
+private:
+	//ⲿ洢ľγ޸ǰm_source_coords
+	void detachSourceCoords();
+
+	TArray<FVector2D> m_coords;
+	TArray<double> m_source_coords;
+	TSharedPtr<IBuildingSourceStorage> m_source_storage;
+	TArrayView<const double> m_source_view;
+	TArray<int32> m_ring_offsets;
+	TArray<double> m_heights;
+	TArray<int32> m_codes;
+	TArray<FBox2D> m_bounds;
+};
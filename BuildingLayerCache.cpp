@@ -0,0 +1,218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingLayerCache.h"
+#include "BuildingLayer.h"
+#include "BuildingGeometry.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "Templates/UniquePtr.h"
+
+const uint32 cache_magic = 0x434C4242; //"BBLC"
+const uint32 cache_version = 3;
+//ԴļϣʱĿСȡļ
+const int32 hash_sample_count = 16;
+const int32 hash_sample_size = 64 * 1024;
+
+struct FBuildingCacheHeader
+{
+	uint32 magic;
+	uint32 version;
+	int64 source_size;
+	int64 source_time;
+	uint32 source_hash;
+	uint32 reserved;
+	uint64 building_count;
+	uint64 coord_count;
+};
+
+//ļڴӳ䣬ͼͶӰǰֱеľγȿ
+class FBuildingMappedCache : public IBuildingSourceStorage
+{
+public:
+	TUniquePtr<IMappedFileHandle> file;
+	TUniquePtr<IMappedFileRegion> region;
+
+	virtual ~FBuildingMappedCache()
+	{
+		region.Reset();
+		file.Reset();
+	}
+};
+
+//ݿ鰴8ֽڶ
+static uint64 AlignCacheOffset(uint64 offset)
+{
+	return (offset + 7) & ~(uint64)7;
+}
+
+struct FBuildingCacheLayout
+{
+	uint64 offsets;
+	uint64 heights;
+	uint64 codes;
+	uint64 coords;
+	uint64 total;
+
+	FBuildingCacheLayout(uint64 building_count, uint64 coord_count)
+	{
+		offsets = AlignCacheOffset(sizeof(FBuildingCacheHeader));
+		heights = AlignCacheOffset(offsets + (building_count + 1) * sizeof(uint64));
+		codes = AlignCacheOffset(heights + building_count * sizeof(double));
+		coords = AlignCacheOffset(codes + building_count * sizeof(int32));
+		total = coords + coord_count * 2 * sizeof(double);
+	}
+};
+
+bool FBuildingLayerCache::MakeKey(const FString& source_file, FBuildingCacheKey& key)
+{
+	IFileManager& file_manager = IFileManager::Get();
+	key.source_size = file_manager.FileSize(*source_file);
+	if (key.source_size < 0)
+	{
+		return false;
+	}
+	key.source_time = file_manager.GetTimeStamp(*source_file).GetTicks();
+
+	//ļͷβмȷֲɿCRC
+	TUniquePtr<IFileHandle> handle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*source_file));
+	if (!handle.IsValid())
+	{
+		return false;
+	}
+	TArray<uint8> block;
+	block.SetNumUninitialized(hash_sample_size);
+	uint32 hash = FCrc::MemCrc32(&key.source_size, sizeof(key.source_size));
+	for (int32 i = 0; i < hash_sample_count; i++)
+	{
+		int64 offset = key.source_size <= hash_sample_size ? 0 : (key.source_size - hash_sample_size) * i / (hash_sample_count - 1);
+		int64 size = FMath::Min<int64>(hash_sample_size, key.source_size - offset);
+		if (!handle->Seek(offset) || !handle->Read(block.GetData(), size))
+		{
+			return false;
+		}
+		hash = FCrc::MemCrc32(block.GetData(), size, hash);
+		if (key.source_size <= hash_sample_size)
+		{
+			break;
+		}
+	}
+	key.source_hash = hash;
+	return true;
+}
+
+FString FBuildingLayerCache::GetCacheFileName(const FString& source_file)
+{
+	FString full_path = FPaths::ConvertRelativePathToFull(source_file);
+	return FPaths::ProjectSavedDir() + "BuildingCache/" + FPaths::GetBaseFilename(source_file)
+		+ FString::Printf(TEXT("_%08x.bin"), GetTypeHash(full_path));
+}
+
+bool FBuildingLayerCache::Load(const FString& cache_file, const FBuildingCacheKey& key, FBuildingLayer& building_data)
+{
+	IPlatformFile& platform_file = FPlatformFileManager::Get().GetPlatformFile();
+	if (!platform_file.FileExists(*cache_file))
+	{
+		return false;
+	}
+	TSharedPtr<FBuildingMappedCache> mapped_cache = MakeShared<FBuildingMappedCache>();
+	mapped_cache->file.Reset(platform_file.OpenMapped(*cache_file));
+	if (!mapped_cache->file.IsValid() || mapped_cache->file->GetFileSize() < (int64)sizeof(FBuildingCacheHeader))
+	{
+		return false;
+	}
+	mapped_cache->region.Reset(mapped_cache->file->MapRegion(0, mapped_cache->file->GetFileSize()));
+	if (!mapped_cache->region.IsValid())
+	{
+		return false;
+	}
+
+	const uint8* data = mapped_cache->region->GetMappedPtr();
+	const uint64 data_size = mapped_cache->region->GetMappedSize();
+	FBuildingCacheHeader header;
+	FMemory::Memcpy(&header, data, sizeof(header));
+	if (header.magic != cache_magic || header.version != cache_version
+		|| header.source_size != key.source_size || header.source_time != key.source_time || header.source_hash != key.source_hash)
+	{
+		return false;
+	}
+	if (header.building_count > MAX_int32 || header.coord_count > MAX_int32 / 2 || header.coord_count > data_size)
+	{
+		return false;
+	}
+	FBuildingCacheLayout layout(header.building_count, header.coord_count);
+	//Դļɳϣʶ𣬻ֻУ鲼ִСƫƵٶݿCRC
+	if (layout.total != data_size)
+	{
+		UE_LOG(LogBuildingCore, Warning, TEXT("cache %s is corrupt"), *cache_file);
+		return false;
+	}
+
+	const uint64* offsets = (const uint64*)(data + layout.offsets);
+	const double* heights = (const double*)(data + layout.heights);
+	const int32* codes = (const int32*)(data + layout.codes);
+	const double* coords = (const double*)(data + layout.coords);
+
+	//γȿͼֱãӳ䱣ֵͶӰͷԴꣻ롢߶ƫƽСͼ
+	int32 building_count = (int32)header.building_count;
+	return building_data.SetData(TArrayView<const int32>(codes, building_count), TArrayView<const double>(heights, building_count),
+		TArrayView<const uint64>(offsets, building_count + 1), TArrayView<const double>(coords, (int32)header.coord_count * 2), mapped_cache);
+}
+
+bool FBuildingLayerCache::Save(const FString& cache_file, const FBuildingCacheKey& key, const FBuildingLayer& building_data)
+{
+	//汣õ˫ȾγȣͶӰͼ㲻д
+	if (!building_data.HasSourceCoords() && building_data.NumCoords() > 0)
+	{
+		return false;
+	}
+	uint64 building_count = building_data.Num();
+	uint64 coord_count = building_data.NumCoords();
+
+	FBuildingCacheLayout layout(building_count, coord_count);
+	TArray64<uint8> data;
+	data.SetNumZeroed(layout.total);
+	uint64* offsets = (uint64*)(data.GetData() + layout.offsets);
+	double* heights = (double*)(data.GetData() + layout.heights);
+	int32* codes = (int32*)(data.GetData() + layout.codes);
+	double* coords = (double*)(data.GetData() + layout.coords);
+
+	uint64 offset = 0;
+	for (uint64 i = 0; i < building_count; i++)
+	{
+		offsets[i] = offset;
+		heights[i] = building_data.GetHeight((int32)i);
+		codes[i] = building_data.GetCode((int32)i);
+		offset += building_data.GetRingSize((int32)i);
+	}
+	offsets[building_count] = offset;
+	FMemory::Memcpy(coords, building_data.GetSourceCoords().GetData(), coord_count * 2 * sizeof(double));
+
+	FBuildingCacheHeader header;
+	header.magic = cache_magic;
+	header.version = cache_version;
+	header.source_size = key.source_size;
+	header.source_time = key.source_time;
+	header.source_hash = key.source_hash;
+	header.building_count = building_count;
+	header.coord_count = coord_count;
+	header.reserved = 0;
+	FMemory::Memcpy(data.GetData(), &header, sizeof(header));
+
+	//дʱļ滻жϺ²Ļ
+	FString temp_file = cache_file + TEXT(".tmp");
+	{
+		TUniquePtr<FArchive> writer(IFileManager::Get().CreateFileWriter(*temp_file));
+		if (!writer.IsValid())
+		{
+			return false;
+		}
+		writer->Serialize(data.GetData(), data.Num());
+		if (!writer->Close())
+		{
+			return false;
+		}
+	}
+	return IFileManager::Get().Move(*cache_file, *temp_file, true, true);
+}
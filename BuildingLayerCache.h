@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBuildingLayer;
+
+//Դļʶһֶα仯Ϊ
+struct FBuildingCacheKey
+{
+	int64 source_size;
+	int64 source_time;
+	uint32 source_hash;
+};
+
+//ͼĶƻ棬֣ļͷ | ÿƫ | ߶ |  | ˫Ⱦγȿ
+class FBuildingLayerCache
+{
+public:
+	static bool MakeKey(const FString& source_file, FBuildingCacheKey& key);
+	static FString GetCacheFileName(const FString& source_file);
+
+	//治ڡڻʱfalse
+	static bool Load(const FString& cache_file, const FBuildingCacheKey& key, FBuildingLayer& building_data);
+	static bool Save(const FString& cache_file, const FBuildingCacheKey& key, const FBuildingLayer& building_data);
+};
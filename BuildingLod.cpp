@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingLod.h"
+#include "BuildingLayer.h"
+#include "BuildingMeshChunks.h"
+#include "BuildingScratch.h"
+#include "Async/ParallelFor.h"
+
+//㵽߶εľƽֻXY
+static double SegmentDistanceSquared(const FVector2D& point, const FVector2D& start, const FVector2D& end)
+{
+	double dx = end.X - start.X;
+	double dy = end.Y - start.Y;
+	double px = point.X - start.X;
+	double py = point.Y - start.Y;
+	double length_squared = dx * dx + dy * dy;
+	double t = length_squared > 0.0 ? FMath::Clamp((px * dx + py * dy) / length_squared, 0.0, 1.0) : 0.0;
+	px -= t * dx;
+	py -= t * dy;
+	return px * px + py * py;
+}
+
+//ring[first, last]֮Ҫĵ㣬ջݹ
+static void SimplifySpan(TArrayView<const FVector2D> ring, int32 first, int32 last, double tolerance_squared, TArrayView<bool> keep)
+{
+	int32 count = ring.Num();
+	TArray<TPair<int32, int32>, TInlineAllocator<32>> spans;
+	spans.Emplace(first, last);
+	while (spans.Num() > 0)
+	{
+		TPair<int32, int32> span = spans.Pop(false);
+		const FVector2D& start = ring[span.Key % count];
+		const FVector2D& end = ring[span.Value % count];
+		double max_distance = tolerance_squared;
+		int32 max_index = INDEX_NONE;
+		for (int32 i = span.Key + 1; i < span.Value; i++)
+		{
+			double distance = SegmentDistanceSquared(ring[i % count], start, end);
+			if (distance > max_distance)
+			{
+				max_distance = distance;
+				max_index = i;
+			}
+		}
+		if (max_index != INDEX_NONE)
+		{
+			keep[max_index % count] = true;
+			spans.Emplace(span.Key, max_index);
+			spans.Emplace(max_index, span.Value);
+		}
+	}
+}
+
+void SimplifyRing(TArrayView<const FVector2D> ring, double tolerance, TArray<FVector2D>& simplified)
+{
+	int32 count = ring.Num();
+	simplified.Reset(count);
+	if (count <= 3 || tolerance <= 0.0)
+	{
+		simplified.Append(ring.GetData(), count);
+		return;
+	}
+
+	//պϻ׵׵ԶĵΪ˵㣬λ
+	int32 far_index = 0;
+	double far_distance = -1.0;
+	for (int32 i = 1; i < count; i++)
+	{
+		double distance = FVector2D::DistSquared(ring[0], ring[i]);
+		if (distance > far_distance)
+		{
+			far_distance = distance;
+			far_index = i;
+		}
+	}
+
+	FBuildingScratchMark scratch_mark;
+	TBuildingScratchArray<bool> keep;
+	keep.SetNumZeroed(count);
+	keep[0] = true;
+	keep[far_index] = true;
+	double tolerance_squared = tolerance * tolerance;
+	SimplifySpan(ring, 0, far_index, tolerance_squared, keep);
+	SimplifySpan(ring, far_index, count, tolerance_squared, keep);
+
+	//ݲֻʣ˵ʱ˵Զĵ㣬ٱһ
+	int32 keep_count = 0;
+	for (int32 i = 0; i < count; i++)
+	{
+		keep_count += keep[i] ? 1 : 0;
+	}
+	if (keep_count < 3)
+	{
+		int32 max_index = INDEX_NONE;
+		double max_distance = 0.0;
+		for (int32 i = 0; i < count; i++)
+		{
+			double distance = SegmentDistanceSquared(ring[i], ring[0], ring[far_index]);
+			if (distance > max_distance)
+			{
+				max_distance = distance;
+				max_index = i;
+			}
+		}
+		if (max_index == INDEX_NONE)
+		{
+			simplified.Append(ring.GetData(), count);
+			return;
+		}
+		keep[max_index] = true;
+	}
+
+	for (int32 i = 0; i < count; i++)
+	{
+		if (keep[i])
+		{
+			simplified.Add(ring[i]);
+		}
+	}
+}
+
+void MakeBoxProxy(TArrayView<const FVector2D> ring, TArray<FVector2D>& proxy)
+{
+	FBox2D box(ForceInit);
+	double area = 0.0;
+	for (int32 i = 0, j = ring.Num() - 1; i < ring.Num(); j = i++)
+	{
+		box += ring[i];
+		area += ((double)ring[j].X - ring[i].X) * ((double)ring[j].Y + ring[i].Y);
+	}
+
+	proxy.Reset(4);
+	proxy.Add(FVector2D(box.Min.X, box.Min.Y));
+	proxy.Add(FVector2D(box.Max.X, box.Min.Y));
+	proxy.Add(FVector2D(box.Max.X, box.Max.Y));
+	proxy.Add(FVector2D(box.Min.X, box.Max.Y));
+	//Ϊʱ룬ԭΪ˳ʱʱת֤ǽ泯һ
+	if (area < 0.0)
+	{
+		Swap(proxy[1], proxy[3]);
+	}
+}
+
+void MakeLodBuildings(const TMap<int32, FBuildingLayer>& layer_data, const TMap<int32, float>& layer_tolerances,
+	const FBuildingLodSettings& settings, TArray<TMap<int32, FBuildingLayer>>& lod_layer_data)
+{
+	int32 lod_count = settings.tolerance_scales.Num();
+	lod_layer_data.Empty(lod_count);
+	lod_layer_data.SetNum(lod_count);
+	for (int32 lod = 0; lod < lod_count; lod++)
+	{
+		bool last_lod = lod + 1 == lod_count;
+		for (auto it_layer_data = layer_data.begin(); it_layer_data != layer_data.end(); ++it_layer_data)
+		{
+			const float* layer_tolerance = layer_tolerances.Find(it_layer_data->Key);
+			double tolerance = (layer_tolerance != nullptr ? *layer_tolerance : 0.0) * settings.tolerance_scales[lod];
+
+			//ÿ齨򵽸Եͼ㣬ٰ˳ƴӣԭͼһ
+			const FBuildingLayer& buildings = it_layer_data->Value;
+			int32 chunk_count = FMath::DivideAndRoundUp(buildings.Num(), building_chunk_size);
+			TArray<FBuildingLayer> chunk_layers;
+			chunk_layers.SetNum(chunk_count);
+			ParallelFor(chunk_count, [&](int32 chunk_index)
+			{
+				int32 begin = chunk_index * building_chunk_size;
+				int32 end = FMath::Min(begin + building_chunk_size, buildings.Num());
+				TArray<FVector2D> lod_ring;
+				for (int32 i = begin; i < end; i++)
+				{
+					FBuildingView building = buildings[i];
+					FVector2D size = building.bounds.GetSize();
+					if (last_lod && building.coords.Num() > 4 && FMath::Max(size.X, size.Y) < settings.proxy_size)
+					{
+						MakeBoxProxy(building.coords, lod_ring);
+					}
+					else
+					{
+						SimplifyRing(building.coords, tolerance, lod_ring);
+					}
+					chunk_layers[chunk_index].AddBuilding(building.code, building.height, lod_ring);
+				}
+			});
+
+			FBuildingLayer& lod_buildings = lod_layer_data[lod].Add(it_layer_data->Key);
+			lod_buildings.Empty(buildings.Num(), buildings.NumCoords());
+			for (const FBuildingLayer& chunk_layer : chunk_layers)
+			{
+				lod_buildings.Append(chunk_layer);
+			}
+		}
+	}
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBuildingLayer;
+
+//LODɲ0Ϊԭʼݣڴ
+struct FBuildingLodSettings
+{
+	//1ʼÿĻݲͼݲı
+	TArray<float> tolerance_scales;
+	//һаΧб߳СڸֵĽ滻Ϊ
+	float proxy_size;
+};
+
+//Douglas-Peuckerպϻٱ3㣻е㹲ʱԭ
+void SimplifyRing(TArrayView<const FVector2D> ring, double tolerance, TArray<FVector2D>& simplified);
+//ΧУ˳ԭһ
+void MakeBoxProxy(TArrayView<const FVector2D> ring, TArray<FVector2D>& proxy);
+//ɵ1ʼĸLODݣԭݰͼ㡢һһӦ
+void MakeLodBuildings(const TMap<int32, FBuildingLayer>& layer_data, const TMap<int32, float>& layer_tolerances,
+	const FBuildingLodSettings& settings, TArray<TMap<int32, FBuildingLayer>>& lod_layer_data);
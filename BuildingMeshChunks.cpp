@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingMeshChunks.h"
+#include "BuildingLayer.h"
+
+void MakeBuildingChunks(int32 layer_id, const FBuildingLayer& buildings, TArray<FBuildingChunk>& chunks)
+{
+	for (int32 begin = 0; begin < buildings.Num(); begin += building_chunk_size)
+	{
+		FBuildingChunk chunk;
+		chunk.buildings = &buildings;
+		chunk.layer_id = layer_id;
+		chunk.begin = begin;
+		chunk.end = FMath::Min(begin + building_chunk_size, buildings.Num());
+		chunks.Add(chunk);
+	}
+}
+
+void MakeBuildingChunks(const TMap<int32, FBuildingLayer>& layer_data, TArray<FBuildingChunk>& chunks)
+{
+	for (auto it_layer_data = layer_data.begin(); it_layer_data != layer_data.end(); ++it_layer_data)
+	{
+		MakeBuildingChunks(it_layer_data->Key, it_layer_data->Value, chunks);
+	}
+}
+
+void GetChunkBuildings(const FBuildingChunk& chunk, TArray<FBuildingView>& buildings)
+{
+	buildings.Reset(chunk.end - chunk.begin);
+	for (int32 i = chunk.begin; i < chunk.end; i++)
+	{
+		buildings.Add((*chunk.buildings)[i]);
+	}
+}
+
+FMeshSize PrefixMeshSizes(TArray<FMeshSize>& sizes)
+{
+	FMeshSize total;
+	for (FMeshSize& size : sizes)
+	{
+		FMeshSize count = size;
+		size = total;
+		total.vertices += count.vertices;
+		total.indices += count.indices;
+		total.faces += count.faces;
+	}
+	return total;
+}
+
+void AllocatePMCMesh(const FMeshSize& size, bool with_normals_colors, FPMCMeshChunk& mesh)
+{
+	mesh.Vertices.SetNumUninitialized(size.vertices);
+	mesh.UV.SetNumUninitialized(size.vertices);
+	mesh.Index.SetNumUninitialized(size.indices);
+	if (with_normals_colors)
+	{
+		mesh.Normals.SetNumUninitialized(size.vertices);
+		mesh.VertexColors.SetNumUninitialized(size.vertices);
+	}
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBuildingLayer;
+struct FBuildingView;
+
+//̶Ľ飬ֽ߳޹أ뵥߳ȫһ
+const int32 building_chunk_size = 256;
+
+struct FBuildingChunk
+{
+	const FBuildingLayer* buildings;
+	int32 layer_id;
+	int32 begin;
+	int32 end;
+};
+
+//PMCĶ
+struct FPMCMeshChunk
+{
+	TArray<FVector> Vertices;
+	TArray<int32> Index;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UV;
+	TArray<FColor> VertexColors;
+};
+
+//FRawMeshаШθʽд飬Ŀͨͼд룬RawMeshģ
+struct FRawMeshView
+{
+	TArrayView<FVector> VertexPositions;
+	TArrayView<uint32> WedgeIndices;
+	TArrayView<FVector2D> WedgeTexCoords;
+	TArrayView<FVector> WedgeTangentX;
+	TArrayView<FVector> WedgeTangentY;
+	TArrayView<FVector> WedgeTangentZ;
+	TArrayView<FColor> WedgeColors;
+	TArrayView<int32> FaceMaterialIndices;
+	TArrayView<uint32> FaceSmoothingMasks;
+};
+
+//Ԫ׶ۼӣǰ׺ͺΪд׶εдλ
+struct FMeshSize
+{
+	int32 vertices = 0;
+	int32 indices = 0;
+	int32 faces = 0;
+};
+
+//ݶǻ׶ɣд׶θã͹ΰд룬
+struct FRoofChunkTriangles
+{
+	TArray<int32> triangles;
+	//ÿtrianglesеʼλãend - begin + 1
+	TArray<int32> offsets;
+	TArray<bool> convex;
+	//ǻĽϣţдؽ
+	TArray<TPair<uint64, int32>> triangulated;
+	//triangulatedһһӦĶкʱڣԼ͹еܺʱ
+	TArray<uint64> triangulate_cycles;
+	uint64 convex_test_cycles = 0;
+	uint64 ear_clipping_cycles = 0;
+};
+
+void MakeBuildingChunks(int32 layer_id, const FBuildingLayer& buildings, TArray<FBuildingChunk>& chunks);
+//ͼ˳ռ
+void MakeBuildingChunks(const TMap<int32, FBuildingLayer>& layer_data, TArray<FBuildingChunk>& chunks);
+
+//ڽͼб
+void GetChunkBuildings(const FBuildingChunk& chunk, TArray<FBuildingView>& buildings);
+
+//ÿ͵תΪÿʼλã
+FMeshSize PrefixMeshSizes(TArray<FMeshSize>& sizes);
+
+//һԷ飬д׶β
+void AllocatePMCMesh(const FMeshSize& size, bool with_normals_colors, FPMCMeshChunk& mesh);
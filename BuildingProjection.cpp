@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingProjection.h"
+
+#if defined(__AVX2__)
+#define MERCATOR_USE_AVX2 1
+#define MERCATOR_USE_SSE2 0
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define MERCATOR_USE_AVX2 0
+#define MERCATOR_USE_SSE2 1
+#include <emmintrin.h>
+#else
+#define MERCATOR_USE_AVX2 0
+#define MERCATOR_USE_SSE2 0
+#endif
+
+void LonLatToMercator(double lon, double lat, double& north, double& east)
+{
+	double alpha = lat * PI / 180.0;
+	double sin_alpha = FMath::Sin(alpha);
+	east = lon * PI / 180.0 * earth_radius;
+	north = earth_radius / 2.0 * FMath::Loge((1.0 + sin_alpha) / (1.0 - sin_alpha));
+}
+
+void ProjectMercatorScalar(const double* lon, const double* lat, int32 count, double ref_north, double ref_east, double* north, double* east)
+{
+	for (int32 i = 0; i < count; i++)
+	{
+		LonLatToMercator(lon[i], lat[i], north[i], east[i]);
+		north[i] -= ref_north;
+		east[i] -= ref_east;
+	}
+}
+
+#if MERCATOR_USE_AVX2 || MERCATOR_USE_SSE2
+
+#if MERCATOR_USE_AVX2
+struct FMercatorOps
+{
+	typedef __m256d FReal;
+	typedef __m256i FBits;
+	static const int32 width = 4;
+
+	static FReal Load(const double* p) { return _mm256_loadu_pd(p); }
+	static void Store(double* p, FReal a) { _mm256_storeu_pd(p, a); }
+	static FReal Set(double a) { return _mm256_set1_pd(a); }
+	static FReal Add(FReal a, FReal b) { return _mm256_add_pd(a, b); }
+	static FReal Sub(FReal a, FReal b) { return _mm256_sub_pd(a, b); }
+	static FReal Mul(FReal a, FReal b) { return _mm256_mul_pd(a, b); }
+	static FReal Div(FReal a, FReal b) { return _mm256_div_pd(a, b); }
+	static FReal And(FReal a, FReal b) { return _mm256_and_pd(a, b); }
+	static FReal Greater(FReal a, FReal b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+	static FReal Select(FReal mask, FReal a, FReal b) { return _mm256_blendv_pd(b, a, mask); }
+	static FBits ToBits(FReal a) { return _mm256_castpd_si256(a); }
+	static FReal FromBits(FBits a) { return _mm256_castsi256_pd(a); }
+	static FBits SetBits(int64 a) { return _mm256_set1_epi64x(a); }
+	static FBits AndBits(FBits a, FBits b) { return _mm256_and_si256(a, b); }
+	static FBits OrBits(FBits a, FBits b) { return _mm256_or_si256(a, b); }
+	static FBits ShiftRight(FBits a, int32 count) { return _mm256_srli_epi64(a, count); }
+};
+#else
+struct FMercatorOps
+{
+	typedef __m128d FReal;
+	typedef __m128i FBits;
+	static const int32 width = 2;
+
+	static FReal Load(const double* p) { return _mm_loadu_pd(p); }
+	static void Store(double* p, FReal a) { _mm_storeu_pd(p, a); }
+	static FReal Set(double a) { return _mm_set1_pd(a); }
+	static FReal Add(FReal a, FReal b) { return _mm_add_pd(a, b); }
+	static FReal Sub(FReal a, FReal b) { return _mm_sub_pd(a, b); }
+	static FReal Mul(FReal a, FReal b) { return _mm_mul_pd(a, b); }
+	static FReal Div(FReal a, FReal b) { return _mm_div_pd(a, b); }
+	static FReal And(FReal a, FReal b) { return _mm_and_pd(a, b); }
+	static FReal Greater(FReal a, FReal b) { return _mm_cmpgt_pd(a, b); }
+	static FReal Select(FReal mask, FReal a, FReal b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+	static FBits ToBits(FReal a) { return _mm_castpd_si128(a); }
+	static FReal FromBits(FBits a) { return _mm_castsi128_pd(a); }
+	static FBits SetBits(int64 a) { return _mm_set1_epi64x(a); }
+	static FBits AndBits(FBits a, FBits b) { return _mm_and_si128(a, b); }
+	static FBits OrBits(FBits a, FBits b) { return _mm_or_si128(a, b); }
+	static FBits ShiftRight(FBits a, int32 count) { return _mm_srli_epi64(a, count); }
+};
+#endif
+
+typedef FMercatorOps::FReal FReal;
+typedef FMercatorOps::FBits FBits;
+
+//|a| <= PI / 2ʱ̩չضϵ23Σ˫
+static FReal SinHalfPi(FReal a)
+{
+	static const double coefficients[] = {
+		-1.0 / 6.0, 1.0 / 120.0, -1.0 / 5040.0, 1.0 / 362880.0, -1.0 / 39916800.0, 1.0 / 6227020800.0,
+		-1.0 / 1307674368000.0, 1.0 / 355687428096000.0, -1.0 / 121645100408832000.0,
+		1.0 / 51090942171709440000.0, -1.0 / 25852016738884976640000.0 };
+	const int32 count = sizeof(coefficients) / sizeof(coefficients[0]);
+	FReal a2 = FMercatorOps::Mul(a, a);
+	FReal sum = FMercatorOps::Set(coefficients[count - 1]);
+	for (int32 i = count - 2; i >= 0; i--)
+	{
+		sum = FMercatorOps::Add(FMercatorOps::Mul(sum, a2), FMercatorOps::Set(coefficients[i]));
+	}
+	sum = FMercatorOps::Add(FMercatorOps::Mul(sum, a2), FMercatorOps::Set(1.0));
+	return FMercatorOps::Mul(a, sum);
+}
+
+//Ȼx = m * 2^em[sqrt(0.5), sqrt(2))ڣln(m) = 2 * atanh((m - 1) / (m + 1))
+static FReal LogPositive(FReal x)
+{
+	FBits bits = FMercatorOps::ToBits(x);
+	//ָλƴ2^52βټȥ2^52õƫõָ
+	const double two_52 = 4503599627370496.0;
+	FReal exponent = FMercatorOps::FromBits(FMercatorOps::OrBits(FMercatorOps::ShiftRight(bits, 52), FMercatorOps::SetBits(0x4330000000000000LL)));
+	exponent = FMercatorOps::Sub(exponent, FMercatorOps::Set(two_52 + 1023.0));
+	FReal mantissa = FMercatorOps::FromBits(FMercatorOps::OrBits(FMercatorOps::AndBits(bits, FMercatorOps::SetBits(0x000FFFFFFFFFFFFFLL)), FMercatorOps::SetBits(0x3FF0000000000000LL)));
+
+	const double sqrt_2 = 1.4142135623730950488;
+	const double ln_2 = 0.69314718055994530942;
+	FReal large = FMercatorOps::Greater(mantissa, FMercatorOps::Set(sqrt_2));
+	mantissa = FMercatorOps::Select(large, FMercatorOps::Mul(mantissa, FMercatorOps::Set(0.5)), mantissa);
+	exponent = FMercatorOps::Add(exponent, FMercatorOps::And(large, FMercatorOps::Set(1.0)));
+
+	//|z| <= 0.1716չz^21
+	FReal z = FMercatorOps::Div(FMercatorOps::Sub(mantissa, FMercatorOps::Set(1.0)), FMercatorOps::Add(mantissa, FMercatorOps::Set(1.0)));
+	FReal z2 = FMercatorOps::Mul(z, z);
+	FReal sum = FMercatorOps::Set(1.0 / 21.0);
+	for (int32 k = 9; k >= 0; k--)
+	{
+		sum = FMercatorOps::Add(FMercatorOps::Mul(sum, z2), FMercatorOps::Set(1.0 / (2 * k + 1)));
+	}
+	FReal log_mantissa = FMercatorOps::Mul(FMercatorOps::Mul(z, sum), FMercatorOps::Set(2.0));
+	return FMercatorOps::Add(FMercatorOps::Mul(exponent, FMercatorOps::Set(ln_2)), log_mantissa);
+}
+
+static void ProjectMercatorVector(const double* lon, const double* lat, double ref_north, double ref_east, double* north, double* east)
+{
+	const double deg_to_rad = PI / 180.0;
+	FReal east_value = FMercatorOps::Mul(FMercatorOps::Load(lon), FMercatorOps::Set(deg_to_rad * earth_radius));
+	FMercatorOps::Store(east, FMercatorOps::Sub(east_value, FMercatorOps::Set(ref_east)));
+
+	FReal sin_alpha = SinHalfPi(FMercatorOps::Mul(FMercatorOps::Load(lat), FMercatorOps::Set(deg_to_rad)));
+	FReal one = FMercatorOps::Set(1.0);
+	FReal ratio = FMercatorOps::Div(FMercatorOps::Add(one, sin_alpha), FMercatorOps::Sub(one, sin_alpha));
+	FReal north_value = FMercatorOps::Mul(LogPositive(ratio), FMercatorOps::Set(earth_radius / 2.0));
+	FMercatorOps::Store(north, FMercatorOps::Sub(north_value, FMercatorOps::Set(ref_north)));
+}
+
+void ProjectMercator(const double* lon, const double* lat, int32 count, double ref_north, double ref_east, double* north, double* east)
+{
+	const int32 width = FMercatorOps::width;
+	int32 i = 0;
+	for (; i + width <= count; i += width)
+	{
+		ProjectMercatorVector(lon + i, lat + i, ref_north, ref_east, north + i, east + i);
+	}
+	//ʣ಻һĵ㲹0ͬ㣬һ
+	if (i < count)
+	{
+		double tail_lon[width] = {};
+		double tail_lat[width] = {};
+		double tail_north[width];
+		double tail_east[width];
+		FMemory::Memcpy(tail_lon, lon + i, (count - i) * sizeof(double));
+		FMemory::Memcpy(tail_lat, lat + i, (count - i) * sizeof(double));
+		ProjectMercatorVector(tail_lon, tail_lat, ref_north, ref_east, tail_north, tail_east);
+		FMemory::Memcpy(north + i, tail_north, (count - i) * sizeof(double));
+		FMemory::Memcpy(east + i, tail_east, (count - i) * sizeof(double));
+	}
+}
+
+const TCHAR* GetMercatorKernelName()
+{
+	return MERCATOR_USE_AVX2 ? TEXT("avx2") : TEXT("sse2");
+}
+
+#else
+
+void ProjectMercator(const double* lon, const double* lat, int32 count, double ref_north, double ref_east, double* north, double* east)
+{
+	ProjectMercatorScalar(lon, lat, count, ref_north, ref_east, north, east);
+}
+
+const TCHAR* GetMercatorKernelName()
+{
+	return TEXT("scalar");
+}
+
+#endif
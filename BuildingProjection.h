@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+const double earth_radius = 6378137.0;
+
+//WebīͶӰ˫Ȳοʵ֣northΪγȷeastΪȷLonlat2MercatorXYһ
+void LonLatToMercator(double lon, double lat, double& north, double& east);
+
+//ͶӰlonlatΪľγȣȣȥοдnortheastγ(-90, 90)
+//Ŀ֧ʱAVX2SSE2ÿδ42㣬òοʵ
+void ProjectMercator(const double* lon, const double* lat, int32 count, double ref_north, double ref_east, double* north, double* east);
+//ʹòοʵ֣Ϊ뾫ȶ
+void ProjectMercatorScalar(const double* lon, const double* lat, int32 count, double ref_north, double ref_east, double* north, double* east);
+
+//ProjectMercatorʹõָ
+const TCHAR* GetMercatorKernelName();
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingRebuildCache.h"
+#include "BuildingLayer.h"
+#include "BuildingGeometry.h"
+#include "HAL/FileManager.h"
+#include "Hash/CityHash.h"
+#include "Misc/Paths.h"
+#include "Templates/UniquePtr.h"
+
+const uint32 rebuild_cache_magic = 0x43524242; //"BBRC"
+const uint32 rebuild_cache_version = 1;
+
+uint64 HashBuildingRing(TArrayView<const FVector2D> ring)
+{
+	//ţһμ
+	int32 count = ring.Num();
+	uint64 hash = CityHash64((const char*)&count, sizeof(count));
+	return CityHash64WithSeed((const char*)ring.GetData(), count * sizeof(FVector2D), hash);
+}
+
+uint64 HashBuilding(const FBuildingView& building)
+{
+	uint64 hash = HashBuildingRing(building.coords);
+	hash = CityHash64WithSeed((const char*)&building.height, sizeof(building.height), hash);
+	return CityHash64WithSeed((const char*)&building.code, sizeof(building.code), hash);
+}
+
+FString FBuildingRebuildCache::GetCacheFileName(const FString& package_root)
+{
+	return FPaths::ProjectSavedDir() + FString::Printf(TEXT("BuildingCache/rebuild_%08x.bin"), GetTypeHash(package_root));
+}
+
+bool FBuildingRebuildCache::Load(const FString& cache_file)
+{
+	m_triangles.Empty();
+	m_mesh_hashes.Empty();
+	TUniquePtr<FArchive> reader(IFileManager::Get().CreateFileReader(*cache_file));
+	if (!reader.IsValid())
+	{
+		return false;
+	}
+	uint32 magic = 0;
+	uint32 version = 0;
+	*reader << magic << version;
+	if (magic != rebuild_cache_magic || version != rebuild_cache_version)
+	{
+		return false;
+	}
+	*reader << m_triangles << m_mesh_hashes;
+	if (reader->IsError())
+	{
+		UE_LOG(LogBuildingCore, Warning, TEXT("cache %s is corrupt"), *cache_file);
+		m_triangles.Empty();
+		m_mesh_hashes.Empty();
+		return false;
+	}
+	return true;
+}
+
+bool FBuildingRebuildCache::Save(const FString& cache_file)
+{
+	//дʱļ滻жϺ²Ļ
+	FString temp_file = cache_file + TEXT(".tmp");
+	{
+		TUniquePtr<FArchive> writer(IFileManager::Get().CreateFileWriter(*temp_file));
+		if (!writer.IsValid())
+		{
+			return false;
+		}
+		uint32 magic = rebuild_cache_magic;
+		uint32 version = rebuild_cache_version;
+		*writer << magic << version;
+		*writer << m_triangles << m_mesh_hashes;
+		if (!writer->Close())
+		{
+			return false;
+		}
+	}
+	return IFileManager::Get().Move(*cache_file, *temp_file, true, true);
+}
+
+const TArray<int32>* FBuildingRebuildCache::FindTriangles(uint64 ring_hash) const
+{
+	return m_triangles.Find(ring_hash);
+}
+
+void FBuildingRebuildCache::AddTriangles(uint64 ring_hash, TArrayView<const int32> triangles)
+{
+	m_triangles.Add(ring_hash, TArray<int32>(triangles.GetData(), triangles.Num()));
+}
+
+void FBuildingRebuildCache::KeepTriangles(const TSet<uint64>& ring_hashes)
+{
+	for (auto it = m_triangles.CreateIterator(); it; ++it)
+	{
+		if (!ring_hashes.Contains(it->Key))
+		{
+			it.RemoveCurrent();
+		}
+	}
+}
+
+bool FBuildingRebuildCache::IsMeshUpToDate(const FString& mesh_name, uint64 content_hash) const
+{
+	const uint64* hash = m_mesh_hashes.Find(mesh_name);
+	return hash != nullptr && *hash == content_hash;
+}
+
+void FBuildingRebuildCache::SetMeshHash(const FString& mesh_name, uint64 content_hash)
+{
+	m_mesh_hashes.Add(mesh_name, content_hash);
+}
+
+void FBuildingRebuildCache::KeepMeshes(const TSet<FString>& mesh_names, TArray<FString>& removed_names)
+{
+	for (auto it = m_mesh_hashes.CreateIterator(); it; ++it)
+	{
+		if (!mesh_names.Contains(it->Key))
+		{
+			removed_names.Add(it->Key);
+			it.RemoveCurrent();
+		}
+	}
+}
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FBuildingView;
+
+//ϣֻ꣬ݶǻֻй
+uint64 HashBuildingRing(TArrayView<const FVector2D> ring);
+//ݹϣꡢ߶ȡ룬һ仯Ҫڵ
+uint64 HashBuilding(const FBuildingView& building);
+
+//ؽ棬֣ļͷ | ϣ -> ݶ |  -> ݹϣ
+//ֻ汾õĿݱ仯󲻻
+class FBuildingRebuildCache
+{
+public:
+	//ÿĿ¼һ棬¼ֻڸĿ¼Ч
+	static FString GetCacheFileName(const FString& package_root);
+
+	//治ڻʱղfalse
+	bool Load(const FString& cache_file);
+	bool Save(const FString& cache_file);
+
+	//Ϊڶţҿڶ߳нУֻڵ߳н
+	const TArray<int32>* FindTriangles(uint64 ring_hash) const;
+	void AddTriangles(uint64 ring_hash, TArrayView<const int32> triangles);
+	//ring_hashesеǻ
+	void KeepTriangles(const TSet<uint64>& ring_hashes);
+
+	//ݹϣϴαʱһʱɺͱ
+	bool IsMeshUpToDate(const FString& mesh_name, uint64 content_hash) const;
+	void SetMeshHash(const FString& mesh_name, uint64 content_hash);
+	//mesh_namesедremoved_names
+	void KeepMeshes(const TSet<FString>& mesh_names, TArray<FString>& removed_names);
+
+	int32 GetTriangleCount() const { return m_triangles.Num(); }
+
+private:
+	TMap<uint64, TArray<int32>> m_triangles;
+	TMap<FString, uint64> m_mesh_hashes;
+};
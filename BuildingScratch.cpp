@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingScratch.h"
+#include "Misc/ScopeLock.h"
+
+//ÿС飬һĽһ
+const SIZE_T scratch_block_size = 64 * 1024;
+const uint32 scratch_min_alignment = 16;
+
+static FCriticalSection& GetScratchArenasLock()
+{
+	static FCriticalSection lock;
+	return lock;
+}
+
+//̵߳ݴڻͳ
+static TArray<FBuildingScratchArena*>& GetScratchArenas()
+{
+	static TArray<FBuildingScratchArena*> arenas;
+	return arenas;
+}
+
+FBuildingScratchArena::FBuildingScratchArena()
+	: m_block(0)
+	, m_offset(0)
+	, m_base(0)
+{
+	FScopeLock lock(&GetScratchArenasLock());
+	GetScratchArenas().Add(this);
+}
+
+FBuildingScratchArena::~FBuildingScratchArena()
+{
+	{
+		FScopeLock lock(&GetScratchArenasLock());
+		GetScratchArenas().RemoveSingleSwap(this);
+	}
+	for (const FScratchBlock& block : m_blocks)
+	{
+		FMemory::Free(block.data);
+	}
+}
+
+void* FBuildingScratchArena::Alloc(SIZE_T size, uint32 alignment)
+{
+	alignment = FMath::Max(alignment, scratch_min_alignment);
+	m_stats.allocations++;
+	m_stats.bytes += size;
+	if (m_block < m_blocks.Num())
+	{
+		const FScratchBlock& block = m_blocks[m_block];
+		uint8* result = Align(block.data + m_offset, alignment);
+		if (result + size <= block.data + block.size)
+		{
+			m_offset = result + size - block.data;
+			m_stats.peak_bytes = FMath::Max(m_stats.peak_bytes, m_base + m_offset);
+			return result;
+		}
+	}
+	return AllocSlow(size, alignment);
+}
+
+void* FBuildingScratchArena::AllocSlow(SIZE_T size, uint32 alignment)
+{
+	//ǰŲʱһ飻Ŀ鶼δʹã̫Сֱӻ¿
+	if (m_block < m_blocks.Num())
+	{
+		m_base += m_blocks[m_block].size;
+		m_block++;
+	}
+	SIZE_T needed = size + alignment;
+	if (m_block == m_blocks.Num() || m_blocks[m_block].size < needed)
+	{
+		uint64 start_cycles = FPlatformTime::Cycles64();
+		FScratchBlock block;
+		block.size = FMath::Max(needed, scratch_block_size);
+		block.data = (uint8*)FMemory::Malloc(block.size, scratch_min_alignment);
+		if (m_block == m_blocks.Num())
+		{
+			m_blocks.Add(block);
+		}
+		else
+		{
+			FMemory::Free(m_blocks[m_block].data);
+			m_blocks[m_block] = block;
+		}
+		m_stats.heap_blocks++;
+		m_stats.heap_cycles += FPlatformTime::Cycles64() - start_cycles;
+	}
+
+	const FScratchBlock& block = m_blocks[m_block];
+	uint8* result = Align(block.data, alignment);
+	m_offset = result + size - block.data;
+	m_stats.peak_bytes = FMath::Max(m_stats.peak_bytes, m_base + m_offset);
+	return result;
+}
+
+FBuildingScratchStats FBuildingScratchArena::GetStats()
+{
+	FScopeLock lock(&GetScratchArenasLock());
+	FBuildingScratchStats total;
+	for (const FBuildingScratchArena* arena : GetScratchArenas())
+	{
+		const FBuildingScratchStats& stats = arena->m_stats;
+		if (stats.allocations == 0 && stats.scopes == 0)
+		{
+			continue;
+		}
+		total.allocations += stats.allocations;
+		total.bytes += stats.bytes;
+		total.scopes += stats.scopes;
+		total.heap_blocks += stats.heap_blocks;
+		total.heap_cycles += stats.heap_cycles;
+		total.peak_bytes = FMath::Max(total.peak_bytes, stats.peak_bytes);
+		total.threads++;
+	}
+	return total;
+}
+
+void FBuildingScratchArena::ResetStats()
+{
+	FScopeLock lock(&GetScratchArenasLock());
+	for (FBuildingScratchArena* arena : GetScratchArenas())
+	{
+		arena->m_stats = FBuildingScratchStats();
+	}
+}
+
+FBuildingScratchMark::FBuildingScratchMark()
+	: m_arena(FBuildingScratchArena::Get())
+	, m_block(m_arena.m_block)
+	, m_offset(m_arena.m_offset)
+	, m_base(m_arena.m_base)
+{
+	m_arena.m_stats.scopes++;
+}
+
+FBuildingScratchMark::~FBuildingScratchMark()
+{
+	m_arena.m_block = m_block;
+	m_arena.m_offset = m_offset;
+	m_arena.m_base = m_base;
+}
@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSingleton.h"
+
+//ݴͳƣ߳ۼ
+struct FBuildingScratchStats
+{
+	//ݴڵķֽ
+	uint64 allocations = 0;
+	uint64 bytes = 0;
+	//FBuildingScratchMarkͨÿһ
+	uint64 scopes = 0;
+	//ڴĴʱ
+	uint64 heap_blocks = 0;
+	uint64 heap_cycles = 0;
+	//߳ͬʱռõֽ
+	SIZE_T peak_bytes = 0;
+	int32 threads = 0;
+};
+
+//ÿ߳һݴֻƶָ룬FBuildingScratchMarkʱ
+//ڴһֱȶʱжѷ
+class FBuildingScratchArena : public TThreadSingleton<FBuildingScratchArena>
+{
+public:
+	FBuildingScratchArena();
+	virtual ~FBuildingScratchArena();
+
+	void* Alloc(SIZE_T size, uint32 alignment);
+
+	//̵߳ͳƣڹ߳̿ʱ
+	static FBuildingScratchStats GetStats();
+	static void ResetStats();
+
+private:
+	friend class FBuildingScratchMark;
+
+	struct FScratchBlock
+	{
+		uint8* data;
+		SIZE_T size;
+	};
+
+	void* AllocSlow(SIZE_T size, uint32 alignment);
+
+	TArray<FScratchBlock> m_blocks;
+	//ǰ顢ֽڣԼ֮ǰܴС
+	int32 m_block;
+	SIZE_T m_offset;
+	SIZE_T m_base;
+	FBuildingScratchStats m_stats;
+};
+
+//ڴӵǰ߳ݴڴʱȫͷţȳǶʹ
+class FBuildingScratchMark
+{
+public:
+	FBuildingScratchMark();
+	~FBuildingScratchMark();
+
+	FBuildingScratchMark(const FBuildingScratchMark&) = delete;
+	FBuildingScratchMark& operator=(const FBuildingScratchMark&) = delete;
+
+private:
+	FBuildingScratchArena& m_arena;
+	int32 m_block;
+	SIZE_T m_offset;
+	SIZE_T m_base;
+};
+
+//ӵǰ߳ݴ飬ֻFBuildingScratchMarkڴʹã̴ܿ߳
+//ʱڴֱŻ
+template<uint32 Alignment = DEFAULT_ALIGNMENT>
+class TBuildingScratchAllocator
+{
+public:
+	using SizeType = int32;
+
+	enum { NeedsElementType = true };
+	enum { RequireRangeCheck = true };
+
+	class ForAnyElementType
+	{
+	public:
+		ForAnyElementType()
+			: m_data(nullptr)
+		{
+		}
+
+		void MoveToEmpty(ForAnyElementType& Other)
+		{
+			checkSlow(this != &Other);
+			m_data = Other.m_data;
+			Other.m_data = nullptr;
+		}
+
+		FScriptContainerElement* GetAllocation() const
+		{
+			return m_data;
+		}
+
+		void ResizeAllocation(SizeType PreviousNumElements, SizeType NumElements, SIZE_T NumBytesPerElement)
+		{
+			FScriptContainerElement* old_data = m_data;
+			if (NumElements == 0)
+			{
+				m_data = nullptr;
+				return;
+			}
+			m_data = (FScriptContainerElement*)FBuildingScratchArena::Get().Alloc(NumElements * NumBytesPerElement, Alignment);
+			if (old_data != nullptr && PreviousNumElements > 0)
+			{
+				FMemory::Memcpy(m_data, old_data, FMath::Min(NumElements, PreviousNumElements) * NumBytesPerElement);
+			}
+		}
+
+		SizeType CalculateSlackReserve(SizeType NumElements, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackReserve(NumElements, NumBytesPerElement, false, Alignment);
+		}
+		SizeType CalculateSlackShrink(SizeType NumElements, SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackShrink(NumElements, NumAllocatedElements, NumBytesPerElement, false, Alignment);
+		}
+		SizeType CalculateSlackGrow(SizeType NumElements, SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackGrow(NumElements, NumAllocatedElements, NumBytesPerElement, false, Alignment);
+		}
+
+		SIZE_T GetAllocatedSize(SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const
+		{
+			return NumAllocatedElements * NumBytesPerElement;
+		}
+
+		bool HasAllocation() const
+		{
+			return m_data != nullptr;
+		}
+
+		SizeType GetInitialCapacity() const
+		{
+			return 0;
+		}
+
+	private:
+		FScriptContainerElement* m_data;
+	};
+
+	template<typename ElementType>
+	class ForElementType : public ForAnyElementType
+	{
+	public:
+		ElementType* GetAllocation() const
+		{
+			return (ElementType*)ForAnyElementType::GetAllocation();
+		}
+	};
+};
+
+template<typename ElementType>
+using TBuildingScratchArray = TArray<ElementType, TBuildingScratchAllocator<>>;
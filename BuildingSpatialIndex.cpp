@@ -0,0 +1,245 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingSpatialIndex.h"
+#include "BuildingGeometry.h"
+#include "BuildingLayer.h"
+#include "Algo/Sort.h"
+
+//ÿڵ
+const int32 spatial_node_size = 16;
+
+//STRXֳԼsqrt(ڵ)ڰYڵspatial_node_sizeԪһڵ
+template<typename EntryType>
+static void SortTileRecursive(TArray<EntryType>& entries)
+{
+	if (entries.Num() == 0)
+	{
+		return;
+	}
+	int32 node_count = FMath::DivideAndRoundUp(entries.Num(), spatial_node_size);
+	int32 slice_count = FMath::CeilToInt(FMath::Sqrt((float)node_count));
+	int32 slice_size = FMath::DivideAndRoundUp(node_count, slice_count) * spatial_node_size;
+	Algo::Sort(entries, [](const EntryType& a, const EntryType& b)
+	{
+		return a.bounds.Min.X + a.bounds.Max.X < b.bounds.Min.X + b.bounds.Max.X;
+	});
+	for (int32 begin = 0; begin < entries.Num(); begin += slice_size)
+	{
+		TArrayView<EntryType> slice(entries.GetData() + begin, FMath::Min(slice_size, entries.Num() - begin));
+		Algo::Sort(slice, [](const EntryType& a, const EntryType& b)
+		{
+			return a.bounds.Min.Y + a.bounds.Max.Y < b.bounds.Min.Y + b.bounds.Max.Y;
+		});
+	}
+}
+
+void FBuildingSpatialIndex::Build(const TMap<int32, FBuildingLayer>& layer_data)
+{
+	Empty();
+	int32 building_count = 0;
+	for (auto it_layer_data = layer_data.begin(); it_layer_data != layer_data.end(); ++it_layer_data)
+	{
+		m_layers.Emplace(it_layer_data->Key, &it_layer_data->Value);
+		building_count += it_layer_data->Value.Num();
+	}
+	m_items.Reserve(building_count);
+	for (int32 layer = 0; layer < m_layers.Num(); layer++)
+	{
+		const FBuildingLayer& buildings = *m_layers[layer].Value;
+		for (int32 i = 0; i < buildings.Num(); i++)
+		{
+			if (buildings.GetRingSize(i) >= 3)
+			{
+				m_items.Add(FItem{ buildings.GetBounds(i), layer, i });
+			}
+		}
+	}
+	if (m_items.Num() == 0)
+	{
+		return;
+	}
+
+	//Ҷڵ
+	SortTileRecursive(m_items);
+	TArray<FNode> level;
+	level.Reserve(FMath::DivideAndRoundUp(m_items.Num(), spatial_node_size));
+	for (int32 begin = 0; begin < m_items.Num(); begin += spatial_node_size)
+	{
+		FNode node{ FBox2D(ForceInit), begin, FMath::Min(spatial_node_size, m_items.Num() - begin), true };
+		for (int32 i = begin; i < begin + node.count; i++)
+		{
+			node.bounds += m_items[i].bounds;
+		}
+		level.Add(node);
+	}
+
+	//ϴͬһڵӽڵm_nodesţڵ
+	while (level.Num() > 1)
+	{
+		SortTileRecursive(level);
+		int32 offset = m_nodes.Num();
+		m_nodes.Append(level);
+		TArray<FNode> parents;
+		parents.Reserve(FMath::DivideAndRoundUp(level.Num(), spatial_node_size));
+		for (int32 begin = 0; begin < level.Num(); begin += spatial_node_size)
+		{
+			FNode node{ FBox2D(ForceInit), offset + begin, FMath::Min(spatial_node_size, level.Num() - begin), false };
+			for (int32 i = begin; i < begin + node.count; i++)
+			{
+				node.bounds += level[i].bounds;
+			}
+			parents.Add(node);
+		}
+		level = MoveTemp(parents);
+	}
+	m_nodes.Append(level);
+	m_root = m_nodes.Num() - 1;
+}
+
+void FBuildingSpatialIndex::Empty()
+{
+	m_layers.Empty();
+	m_items.Empty();
+	m_nodes.Empty();
+	m_root = INDEX_NONE;
+}
+
+SIZE_T FBuildingSpatialIndex::GetAllocatedSize() const
+{
+	return m_layers.GetAllocatedSize() + m_items.GetAllocatedSize() + m_nodes.GetAllocatedSize();
+}
+
+TArrayView<const FVector2D> FBuildingSpatialIndex::getRing(const FItem& item) const
+{
+	return m_layers[item.layer].Value->GetRing(item.index);
+}
+
+FBuildingHit FBuildingSpatialIndex::makeHit(const FItem& item, double distance) const
+{
+	FBuildingHit hit;
+	hit.layer_id = m_layers[item.layer].Key;
+	hit.index = item.index;
+	hit.distance = distance;
+	return hit;
+}
+
+template<typename OverlapsType, typename VisitType>
+void FBuildingSpatialIndex::forEachCandidate(OverlapsType overlaps, VisitType visit) const
+{
+	if (m_root == INDEX_NONE)
+	{
+		return;
+	}
+	TArray<int32, TInlineAllocator<64>> stack;
+	stack.Add(m_root);
+	while (stack.Num() > 0)
+	{
+		const FNode& node = m_nodes[stack.Pop(false)];
+		if (!overlaps(node.bounds))
+		{
+			continue;
+		}
+		for (int32 i = node.first; i < node.first + node.count; i++)
+		{
+			if (!node.leaf)
+			{
+				stack.Add(i);
+			}
+			else if (overlaps(m_items[i].bounds) && !visit(m_items[i]))
+			{
+				return;
+			}
+		}
+	}
+}
+
+bool FBuildingSpatialIndex::PickPoint(const FVector2D& point, FBuildingHit& hit) const
+{
+	bool found = false;
+	forEachCandidate([&](const FBox2D& bounds) { return bounds.IsInsideOrOn(point); }, [&](const FItem& item)
+	{
+		found = PointInPolygon(getRing(item), point);
+		if (found)
+		{
+			hit = makeHit(item, 0.0);
+		}
+		return !found;
+	});
+	return found;
+}
+
+void FBuildingSpatialIndex::QueryBox(const FBox2D& box, TArray<FBuildingHit>& hits) const
+{
+	hits.Reset();
+	forEachCandidate([&](const FBox2D& bounds) { return box.Intersect(bounds); }, [&](const FItem& item)
+	{
+		//ΧȫھʱҪȷж
+		if (box.IsInside(item.bounds) || PolygonIntersectBox(getRing(item), box))
+		{
+			hits.Add(makeHit(item, 0.0));
+		}
+		return true;
+	});
+}
+
+void FBuildingSpatialIndex::QueryRadius(const FVector2D& center, double radius, TArray<FBuildingHit>& hits) const
+{
+	hits.Reset();
+	double radius_squared = radius * radius;
+	forEachCandidate([&](const FBox2D& bounds) { return bounds.ComputeSquaredDistanceToPoint(center) <= radius_squared; }, [&](const FItem& item)
+	{
+		double distance_squared = PointPolygonDistanceSquared(getRing(item), center);
+		if (distance_squared <= radius_squared)
+		{
+			hits.Add(makeHit(item, FMath::Sqrt(distance_squared)));
+		}
+		return true;
+	});
+}
+
+void FBuildingSpatialIndex::QueryNearest(const FVector2D& point, int32 count, TArray<FBuildingHit>& hits) const
+{
+	hits.Reset();
+	if (m_root == INDEX_NONE || count <= 0)
+	{
+		return;
+	}
+
+	//СչڵѡðΧо룬ȷ벻СڰΧо룬ѵľȷΪһĽ
+	enum class EEntryType : uint8
+	{
+		Node,
+		Candidate,
+		Exact
+	};
+	struct FEntry
+	{
+		double distance;
+		int32 index;
+		EEntryType type;
+	};
+	auto closer = [](const FEntry& a, const FEntry& b) { return a.distance < b.distance; };
+	TArray<FEntry, TInlineAllocator<256>> heap;
+	heap.HeapPush(FEntry{ m_nodes[m_root].bounds.ComputeSquaredDistanceToPoint(point), m_root, EEntryType::Node }, closer);
+	while (heap.Num() > 0 && hits.Num() < count)
+	{
+		FEntry entry;
+		heap.HeapPop(entry, closer, false);
+		if (entry.type == EEntryType::Exact)
+		{
+			hits.Add(makeHit(m_items[entry.index], FMath::Sqrt(entry.distance)));
+			continue;
+		}
+		if (entry.type == EEntryType::Candidate)
+		{
+			double distance = PointPolygonDistanceSquared(getRing(m_items[entry.index]), point);
+			heap.HeapPush(FEntry{ distance, entry.index, EEntryType::Exact }, closer);
+			continue;
+		}
+		const FNode& node = m_nodes[entry.index];
+		for (int32 i = node.first; i < node.first + node.count; i++)
+		{
+			const FBox2D& bounds = node.leaf ? m_items[i].bounds : m_nodes[i].bounds;
+			heap.HeapPush(FEntry{ bounds.ComputeSquaredDistanceToPoint(point), i, node.leaf ? EEntryType::Candidate : EEntryType::Node }, closer);
+		}
+	}
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBuildingLayer;
+
+//ռѯеĽdistanceΪľ룬ʱΪ0
+struct FBuildingHit
+{
+	int32 layer_id = 0;
+	int32 index = 0;
+	double distance = 0.0;
+};
+
+//ΧеRSTRSort-Tile-Recursiveһֻڶ߳ͬʱѯ
+//ѯȰΧɸѡѡֻԺѡȷжϣΪͶӰ
+//ͼָ룬ͼ޸ĻƶҪ¹
+class FBuildingSpatialIndex
+{
+public:
+	void Build(const TMap<int32, FBuildingLayer>& layer_data);
+	void Empty();
+	int32 Num() const { return m_items.Num(); }
+	SIZE_T GetAllocatedSize() const;
+
+	//õĽصʱصһҵ
+	bool PickPoint(const FVector2D& point, FBuildingHit& hit) const;
+	//ཻĽ
+	void QueryBox(const FBox2D& box, TArray<FBuildingHit>& hits) const;
+	//Բĵľ벻뾶Ľ
+	void QueryRadius(const FVector2D& center, double radius, TArray<FBuildingHit>& hits) const;
+	//ӽԶcount
+	void QueryNearest(const FVector2D& point, int32 count, TArray<FBuildingHit>& hits) const;
+
+private:
+	struct FItem
+	{
+		FBox2D bounds;
+		int32 layer;
+		int32 index;
+	};
+	//ҶڵΪm_items[first, first + count)ڲڵΪm_nodesеӽڵ
+	struct FNode
+	{
+		FBox2D bounds;
+		int32 first;
+		int32 count;
+		bool leaf;
+	};
+
+	TArrayView<const FVector2D> getRing(const FItem& item) const;
+	FBuildingHit makeHit(const FItem& item, double distance) const;
+	//ΧoverlapsĽڵ뽨visitfalseʱֹͣ
+	template<typename OverlapsType, typename VisitType>
+	void forEachCandidate(OverlapsType overlaps, VisitType visit) const;
+
+	TArray<TPair<int32, const FBuildingLayer*>> m_layers;
+	TArray<FItem> m_items;
+	TArray<FNode> m_nodes;
+	int32 m_root = INDEX_NONE;
+};
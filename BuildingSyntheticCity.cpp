@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingSyntheticCity.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonSerializer.h"
+#include "Templates/UniquePtr.h"
+
+//GenerateMeshͶӰοһ
+const double synthetic_ref_lon = 114.3;
+const double synthetic_ref_lat = 30.6;
+//뽨Ӱ뾶ף
+const double synthetic_block_size = 40.0;
+const double synthetic_min_radius = 6.0;
+const double synthetic_max_radius = 15.0;
+//ظǰɸѡȡ
+const int32 synthetic_prototype_count = 16;
+//ÿдôҪˢһλ
+const int32 synthetic_flush_count = 1024;
+
+struct FSyntheticShape
+{
+	//Խĵ꣨ף
+	TArray<FVector2D> ring;
+	double height;
+	bool concave;
+};
+
+static void MakeSyntheticShape(const FSyntheticCitySettings& settings, FRandomStream& random, FSyntheticShape& shape)
+{
+	int32 count = random.RandRange(FMath::Max(settings.min_vertices, 3), FMath::Max(settings.max_vertices, settings.min_vertices));
+	shape.concave = random.FRand() < settings.concave_ratio;
+	//Ҫ5а
+	if (shape.concave)
+	{
+		count = FMath::Max(count, 5);
+	}
+	double radius_x = random.FRandRange(synthetic_min_radius, synthetic_max_radius);
+	double radius_y = random.FRandRange(synthetic_min_radius, synthetic_max_radius);
+	double rotation = random.FRandRange(0.0f, PI);
+	double cos_rotation = FMath::Cos(rotation);
+	double sin_rotation = FMath::Sin(rotation);
+
+	//ԲϾȡΪ͹Σ4ʱΪΣθС뾶
+	shape.ring.Reset(count);
+	for (int32 i = 0; i < count; i++)
+	{
+		double angle = 2.0 * PI * (i + 0.5) / count;
+		double scale = shape.concave && i % 2 == 1 ? 0.55 : 1.0;
+		double x = radius_x * scale * FMath::Cos(angle);
+		double y = radius_y * scale * FMath::Sin(angle);
+		shape.ring.Add(FVector2D(cos_rotation * x - sin_rotation * y, sin_rotation * x + cos_rotation * y));
+	}
+
+	double u = random.FRand();
+	shape.height = settings.min_height + (settings.max_height - settings.min_height) * FMath::Pow(u, settings.height_skew);
+}
+
+static bool WriteUtf8(FArchive& writer, const FString& text)
+{
+	FTCHARToUTF8 utf8(*text);
+	writer.Serialize((void*)utf8.Get(), utf8.Length());
+	return !writer.IsError();
+}
+
+static bool WriteSyntheticLayer(const FString& file_name, const FSyntheticCitySettings& settings, int32 layer_index, FSyntheticCityStats& stats)
+{
+	TUniquePtr<FArchive> writer(IFileManager::Get().CreateFileWriter(*file_name));
+	if (!writer)
+	{
+		UE_LOG(LogClass, Error, TEXT("create synthetic layer failed: %s"), *file_name);
+		return false;
+	}
+
+	//ÿͼУͼӰͼ
+	FRandomStream random(settings.seed * 7919 + layer_index);
+	TArray<FSyntheticShape> prototypes;
+	FSyntheticShape shape;
+
+	//׵ȵĻ㰴ογȼ
+	const double meters_per_degree = 111319.49;
+	double lat_scale = 1.0 / meters_per_degree;
+	double lon_scale = 1.0 / (meters_per_degree * FMath::Cos(synthetic_ref_lat * PI / 180.0));
+	int32 grid_size = FMath::Max(1, FMath::CeilToInt(FMath::Sqrt((double)settings.building_count)));
+
+	FString buffer = TEXT("{\"type\":\"FeatureCollection\",\"features\":[");
+	bool first_feature = true;
+	for (int32 i = layer_index; i < settings.building_count; i += settings.layer_count)
+	{
+		const FSyntheticShape* building = &shape;
+		bool duplicate = prototypes.Num() == synthetic_prototype_count && random.FRand() < settings.duplicate_ratio;
+		if (duplicate)
+		{
+			building = &prototypes[random.RandRange(0, prototypes.Num() - 1)];
+			stats.duplicates++;
+		}
+		else
+		{
+			MakeSyntheticShape(settings, random, shape);
+			if (prototypes.Num() < synthetic_prototype_count)
+			{
+				prototypes.Add(shape);
+			}
+		}
+		stats.buildings++;
+		stats.vertices += building->ring.Num();
+		stats.concave += building->concave ? 1 : 0;
+
+		//ͼ㹲һ񣬽žλ
+		double center_x = (i % grid_size - grid_size / 2) * synthetic_block_size;
+		double center_y = (i / grid_size - grid_size / 2) * synthetic_block_size;
+		buffer += first_feature ? TEXT("") : TEXT(",");
+		buffer += FString::Printf(TEXT("{\"type\":\"Feature\",\"properties\":{\"height\":%.2f,\"code\":%d},\"geometry\":{\"type\":\"MultiPolygon\",\"coordinates\":[[["),
+			building->height, i);
+		//GeoJSON⻷βպ
+		for (int32 k = 0; k <= building->ring.Num(); k++)
+		{
+			const FVector2D& point = building->ring[k % building->ring.Num()];
+			double lon = synthetic_ref_lon + (center_x + point.X) * lon_scale;
+			double lat = synthetic_ref_lat + (center_y + point.Y) * lat_scale;
+			buffer += FString::Printf(TEXT("%s[%.8f,%.8f]"), k == 0 ? TEXT("") : TEXT(","), lon, lat);
+		}
+		buffer += TEXT("]]]}}");
+		first_feature = false;
+
+		if (stats.buildings % synthetic_flush_count == 0)
+		{
+			if (!WriteUtf8(*writer, buffer))
+			{
+				return false;
+			}
+			buffer.Reset();
+		}
+	}
+	buffer += TEXT("]}");
+	return WriteUtf8(*writer, buffer) && writer->Close();
+}
+
+bool WriteSyntheticCity(const FString& directory, const FSyntheticCitySettings& settings, FSyntheticCityStats& stats)
+{
+	stats = FSyntheticCityStats();
+	if (settings.building_count <= 0 || settings.layer_count <= 0)
+	{
+		return false;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> layers;
+	for (int32 layer_index = 0; layer_index < settings.layer_count; layer_index++)
+	{
+		int32 layer_id = layer_index + 1;
+		FString url = FString::Printf(TEXT("layer_%d.geojson"), layer_id);
+		if (!WriteSyntheticLayer(directory / url, settings, layer_index, stats))
+		{
+			return false;
+		}
+
+		//ͼʹùе1.png2.png
+		TSharedPtr<FJsonObject> image_url = MakeShared<FJsonObject>();
+		image_url->SetStringField(TEXT("condition"), TEXT("[height>0]"));
+		image_url->SetArrayField(TEXT("value"), { MakeShared<FJsonValueString>(TEXT("1")), MakeShared<FJsonValueString>(TEXT("2")) });
+
+		TSharedPtr<FJsonObject> layer_config = MakeShared<FJsonObject>();
+		layer_config->SetNumberField(TEXT("opacity"), 1.0);
+		layer_config->SetArrayField(TEXT("roughness"), { MakeShared<FJsonValueNumber>(0.5), MakeShared<FJsonValueNumber>(0.7) });
+		layer_config->SetArrayField(TEXT("metalness"), { MakeShared<FJsonValueNumber>(0.1), MakeShared<FJsonValueNumber>(0.4) });
+		layer_config->SetArrayField(TEXT("imageUrl"), { MakeShared<FJsonValueObject>(image_url) });
+
+		TSharedPtr<FJsonObject> layer = MakeShared<FJsonObject>();
+		layer->SetNumberField(TEXT("id"), layer_id);
+		layer->SetStringField(TEXT("url"), url);
+		layer->SetStringField(TEXT("geometryType"), TEXT("GeoBuilding"));
+		layer->SetObjectField(TEXT("layerConfig"), layer_config);
+		layers.Add(MakeShared<FJsonValueObject>(layer));
+	}
+
+	TSharedPtr<FJsonObject> data = MakeShared<FJsonObject>();
+	data->SetArrayField(TEXT("layers"), layers);
+	data->SetBoolField(TEXT("useLayerCache"), false);
+	data->SetBoolField(TEXT("useRebuildCache"), false);
+	data->SetStringField(TEXT("packageRoot"), settings.package_root);
+	TSharedPtr<FJsonObject> root = MakeShared<FJsonObject>();
+	root->SetObjectField(TEXT("data"), data);
+
+	FString map_json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&map_json);
+	return FJsonSerializer::Serialize(root.ToSharedRef(), writer) && FFileHelper::SaveStringToFile(map_json, *(directory / TEXT("map.json")));
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//ϳɳݵĲͬɵļȫһ
+struct FSyntheticCitySettings
+{
+	int32 building_count = 100000;
+	int32 layer_count = 1;
+	//ÿ⻷ĵΧպϵ㣩
+	int32 min_vertices = 4;
+	int32 max_vertices = 12;
+	//ΣΣظνռ
+	float concave_ratio = 0.3f;
+	float duplicate_ratio = 0.2f;
+	//߶Ϊmin + (max - min) * u^skewskewԽ󰫽Խ
+	float min_height = 6.0f;
+	float max_height = 150.0f;
+	float height_skew = 2.0f;
+	int32 seed = 1;
+	//ԴİĿ¼ʽ決/Gameֿ
+	FString package_root = TEXT("/Game/BuildingBenchmark");
+};
+
+struct FSyntheticCityStats
+{
+	int32 buildings = 0;
+	int64 vertices = 0;
+	int32 concave = 0;
+	int32 duplicates = 0;
+};
+
+//directoryдmap.jsonlayer_<id>.geojsonڲο㸽رջ汣֤ÿɣ
+//ɵԴдsettings.package_rootʽ決ͬ
+bool WriteSyntheticCity(const FString& directory, const FSyntheticCitySettings& settings, FSyntheticCityStats& stats);
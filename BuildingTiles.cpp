@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingTiles.h"
+#include "BuildingLayer.h"
+#include "BuildingInstances.h"
+#include "Algo/Sort.h"
+
+//ĲڵΪͶӰοΪĵĹ̶Σֿ߽ݷΧ޹أɾƶֿ飻
+//߳2^22׸ǲοΧԼ400016ʱСֿ߳128
+const double tile_root_half_size = 4194304.0;
+
+struct FTileItem
+{
+	int32 coord_count;
+	int32 layer_id;
+	int32 index;
+	FBox box;
+	FVector2D center;
+};
+
+//ԪƵǰ棬صһλ
+template<typename PredicateType>
+static int32 PartitionTileItems(TArray<FTileItem>& items, int32 begin, int32 end, PredicateType predicate)
+{
+	int32 first = begin;
+	for (int32 i = begin; i < end; i++)
+	{
+		if (predicate(items[i]))
+		{
+			Swap(items[first], items[i]);
+			first++;
+		}
+	}
+	return first;
+}
+
+//Ⱦ
+struct FTileMeshCost
+{
+	int64 vertices = 0;
+	int64 triangles = 0;
+};
+
+//ǽÿ2λãı߷ֱʹu=0u=1̬񹹽Ϊ4Ⱦ㣬ÿ2Σ
+//ݶÿ1㣬n - 2ΡһܳÿǽֶУֶ
+static void GetBuildingCost(int32 count, FTileMeshCost& wall, FTileMeshCost& roof)
+{
+	wall.vertices += 4 * count;
+	wall.triangles += 2 * count;
+	roof.vertices += count;
+	roof.triangles += FMath::Max(count - 2, 0);
+}
+
+static bool IsWithinBudget(const FTileMeshCost& cost, const FBuildingTileBudget& budget)
+{
+	return cost.vertices <= budget.max_vertices && cost.triangles <= budget.max_triangles;
+}
+
+static void AddBuildingTile(TArray<FTileItem>& items, int32 begin, int32 end, const FString& name, TArray<FBuildingTile>& tiles)
+{
+	//ķʱĽʹ˳ܿ⽨Ӱ죬ͼ򣬿ڽʱݹϣ
+	Algo::Sort(TArrayView<FTileItem>(items.GetData() + begin, end - begin), [](const FTileItem& a, const FTileItem& b)
+	{
+		return a.layer_id != b.layer_id ? a.layer_id < b.layer_id : a.index < b.index;
+	});
+	FBuildingTile& tile = tiles.AddDefaulted_GetRef();
+	tile.name = name;
+	tile.bounds = FBox(ForceInit);
+	tile.layer_ids.Reserve(end - begin);
+	tile.building_indices.Reserve(end - begin);
+	for (int32 i = begin; i < end; i++)
+	{
+		tile.bounds += items[i].box;
+		tile.layer_ids.Add(items[i].layer_id);
+		tile.building_indices.Add(items[i].index);
+	}
+	FVector center = tile.bounds.GetCenter();
+	tile.origin = FVector(center.X, center.Y, 0.0f);
+}
+
+static void SplitBuildingTile(TArray<FTileItem>& items, int32 begin, int32 end, const FBox2D& area, int32 depth, int32 x, int32 y,
+	const FBuildingTileBudget& budget, TArray<FBuildingTile>& tiles)
+{
+	//ǽֶݶǲͬ񣬷ֱԤ
+	FTileMeshCost wall, roof;
+	for (int32 i = begin; i < end; i++)
+	{
+		GetBuildingCost(items[i].coord_count, wall, roof);
+	}
+
+	if ((IsWithinBudget(wall, budget) && IsWithinBudget(roof, budget)) || depth >= budget.max_depth || end - begin <= 1)
+	{
+		AddBuildingTile(items, begin, end, FString::Printf(TEXT("%d_%d_%d"), depth, x, y), tiles);
+		return;
+	}
+
+	//Χڵķ
+	FVector2D center = area.GetCenter();
+	int32 mid = PartitionTileItems(items, begin, end, [&](const FTileItem& item) { return item.center.Y < center.Y; });
+	int32 bounds[5];
+	bounds[0] = begin;
+	bounds[1] = PartitionTileItems(items, begin, mid, [&](const FTileItem& item) { return item.center.X < center.X; });
+	bounds[2] = mid;
+	bounds[3] = PartitionTileItems(items, mid, end, [&](const FTileItem& item) { return item.center.X < center.X; });
+	bounds[4] = end;
+
+	for (int32 quadrant = 0; quadrant < 4; quadrant++)
+	{
+		if (bounds[quadrant] == bounds[quadrant + 1])
+		{
+			continue;
+		}
+		int32 dx = quadrant % 2;
+		int32 dy = quadrant / 2;
+		FBox2D child;
+		child.Min = FVector2D(dx == 0 ? area.Min.X : center.X, dy == 0 ? area.Min.Y : center.Y);
+		child.Max = FVector2D(dx == 0 ? center.X : area.Max.X, dy == 0 ? center.Y : area.Max.Y);
+		child.bIsValid = true;
+		SplitBuildingTile(items, bounds[quadrant], bounds[quadrant + 1], child, depth + 1, x * 2 + dx, y * 2 + dy, budget, tiles);
+	}
+}
+
+void MakeBuildingTiles(const TMap<int32, FBuildingLayer>& layer_data, const TMap<int32, TArray<FBuildingInstances>>& prototype_instances,
+	const FBuildingTileBudget& budget, TArray<FBuildingTile>& tiles)
+{
+	tiles.Empty();
+
+	int32 building_count = 0;
+	for (auto it_layer_data = layer_data.begin(); it_layer_data != layer_data.end(); ++it_layer_data)
+	{
+		building_count += it_layer_data->Value.Num();
+	}
+
+	TArray<FTileItem> items;
+	items.Reserve(building_count);
+	for (auto it_layer_data = layer_data.begin(); it_layer_data != layer_data.end(); ++it_layer_data)
+	{
+		const FBuildingLayer& buildings = it_layer_data->Value;
+		TArray<bool> instanced;
+		instanced.SetNumZeroed(buildings.Num());
+		if (const TArray<FBuildingInstances>* layer_instances = prototype_instances.Find(it_layer_data->Key))
+		{
+			for (const FBuildingInstances& instances : *layer_instances)
+			{
+				for (int32 index : instances.building_indices)
+				{
+					instanced[index] = true;
+				}
+			}
+		}
+		for (int32 i = 0; i < buildings.Num(); i++)
+		{
+			int32 coord_count = buildings.GetRingSize(i);
+			if (coord_count == 0 || instanced[i])
+			{
+				continue;
+			}
+			const FBox2D& bounds = buildings.GetBounds(i);
+			FTileItem item;
+			item.coord_count = coord_count;
+			item.layer_id = it_layer_data->Key;
+			item.index = i;
+			item.box = FBox(FVector(bounds.Min, 0.0f), FVector(bounds.Max, buildings.GetHeight(i)));
+			item.center = FVector2D(item.box.GetCenter());
+			items.Add(item);
+		}
+	}
+	if (items.Num() == 0)
+	{
+		return;
+	}
+
+	//ڵ㷶ΧĽڷԵķֿ
+	FBox2D root(FVector2D(-tile_root_half_size, -tile_root_half_size), FVector2D(tile_root_half_size, tile_root_half_size));
+	SplitBuildingTile(items, 0, items.Num(), root, 0, 0, 0, budget, tiles);
+}
+
+void MakePrototypeTiles(const TMap<int32, FBuildingLayer>& prototype_data, const TMap<int32, TArray<FBuildingInstances>>& prototype_instances,
+	TArray<FBuildingTile>& tiles)
+{
+	for (auto it_prototype_data = prototype_data.begin(); it_prototype_data != prototype_data.end(); ++it_prototype_data)
+	{
+		const FBuildingLayer& prototypes = it_prototype_data->Value;
+		const TArray<FBuildingInstances>& instances = prototype_instances.FindChecked(it_prototype_data->Key);
+		for (int32 i = 0; i < prototypes.Num(); i++)
+		{
+			const FBox2D& bounds = prototypes.GetBounds(i);
+			FBuildingTile& tile = tiles.AddDefaulted_GetRef();
+			tile.name = FString::Printf(TEXT("instance_%d_%d"), it_prototype_data->Key, i);
+			tile.origin = FVector::ZeroVector;
+			tile.bounds = FBox(FVector(bounds.Min, 0.0f), FVector(bounds.Max, prototypes.GetHeight(i)));
+			tile.layer_ids.Add(it_prototype_data->Key);
+			tile.building_indices.Add(i);
+			tile.instances = instances[i].transforms;
+		}
+	}
+}
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBuildingLayer;
+struct FBuildingInstances;
+
+//Ŀռֿ飬ÿÿǽֶΡݶһ
+struct FBuildingTile
+{
+	//Ĳ㼶кţ
+	FString name;
+	//񶥵Ըõ㱣棬ȡΧе
+	FVector origin;
+	//ڽĽΧУ߶ȷΧΪ0߽
+	FBox bounds;
+	//ͼͼе
+	TArray<int32> layer_ids;
+	TArray<int32> building_indices;
+	//ǿʱΪʵԭͿ飺ֻһ׼̬ԭͽЩ任
+	TArray<FTransform> instances;
+};
+
+//ÿһǽֶλݶȾ㡢Ԥ㣬ÿڵе
+struct FBuildingTileBudget
+{
+	int32 max_vertices;
+	int32 max_triangles;
+	int32 max_depth;
+};
+
+//ͶӰڹ̶ϽĲԤĽڵķֱ֣Ԥ㡢ֻʣһ򵽴
+//ʵĽֿ
+void MakeBuildingTiles(const TMap<int32, FBuildingLayer>& layer_data, const TMap<int32, TArray<FBuildingInstances>>& prototype_instances,
+	const FBuildingTileBudget& budget, TArray<FBuildingTile>& tiles);
+//ÿԭ׷һ飬ԭΪԭ㣬building_indicesΪԭprototype_dataе
+void MakePrototypeTiles(const TMap<int32, FBuildingLayer>& prototype_data, const TMap<int32, TArray<FBuildingInstances>>& prototype_instances,
+	TArray<FBuildingTile>& tiles);
@@ -0,0 +1,218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "BuildingVertexCache.h"
+#include "BuildingMeshChunks.h"
+#include "BuildingBakeReport.h"
+
+int64 CountVertexCacheMisses(TArrayView<const int32> indices, int32 vertex_count, int32 cache_size)
+{
+	//뻺ʱ̣֮뻺Ķ㲻cache_sizeʱڻ
+	TArray<int64> cache_time;
+	cache_time.SetNumZeroed(vertex_count);
+	int64 time = cache_size + 1;
+	int64 misses = 0;
+	for (int32 index : indices)
+	{
+		if (time - cache_time[index] > cache_size)
+		{
+			cache_time[index] = time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+void OptimizeVertexCache(TArrayView<const int32> indices, int32 vertex_count, TArray<int32>& triangle_order, int32 cache_size)
+{
+	int32 triangle_count = indices.Num() / 3;
+	int32 index_count = triangle_count * 3;
+	triangle_order.Reset(triangle_count);
+
+	//ÿΣ
+	TArray<int32> offsets;
+	offsets.SetNumZeroed(vertex_count + 1);
+	for (int32 i = 0; i < index_count; i++)
+	{
+		offsets[indices[i] + 1]++;
+	}
+	for (int32 v = 0; v < vertex_count; v++)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+	TArray<int32> adjacency;
+	adjacency.SetNumUninitialized(index_count);
+	TArray<int32> live;
+	live.SetNumUninitialized(vertex_count);
+	for (int32 v = 0; v < vertex_count; v++)
+	{
+		live[v] = offsets[v];
+	}
+	for (int32 i = 0; i < index_count; i++)
+	{
+		adjacency[live[indices[i]]++] = i / 3;
+	}
+	//liveΪδ
+	for (int32 v = 0; v < vertex_count; v++)
+	{
+		live[v] = offsets[v + 1] - offsets[v];
+	}
+
+	TArray<int64> cache_time;
+	cache_time.SetNumZeroed(vertex_count);
+	TArray<bool> emitted;
+	emitted.SetNumZeroed(triangle_count);
+	TArray<int32> dead_end;
+	dead_end.Reserve(index_count);
+	TArray<int32> candidates;
+	int64 time = cache_size + 1;
+	int32 cursor = 0;
+
+	//ûкʵĺѡʱȻصĶ㣬ٰŲһεĶ
+	auto skip_dead_end = [&]()
+	{
+		while (dead_end.Num() > 0)
+		{
+			int32 v = dead_end.Pop(false);
+			if (live[v] > 0)
+			{
+				return v;
+			}
+		}
+		while (cursor < vertex_count && live[cursor] == 0)
+		{
+			cursor++;
+		}
+		return cursor < vertex_count ? cursor : INDEX_NONE;
+	};
+
+	int32 fan = skip_dead_end();
+	while (fan != INDEX_NONE)
+	{
+		//ζȫʣ
+		candidates.Reset();
+		for (int32 k = offsets[fan]; k < offsets[fan + 1]; k++)
+		{
+			int32 triangle = adjacency[k];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = true;
+			triangle_order.Add(triangle);
+			for (int32 corner = 0; corner < 3; corner++)
+			{
+				int32 v = indices[triangle * 3 + corner];
+				dead_end.Add(v);
+				candidates.Add(v);
+				live[v]--;
+				if (time - cache_time[v] > cache_size)
+				{
+					cache_time[v] = time++;
+				}
+			}
+		}
+
+		//һζ㣺ʣκԻڻеĶ뻺һ
+		int32 next = INDEX_NONE;
+		int64 best_priority = -1;
+		for (int32 v : candidates)
+		{
+			if (live[v] == 0)
+			{
+				continue;
+			}
+			int64 priority = 0;
+			if (time - cache_time[v] + 2 * live[v] <= cache_size)
+			{
+				priority = time - cache_time[v];
+			}
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				next = v;
+			}
+		}
+		fan = next != INDEX_NONE ? next : skip_dead_end();
+	}
+}
+
+void OptimizeVertexFetch(TArrayView<const int32> indices, int32 vertex_count, TArray<int32>& remap)
+{
+	remap.Init(INDEX_NONE, vertex_count);
+	int32 next = 0;
+	for (int32 index : indices)
+	{
+		if (remap[index] == INDEX_NONE)
+		{
+			remap[index] = next++;
+		}
+	}
+	for (int32& index : remap)
+	{
+		if (index == INDEX_NONE)
+		{
+			index = next++;
+		}
+	}
+}
+
+//µ˳ƶÿεstrideԪأ鲻
+template<typename ValueType>
+static void ReorderTriangles(TArray<ValueType>& values, TArrayView<const int32> triangle_order, int32 stride)
+{
+	if (values.Num() != triangle_order.Num() * stride)
+	{
+		return;
+	}
+	TArray<ValueType> reordered;
+	reordered.SetNumUninitialized(values.Num());
+	for (int32 k = 0; k < triangle_order.Num(); k++)
+	{
+		for (int32 i = 0; i < stride; i++)
+		{
+			reordered[k * stride + i] = values[triangle_order[k] * stride + i];
+		}
+	}
+	values = MoveTemp(reordered);
+}
+
+template<typename ValueType>
+static void RemapVertices(TArray<ValueType>& values, TArrayView<const int32> remap)
+{
+	if (values.Num() != remap.Num())
+	{
+		return;
+	}
+	TArray<ValueType> remapped;
+	remapped.SetNumUninitialized(values.Num());
+	for (int32 i = 0; i < values.Num(); i++)
+	{
+		remapped[remap[i]] = values[i];
+	}
+	values = MoveTemp(remapped);
+}
+
+void OptimizePMCMesh(FPMCMeshChunk& mesh, FBuildingVertexCacheStats& stats)
+{
+	double start_time = FPlatformTime::Seconds();
+	int32 vertex_count = mesh.Vertices.Num();
+	stats.triangles += mesh.Index.Num() / 3;
+	stats.misses_before += CountVertexCacheMisses(mesh.Index, vertex_count);
+
+	TArray<int32> triangle_order;
+	OptimizeVertexCache(mesh.Index, vertex_count, triangle_order);
+	ReorderTriangles(mesh.Index, triangle_order, 3);
+
+	TArray<int32> remap;
+	OptimizeVertexFetch(mesh.Index, vertex_count, remap);
+	for (int32& index : mesh.Index)
+	{
+		index = remap[index];
+	}
+	RemapVertices(mesh.Vertices, remap);
+	RemapVertices(mesh.Normals, remap);
+	RemapVertices(mesh.UV, remap);
+	RemapVertices(mesh.VertexColors, remap);
+
+	stats.misses_after += CountVertexCacheMisses(mesh.Index, vertex_count);
+	stats.seconds += FPlatformTime::Seconds() - start_time;
+}
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FPMCMeshChunk;
+struct FBuildingVertexCacheStats;
+
+//ģĺ任㻺С볣GPU൱
+const int32 vertex_cache_size = 16;
+
+//FIFO㻺ģͳδдΪACMR
+int64 CountVertexCacheMisses(TArrayView<const int32> indices, int32 vertex_count, int32 cache_size = vertex_cache_size);
+//TipsifyΧƻеĶΣε˳ڵĶ˳򲻱䣬Ӱ
+void OptimizeVertexCache(TArrayView<const int32> indices, int32 vertex_count, TArray<int32>& triangle_order, int32 cache_size = vertex_cache_size);
+//״γֵ˳±ţremap[]ΪţδʹõĶ
+void OptimizeVertexFetch(TArrayView<const int32> indices, int32 vertex_count, TArray<int32>& remap);
+
+//붥㣬ۼŻǰĻδд
+void OptimizePMCMesh(FPMCMeshChunk& mesh, FBuildingVertexCacheStats& stats);
@@ -0,0 +1,695 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "GeoJsonStreamReader.h"
+#include "BuildingLayer.h"
+#include "BuildingGeometry.h"
+#include "HAL/PlatformFilemanager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+
+//ÿδļȡֽ
+const int32 stream_chunk_size = 1 << 20;
+const float stream_threshold = FLT_EPSILON;
+
+//10ݣdoubleпɾȷʾ
+static const double exact_pow10[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+FGeoJsonStreamReader::FGeoJsonStreamReader()
+	: m_file(nullptr)
+	, m_file_size(0)
+	, m_file_offset(0)
+	, m_buffer_pos(0)
+	, m_buffer_end(0)
+{
+}
+
+FGeoJsonStreamReader::~FGeoJsonStreamReader()
+{
+	Close();
+}
+
+bool FGeoJsonStreamReader::Open(const FString& file_name)
+{
+	Close();
+	m_file = FPlatformFileManager::Get().GetPlatformFile().OpenRead(*file_name);
+	if (m_file == nullptr)
+	{
+		return SetError(*(file_name + TEXT(" ļʧ")));
+	}
+	m_file_size = m_file->Size();
+	m_buffer.SetNumUninitialized(stream_chunk_size);
+
+	//UTF-8 BOM
+	if (FillBuffer() && m_buffer_end >= 3 && m_buffer[0] == 0xEF && m_buffer[1] == 0xBB && m_buffer[2] == 0xBF)
+	{
+		m_buffer_pos = 3;
+	}
+	return true;
+}
+
+void FGeoJsonStreamReader::Close()
+{
+	if (m_file != nullptr)
+	{
+		delete m_file;
+		m_file = nullptr;
+	}
+	m_file_size = 0;
+	m_file_offset = 0;
+	m_buffer_pos = 0;
+	m_buffer_end = 0;
+	m_buffer.Empty();
+	m_error.Empty();
+}
+
+bool FGeoJsonStreamReader::ReadBuildings(FBuildingLayer& building_data)
+{
+	if (m_file == nullptr)
+	{
+		return SetError(TEXT("ļδ"));
+	}
+	return ReadFeatureCollection(building_data);
+}
+
+bool FGeoJsonStreamReader::FillBuffer()
+{
+	if (m_buffer_pos < m_buffer_end)
+	{
+		return true;
+	}
+	int64 remain = m_file_size - m_file_offset;
+	if (remain <= 0)
+	{
+		return false;
+	}
+	int32 size = (int32)FMath::Min<int64>(remain, stream_chunk_size);
+	if (!m_file->Read(m_buffer.GetData(), size))
+	{
+		return SetError(TEXT("ȡļʧ"));
+	}
+	m_file_offset += size;
+	m_buffer_pos = 0;
+	m_buffer_end = size;
+	return true;
+}
+
+bool FGeoJsonStreamReader::ReadChar(ANSICHAR& c)
+{
+	if (m_buffer_pos >= m_buffer_end && !FillBuffer())
+	{
+		return false;
+	}
+	c = (ANSICHAR)m_buffer[m_buffer_pos++];
+	return true;
+}
+
+bool FGeoJsonStreamReader::PeekToken(ANSICHAR& c)
+{
+	while (m_buffer_pos < m_buffer_end || FillBuffer())
+	{
+		c = (ANSICHAR)m_buffer[m_buffer_pos];
+		if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+		{
+			return true;
+		}
+		m_buffer_pos++;
+	}
+	return SetError(TEXT("ļ"));
+}
+
+bool FGeoJsonStreamReader::Expect(ANSICHAR c)
+{
+	ANSICHAR token;
+	if (!PeekToken(token))
+	{
+		return false;
+	}
+	if (token != c)
+	{
+		return SetError(*FString::Printf(TEXT("ַ'%c'ʵΪ'%c'"), c, token));
+	}
+	m_buffer_pos++;
+	return true;
+}
+
+bool FGeoJsonStreamReader::NextElement(ANSICHAR close, bool& first)
+{
+	ANSICHAR token;
+	if (!PeekToken(token))
+	{
+		return false;
+	}
+	if (token == close)
+	{
+		m_buffer_pos++;
+		return false;
+	}
+	if (!first && !Expect(','))
+	{
+		return false;
+	}
+	first = false;
+	return true;
+}
+
+bool FGeoJsonStreamReader::ReadString(TArray<ANSICHAR>& str)
+{
+	if (!Expect('"'))
+	{
+		return false;
+	}
+	str.Reset();
+	ANSICHAR c;
+	while (ReadChar(c))
+	{
+		if (c == '"')
+		{
+			return true;
+		}
+		if (c == '\\' && !ReadChar(c))
+		{
+			break;
+		}
+		str.Add(c);
+	}
+	return SetError(TEXT("ַδ"));
+}
+
+bool FGeoJsonStreamReader::ReadNumber(double& value)
+{
+	ANSICHAR token;
+	if (!PeekToken(token))
+	{
+		return false;
+	}
+	//ֵַʽ
+	if (token == '"')
+	{
+		if (!ReadString(m_value))
+		{
+			return false;
+		}
+		m_value.Add('\0');
+		value = FCStringAnsi::Atod(m_value.GetData());
+		return true;
+	}
+
+	ANSICHAR number[64];
+	int32 len = 0;
+	while (m_buffer_pos < m_buffer_end || FillBuffer())
+	{
+		ANSICHAR c = (ANSICHAR)m_buffer[m_buffer_pos];
+		bool is_number_char = (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+		if (!is_number_char)
+		{
+			break;
+		}
+		if (len + 1 >= UE_ARRAY_COUNT(number))
+		{
+			return SetError(TEXT("ֵ"));
+		}
+		number[len++] = c;
+		m_buffer_pos++;
+	}
+	number[len] = '\0';
+
+	//nullȷֵ0FJsonObject::GetNumberFieldһ
+	if (len == 0)
+	{
+		value = 0.0;
+		return SkipValue();
+	}
+	if (!ParseNumber(number, len, value))
+	{
+		return SetError(TEXT("ֵʽ"));
+	}
+	return true;
+}
+
+bool FGeoJsonStreamReader::ParseNumber(const ANSICHAR* str, int32 len, double& value)
+{
+	const ANSICHAR* p = str;
+	const ANSICHAR* end = str + len;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	//ౣ19λЧ֣uint64
+	uint64 mantissa = 0;
+	int32 digits = 0;
+	int32 exponent = 0;
+	bool has_digit = false;
+	while (p < end && *p >= '0' && *p <= '9')
+	{
+		has_digit = true;
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0 ? 1 : 0;
+		}
+		else
+		{
+			exponent++;
+		}
+		p++;
+	}
+	if (p < end && *p == '.')
+	{
+		p++;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			has_digit = true;
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0 ? 1 : 0;
+				exponent--;
+			}
+			p++;
+		}
+	}
+	if (!has_digit)
+	{
+		return false;
+	}
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		bool exp_negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			exp_negative = *p == '-';
+			p++;
+		}
+		int32 exp_value = 0;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			exp_value = FMath::Min(exp_value * 10 + (*p - '0'), 10000);
+			p++;
+		}
+		exponent += exp_negative ? -exp_value : exp_value;
+	}
+	if (p != end)
+	{
+		return false;
+	}
+
+	//·Clingerβ2^53ʱɾȷתΪdouble뾫ȷ10ֻһγ˳ȷ룬Atodλһ£
+	//19λЧʱβȻ2^53λAtod
+	if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+	{
+		double result = (double)mantissa;
+		result = exponent < 0 ? result / exact_pow10[-exponent] : result * exact_pow10[exponent];
+		value = negative ? -result : result;
+		return true;
+	}
+	value = FCStringAnsi::Atod(str);
+	return true;
+}
+
+bool FGeoJsonStreamReader::SkipValue()
+{
+	ANSICHAR c;
+	if (!PeekToken(c))
+	{
+		return false;
+	}
+	if (c == '"')
+	{
+		return ReadString(m_value);
+	}
+	if (c == '{' || c == '[')
+	{
+		int32 depth = 0;
+		bool in_string = false;
+		do
+		{
+			if (!ReadChar(c))
+			{
+				return SetError(TEXT("ļ"));
+			}
+			if (in_string)
+			{
+				if (c == '\\')
+				{
+					ReadChar(c);
+				}
+				else if (c == '"')
+				{
+					in_string = false;
+				}
+			}
+			else if (c == '"')
+			{
+				in_string = true;
+			}
+			else if (c == '{' || c == '[')
+			{
+				depth++;
+			}
+			else if (c == '}' || c == ']')
+			{
+				depth--;
+			}
+		} while (depth > 0);
+		return true;
+	}
+
+	//ֵtruefalsenull
+	while (m_buffer_pos < m_buffer_end || FillBuffer())
+	{
+		c = (ANSICHAR)m_buffer[m_buffer_pos];
+		if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' || c == '\r' || c == '\t')
+		{
+			break;
+		}
+		m_buffer_pos++;
+	}
+	return true;
+}
+
+bool FGeoJsonStreamReader::ReadFeatureCollection(FBuildingLayer& building_data)
+{
+	if (!Expect('{'))
+	{
+		return false;
+	}
+	bool first = true;
+	while (NextElement('}', first))
+	{
+		if (!ReadString(m_key) || !Expect(':'))
+		{
+			return false;
+		}
+		if (!KeyEquals(m_key, "features"))
+		{
+			if (!SkipValue())
+			{
+				return false;
+			}
+			continue;
+		}
+
+		if (!Expect('['))
+		{
+			return false;
+		}
+		bool first_feature = true;
+		while (NextElement(']', first_feature))
+		{
+			ANSICHAR token;
+			if (!PeekToken(token))
+			{
+				return false;
+			}
+			bool result = token == '{' ? ReadFeature(building_data) : SkipValue();
+			if (!result)
+			{
+				return false;
+			}
+		}
+		if (!m_error.IsEmpty())
+		{
+			return false;
+		}
+	}
+	return m_error.IsEmpty();
+}
+
+bool FGeoJsonStreamReader::ReadFeature(FBuildingLayer& building_data)
+{
+	//Ҫصļ˳֣д뽨飬ٲȫ
+	int32 first_building = building_data.Num();
+	bool is_feature = false;
+	bool has_properties = false;
+	bool is_multi_polygon = false;
+	double height = 0.0;
+	int32 code = 0;
+
+	if (!Expect('{'))
+	{
+		return false;
+	}
+	bool first = true;
+	while (NextElement('}', first))
+	{
+		if (!ReadString(m_key) || !Expect(':'))
+		{
+			return false;
+		}
+		bool result = true;
+		if (KeyEquals(m_key, "type"))
+		{
+			result = ReadString(m_value);
+			is_feature = KeyEquals(m_value, "Feature");
+		}
+		else if (KeyEquals(m_key, "properties"))
+		{
+			result = ReadProperties(height, code, has_properties);
+		}
+		else if (KeyEquals(m_key, "geometry"))
+		{
+			result = ReadGeometry(building_data, is_multi_polygon);
+		}
+		else
+		{
+			result = SkipValue();
+		}
+		if (!result)
+		{
+			return false;
+		}
+	}
+	if (!m_error.IsEmpty())
+	{
+		return false;
+	}
+
+	if (!is_feature)
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("type is not Feature"));
+		building_data.Truncate(first_building);
+		return true;
+	}
+	if (!has_properties)
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("properties is null"));
+		building_data.Truncate(first_building);
+		return true;
+	}
+	if (!is_multi_polygon)
+	{
+		UE_LOG(LogBuildingCore, Error, TEXT("geometry type is not multipolygon"));
+		building_data.Truncate(first_building);
+		return true;
+	}
+	for (int32 i = first_building; i < building_data.Num(); i++)
+	{
+		building_data.SetAttributes(i, code, height);
+	}
+	return true;
+}
+
+bool FGeoJsonStreamReader::ReadProperties(double& height, int32& code, bool& has_properties)
+{
+	ANSICHAR token;
+	if (!PeekToken(token))
+	{
+		return false;
+	}
+	if (token != '{')
+	{
+		has_properties = false;
+		return SkipValue();
+	}
+
+	has_properties = true;
+	m_buffer_pos++;
+	bool first = true;
+	while (NextElement('}', first))
+	{
+		if (!ReadString(m_key) || !Expect(':'))
+		{
+			return false;
+		}
+		bool result = true;
+		double value = 0.0;
+		if (KeyEquals(m_key, "height"))
+		{
+			result = ReadNumber(value);
+			height = value;
+		}
+		else if (KeyEquals(m_key, "code"))
+		{
+			result = ReadNumber(value);
+			code = (int32)value;
+		}
+		else
+		{
+			result = SkipValue();
+		}
+		if (!result)
+		{
+			return false;
+		}
+	}
+	return m_error.IsEmpty();
+}
+
+bool FGeoJsonStreamReader::ReadGeometry(FBuildingLayer& building_data, bool& is_multi_polygon)
+{
+	ANSICHAR token;
+	if (!PeekToken(token))
+	{
+		return false;
+	}
+	if (token != '{')
+	{
+		is_multi_polygon = false;
+		return SkipValue();
+	}
+
+	//typecoordinates֮ǰʱMultiPolygonֱ
+	bool type_known = false;
+	m_buffer_pos++;
+	bool first = true;
+	while (NextElement('}', first))
+	{
+		if (!ReadString(m_key) || !Expect(':'))
+		{
+			return false;
+		}
+		bool result = true;
+		if (KeyEquals(m_key, "type"))
+		{
+			result = ReadString(m_value);
+			is_multi_polygon = KeyEquals(m_value, "MultiPolygon");
+			type_known = true;
+		}
+		else if (KeyEquals(m_key, "coordinates") && (!type_known || is_multi_polygon))
+		{
+			result = ReadMultiPolygon(building_data);
+		}
+		else
+		{
+			result = SkipValue();
+		}
+		if (!result)
+		{
+			return false;
+		}
+	}
+	return m_error.IsEmpty();
+}
+
+bool FGeoJsonStreamReader::ReadMultiPolygon(FBuildingLayer& building_data)
+{
+	if (!Expect('['))
+	{
+		return false;
+	}
+	bool first_polygon = true;
+	while (NextElement(']', first_polygon))
+	{
+		if (!Expect('['))
+		{
+			return false;
+		}
+		//ֻȡ⻷ڻ
+		bool first_ring = true;
+		int32 ring_index = 0;
+		while (NextElement(']', first_ring))
+		{
+			bool result = true;
+			if (ring_index == 0)
+			{
+				m_ring.Reset();
+				result = ReadRing(m_ring);
+				if (result)
+				{
+					building_data.AddSourceBuilding(0, 0.0, m_ring);
+				}
+			}
+			else
+			{
+				result = SkipValue();
+			}
+			ring_index++;
+			if (!result)
+			{
+				return false;
+			}
+		}
+		if (!m_error.IsEmpty())
+		{
+			return false;
+		}
+	}
+	return m_error.IsEmpty();
+}
+
+bool FGeoJsonStreamReader::ReadRing(TArray<double>& lonlat)
+{
+	if (!Expect('['))
+	{
+		return false;
+	}
+	bool first_point = true;
+	while (NextElement(']', first_point))
+	{
+		double x = 0.0;
+		double y = 0.0;
+		if (!Expect('[') || !ReadNumber(x) || !Expect(',') || !ReadNumber(y))
+		{
+			return false;
+		}
+		//̵߳ȶ
+		bool first_component = false;
+		while (NextElement(']', first_component))
+		{
+			if (!SkipValue())
+			{
+				return false;
+			}
+		}
+		if (!m_error.IsEmpty())
+		{
+			return false;
+		}
+		lonlat.Add(x);
+		lonlat.Add(y);
+	}
+	if (!m_error.IsEmpty())
+	{
+		return false;
+	}
+
+	//ֹغϣֹ
+	int32 count = lonlat.Num() / 2;
+	if (count > 1 && FMath::Sqrt(FMath::Square(lonlat[0] - lonlat[2 * count - 2]) + FMath::Square(lonlat[1] - lonlat[2 * count - 1])) < stream_threshold)
+	{
+		lonlat.SetNum(2 * count - 2, false);
+	}
+	return true;
+}
+
+bool FGeoJsonStreamReader::SetError(const TCHAR* message)
+{
+	if (m_error.IsEmpty())
+	{
+		int64 offset = m_file_offset - m_buffer_end + m_buffer_pos;
+		m_error = FString::Printf(TEXT("%s, offset = %lld"), message, offset);
+	}
+	return false;
+}
+
+bool FGeoJsonStreamReader::KeyEquals(const TArray<ANSICHAR>& key, const ANSICHAR* name)
+{
+	int32 len = FCStringAnsi::Strlen(name);
+	return key.Num() == len && FMemory::Memcmp(key.GetData(), name, len) == 0;
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBuildingLayer;
+class IFileHandle;
+
+//ʽGeoJSONȡɨļֱд뽨飬FJsonObject
+class FGeoJsonStreamReader
+{
+public:
+	FGeoJsonStreamReader();
+	~FGeoJsonStreamReader();
+
+	bool Open(const FString& file_name);
+	void Close();
+
+	//ȡFeatureCollectionеȫMultiPolygonҪ
+	bool ReadBuildings(FBuildingLayer& building_data);
+
+	const FString& GetError() const { return m_error; }
+	int64 GetFileSize() const { return m_file_size; }
+
+private:
+	bool FillBuffer();
+	//ȡһǿհַ
+	bool PeekToken(ANSICHAR& c);
+	bool Expect(ANSICHAR c);
+	bool ReadChar(ANSICHAR& c);
+
+	bool ReadString(TArray<ANSICHAR>& str);
+	bool ReadNumber(double& value);
+	bool SkipValue();
+	//ȡһԪأfalseʾ
+	bool NextElement(ANSICHAR close, bool& first);
+
+	bool ReadFeatureCollection(FBuildingLayer& building_data);
+	bool ReadFeature(FBuildingLayer& building_data);
+	bool ReadProperties(double& height, int32& code, bool& has_properties);
+	bool ReadGeometry(FBuildingLayer& building_data, bool& is_multi_polygon);
+	bool ReadMultiPolygon(FBuildingLayer& building_data);
+	//ȡγȽдlonlat˫
+	bool ReadRing(TArray<double>& lonlat);
+
+	bool SetError(const TCHAR* message);
+
+	static bool KeyEquals(const TArray<ANSICHAR>& key, const ANSICHAR* name);
+	static bool ParseNumber(const ANSICHAR* str, int32 len, double& value);
+
+private:
+	IFileHandle* m_file;
+	int64 m_file_size;
+	int64 m_file_offset;
+	TArray<uint8> m_buffer;
+	int32 m_buffer_pos;
+	int32 m_buffer_end;
+
+	TArray<ANSICHAR> m_key;
+	TArray<ANSICHAR> m_value;
+	//ǰ⻷ľγȣдͼ
+	TArray<double> m_ring;
+	FString m_error;
+};
@@ -0,0 +1,544 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "PolygonTriangulator.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+//ֵʱz
+const int32 hash_vertex_threshold = 80;
+
+FPolygonTriangulator::FPolygonTriangulator()
+	: m_reflex_count(0)
+	, m_use_hash(false)
+	, m_min_x(0.0)
+	, m_min_y(0.0)
+	, m_inv_size(0.0)
+{
+}
+
+bool FPolygonTriangulator::Triangulate(TArrayView<const FVector2D> polygon, TArray<int32>& triangles)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BuildingEarClipping);
+	int32 count = polygon.Num();
+	m_nodes.Reset(count + 8);
+	m_reflex_count = 0;
+	if (count < 3)
+	{
+		return false;
+	}
+
+	double area = 0.0;
+	for (int32 i = 0, j = count - 1; i < count; j = i++)
+	{
+		area += ((double)polygon[j].X - polygon[i].X) * ((double)polygon[j].Y + polygon[i].Y);
+	}
+	//area < 0 ʾ˳ʱ룬֤ʼΪʱ
+	int32 last = INDEX_NONE;
+	if (area >= 0.0)
+	{
+		for (int32 i = 0; i < count; i++)
+		{
+			last = AddNode(i, polygon[i].X, polygon[i].Y, last);
+		}
+	}
+	else
+	{
+		for (int32 i = count - 1; i >= 0; i--)
+		{
+			last = AddNode(i, polygon[i].X, polygon[i].Y, last);
+		}
+	}
+	for (int32 i = 0; i < m_nodes.Num(); i++)
+	{
+		UpdateReflex(i);
+	}
+
+	int32 start = FilterPoints(last, INDEX_NONE);
+	if (start == INDEX_NONE || m_nodes[start].next == m_nodes[start].prev)
+	{
+		return false;
+	}
+
+	m_use_hash = count > hash_vertex_threshold;
+	if (m_use_hash)
+	{
+		double max_x = -DBL_MAX;
+		double max_y = -DBL_MAX;
+		m_min_x = DBL_MAX;
+		m_min_y = DBL_MAX;
+		for (const FNode& node : m_nodes)
+		{
+			m_min_x = FMath::Min(m_min_x, node.x);
+			m_min_y = FMath::Min(m_min_y, node.y);
+			max_x = FMath::Max(max_x, node.x);
+			max_y = FMath::Max(max_y, node.y);
+		}
+		double size = FMath::Max(max_x - m_min_x, max_y - m_min_y);
+		m_inv_size = size > 0.0 ? 32767.0 / size : 0.0;
+	}
+
+	triangles.Reserve(triangles.Num() + (count - 2) * 3);
+	EarcutLinked(start, triangles, 0);
+	return true;
+}
+
+int32 FPolygonTriangulator::AddNode(int32 index, double x, double y, int32 last)
+{
+	int32 node = m_nodes.AddUninitialized();
+	FNode& p = m_nodes[node];
+	p.index = index;
+	p.x = x;
+	p.y = y;
+	p.prev_z = INDEX_NONE;
+	p.next_z = INDEX_NONE;
+	p.z = 0;
+	p.reflex = false;
+	if (last == INDEX_NONE)
+	{
+		p.prev = node;
+		p.next = node;
+	}
+	else
+	{
+		p.next = m_nodes[last].next;
+		p.prev = last;
+		m_nodes[m_nodes[last].next].prev = node;
+		m_nodes[last].next = node;
+	}
+	return node;
+}
+
+void FPolygonTriangulator::RemoveNode(int32 node)
+{
+	FNode& p = m_nodes[node];
+	m_nodes[p.next].prev = p.prev;
+	m_nodes[p.prev].next = p.next;
+	if (p.prev_z != INDEX_NONE)
+	{
+		m_nodes[p.prev_z].next_z = p.next_z;
+	}
+	if (p.next_z != INDEX_NONE)
+	{
+		m_nodes[p.next_z].prev_z = p.prev_z;
+	}
+	if (p.reflex)
+	{
+		p.reflex = false;
+		m_reflex_count--;
+	}
+	//ɾֻڶɰ͹
+	UpdateReflex(p.prev);
+	UpdateReflex(p.next);
+}
+
+void FPolygonTriangulator::UpdateReflex(int32 node)
+{
+	const FNode& p = m_nodes[node];
+	bool reflex = Area(p.prev, node, p.next) <= 0.0;
+	if (reflex != p.reflex)
+	{
+		m_nodes[node].reflex = reflex;
+		m_reflex_count += reflex ? 1 : -1;
+	}
+}
+
+void FPolygonTriangulator::AddTriangle(int32 a, int32 b, int32 c, TArray<int32>& triangles) const
+{
+	triangles.Add(m_nodes[a].index);
+	triangles.Add(m_nodes[c].index);
+	triangles.Add(m_nodes[b].index);
+}
+
+void FPolygonTriangulator::EarcutLinked(int32 ear, TArray<int32>& triangles, int32 pass)
+{
+	if (ear == INDEX_NONE)
+	{
+		return;
+	}
+	if (pass == 0 && m_use_hash)
+	{
+		IndexCurve(ear);
+	}
+
+	int32 stop = ear;
+	while (m_nodes[ear].prev != m_nodes[ear].next)
+	{
+		int32 prev = m_nodes[ear].prev;
+		int32 next = m_nodes[ear].next;
+		if (m_use_hash ? IsEarHashed(ear) : IsEar(ear))
+		{
+			AddTriangle(prev, ear, next, triangles);
+			RemoveNode(ear);
+			//һ㣬ϸ
+			ear = m_nodes[next].next;
+			stop = ear;
+			continue;
+		}
+
+		ear = next;
+		if (ear == stop)
+		{
+			//Ҳ䣺ȥߵ㣬޸ֲԽضԽ߲
+			if (pass == 0)
+			{
+				EarcutLinked(FilterPoints(ear, INDEX_NONE), triangles, 1);
+			}
+			else if (pass == 1)
+			{
+				ear = CureLocalIntersections(FilterPoints(ear, INDEX_NONE), triangles);
+				EarcutLinked(ear, triangles, 2);
+			}
+			else
+			{
+				SplitEarcut(ear, triangles);
+			}
+			break;
+		}
+	}
+}
+
+bool FPolygonTriangulator::IsEarBlocker(int32 node, int32 a, int32 b, int32 c) const
+{
+	//ֻаڶ
+	return node != a && node != c && m_nodes[node].reflex && PointInTriangle(a, b, c, node);
+}
+
+bool FPolygonTriangulator::IsEar(int32 ear) const
+{
+	int32 a = m_nodes[ear].prev;
+	int32 c = m_nodes[ear].next;
+	if (Area(a, ear, c) <= 0.0)
+	{
+		return false;
+	}
+	if (m_reflex_count == 0)
+	{
+		return true;
+	}
+
+	for (int32 p = m_nodes[c].next; p != a; p = m_nodes[p].next)
+	{
+		if (IsEarBlocker(p, a, ear, c))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FPolygonTriangulator::IsEarHashed(int32 ear) const
+{
+	int32 a = m_nodes[ear].prev;
+	int32 c = m_nodes[ear].next;
+	if (Area(a, ear, c) <= 0.0)
+	{
+		return false;
+	}
+	if (m_reflex_count == 0)
+	{
+		return true;
+	}
+
+	const FNode& na = m_nodes[a];
+	const FNode& nb = m_nodes[ear];
+	const FNode& nc = m_nodes[c];
+	uint32 min_z = ZOrder(FMath::Min3(na.x, nb.x, nc.x), FMath::Min3(na.y, nb.y, nc.y));
+	uint32 max_z = ZOrder(FMath::Max3(na.x, nb.x, nc.x), FMath::Max3(na.y, nb.y, nc.y));
+
+	//zͬʱҰΧڵĵ
+	int32 p = nb.prev_z;
+	int32 n = nb.next_z;
+	while (p != INDEX_NONE && m_nodes[p].z >= min_z && n != INDEX_NONE && m_nodes[n].z <= max_z)
+	{
+		if (IsEarBlocker(p, a, ear, c) || IsEarBlocker(n, a, ear, c))
+		{
+			return false;
+		}
+		p = m_nodes[p].prev_z;
+		n = m_nodes[n].next_z;
+	}
+	for (; p != INDEX_NONE && m_nodes[p].z >= min_z; p = m_nodes[p].prev_z)
+	{
+		if (IsEarBlocker(p, a, ear, c))
+		{
+			return false;
+		}
+	}
+	for (; n != INDEX_NONE && m_nodes[n].z <= max_z; n = m_nodes[n].next_z)
+	{
+		if (IsEarBlocker(n, a, ear, c))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int32 FPolygonTriangulator::FilterPoints(int32 start, int32 end)
+{
+	if (start == INDEX_NONE)
+	{
+		return start;
+	}
+	if (end == INDEX_NONE)
+	{
+		end = start;
+	}
+
+	//ȥغϵ빲ߵ
+	int32 p = start;
+	bool again = false;
+	do
+	{
+		again = false;
+		const FNode& node = m_nodes[p];
+		if (Equals(p, node.next) || Area(node.prev, p, node.next) == 0.0)
+		{
+			int32 prev = node.prev;
+			RemoveNode(p);
+			p = end = prev;
+			if (p == m_nodes[p].next)
+			{
+				break;
+			}
+			again = true;
+		}
+		else
+		{
+			p = node.next;
+		}
+	} while (again || p != end);
+	return end;
+}
+
+int32 FPolygonTriangulator::CureLocalIntersections(int32 start, TArray<int32>& triangles)
+{
+	if (start == INDEX_NONE)
+	{
+		return start;
+	}
+	int32 p = start;
+	do
+	{
+		int32 a = m_nodes[p].prev;
+		int32 b = m_nodes[m_nodes[p].next].next;
+		if (!Equals(a, b) && Intersects(a, p, m_nodes[p].next, b) && LocallyInside(a, b) && LocallyInside(b, a))
+		{
+			AddTriangle(a, p, b, triangles);
+			int32 next = m_nodes[p].next;
+			RemoveNode(p);
+			RemoveNode(next);
+			p = start = b;
+		}
+		p = m_nodes[p].next;
+	} while (p != start);
+	return FilterPoints(p, INDEX_NONE);
+}
+
+void FPolygonTriangulator::SplitEarcut(int32 start, TArray<int32>& triangles)
+{
+	int32 a = start;
+	do
+	{
+		int32 b = m_nodes[m_nodes[a].next].next;
+		while (b != m_nodes[a].prev)
+		{
+			if (m_nodes[a].index != m_nodes[b].index && IsValidDiagonal(a, b))
+			{
+				int32 c = SplitPolygon(a, b);
+				a = FilterPoints(a, m_nodes[a].next);
+				c = FilterPoints(c, m_nodes[c].next);
+				EarcutLinked(a, triangles, 0);
+				EarcutLinked(c, triangles, 0);
+				return;
+			}
+			b = m_nodes[b].next;
+		}
+		a = m_nodes[a].next;
+	} while (a != start);
+}
+
+int32 FPolygonTriangulator::SplitPolygon(int32 a, int32 b)
+{
+	//ab㣬ѻضԽab
+	int32 a2 = AddNode(m_nodes[a].index, m_nodes[a].x, m_nodes[a].y, INDEX_NONE);
+	int32 b2 = AddNode(m_nodes[b].index, m_nodes[b].x, m_nodes[b].y, INDEX_NONE);
+	int32 an = m_nodes[a].next;
+	int32 bp = m_nodes[b].prev;
+
+	m_nodes[a].next = b;
+	m_nodes[b].prev = a;
+	m_nodes[a2].next = an;
+	m_nodes[an].prev = a2;
+	m_nodes[b2].next = a2;
+	m_nodes[a2].prev = b2;
+	m_nodes[bp].next = b2;
+	m_nodes[b2].prev = bp;
+
+	UpdateReflex(a);
+	UpdateReflex(b);
+	UpdateReflex(a2);
+	UpdateReflex(b2);
+	return b2;
+}
+
+void FPolygonTriangulator::IndexCurve(int32 start)
+{
+	m_sort_buffer.Reset();
+	int32 p = start;
+	do
+	{
+		FNode& node = m_nodes[p];
+		node.z = ZOrder(node.x, node.y);
+		m_sort_buffer.Add(p);
+		p = node.next;
+	} while (p != start);
+
+	const TBuildingScratchArray<FNode>& nodes = m_nodes;
+	m_sort_buffer.Sort([&nodes](int32 l, int32 r) { return nodes[l].z < nodes[r].z; });
+	for (int32 i = 0; i < m_sort_buffer.Num(); i++)
+	{
+		FNode& node = m_nodes[m_sort_buffer[i]];
+		node.prev_z = i > 0 ? m_sort_buffer[i - 1] : INDEX_NONE;
+		node.next_z = i + 1 < m_sort_buffer.Num() ? m_sort_buffer[i + 1] : INDEX_NONE;
+	}
+}
+
+uint32 FPolygonTriangulator::ZOrder(double x, double y) const
+{
+	uint32 ix = (uint32)((x - m_min_x) * m_inv_size);
+	uint32 iy = (uint32)((y - m_min_y) * m_inv_size);
+
+	ix = (ix | (ix << 8)) & 0x00FF00FF;
+	ix = (ix | (ix << 4)) & 0x0F0F0F0F;
+	ix = (ix | (ix << 2)) & 0x33333333;
+	ix = (ix | (ix << 1)) & 0x55555555;
+
+	iy = (iy | (iy << 8)) & 0x00FF00FF;
+	iy = (iy | (iy << 4)) & 0x0F0F0F0F;
+	iy = (iy | (iy << 2)) & 0x33333333;
+	iy = (iy | (iy << 1)) & 0x55555555;
+
+	return ix | (iy << 1);
+}
+
+double FPolygonTriangulator::Area(int32 p, int32 q, int32 r) const
+{
+	//0ʾp->q->rתʱ뻷ϵ͹㣩
+	const FNode& np = m_nodes[p];
+	const FNode& nq = m_nodes[q];
+	const FNode& nr = m_nodes[r];
+	return (nq.x - np.x) * (nr.y - nq.y) - (nq.y - np.y) * (nr.x - nq.x);
+}
+
+bool FPolygonTriangulator::Equals(int32 p, int32 q) const
+{
+	return m_nodes[p].x == m_nodes[q].x && m_nodes[p].y == m_nodes[q].y;
+}
+
+bool FPolygonTriangulator::PointInTriangle(int32 a, int32 b, int32 c, int32 p) const
+{
+	return Area(a, b, p) >= 0.0 && Area(b, c, p) >= 0.0 && Area(c, a, p) >= 0.0;
+}
+
+bool FPolygonTriangulator::Intersects(int32 p1, int32 q1, int32 p2, int32 q2) const
+{
+	int32 o1 = (int32)FMath::Sign(Area(p1, q1, p2));
+	int32 o2 = (int32)FMath::Sign(Area(p1, q1, q2));
+	int32 o3 = (int32)FMath::Sign(Area(p2, q2, p1));
+	int32 o4 = (int32)FMath::Sign(Area(p2, q2, q1));
+
+	if (o1 != o2 && o3 != o4)
+	{
+		return true;
+	}
+	//ʱжǷص
+	if (o1 == 0 && OnSegment(p1, p2, q1))
+	{
+		return true;
+	}
+	if (o2 == 0 && OnSegment(p1, q2, q1))
+	{
+		return true;
+	}
+	if (o3 == 0 && OnSegment(p2, p1, q2))
+	{
+		return true;
+	}
+	if (o4 == 0 && OnSegment(p2, q1, q2))
+	{
+		return true;
+	}
+	return false;
+}
+
+bool FPolygonTriangulator::OnSegment(int32 p, int32 q, int32 r) const
+{
+	const FNode& np = m_nodes[p];
+	const FNode& nq = m_nodes[q];
+	const FNode& nr = m_nodes[r];
+	return nq.x <= FMath::Max(np.x, nr.x) && nq.x >= FMath::Min(np.x, nr.x)
+		&& nq.y <= FMath::Max(np.y, nr.y) && nq.y >= FMath::Min(np.y, nr.y);
+}
+
+bool FPolygonTriangulator::IntersectsPolygon(int32 a, int32 b) const
+{
+	int32 p = a;
+	do
+	{
+		int32 next = m_nodes[p].next;
+		if (m_nodes[p].index != m_nodes[a].index && m_nodes[next].index != m_nodes[a].index
+			&& m_nodes[p].index != m_nodes[b].index && m_nodes[next].index != m_nodes[b].index
+			&& Intersects(p, next, a, b))
+		{
+			return true;
+		}
+		p = next;
+	} while (p != a);
+	return false;
+}
+
+bool FPolygonTriangulator::LocallyInside(int32 a, int32 b) const
+{
+	const FNode& na = m_nodes[a];
+	if (Area(na.prev, a, na.next) > 0.0)
+	{
+		return Area(a, b, na.next) <= 0.0 && Area(a, na.prev, b) <= 0.0;
+	}
+	return Area(a, b, na.prev) > 0.0 || Area(a, na.next, b) > 0.0;
+}
+
+bool FPolygonTriangulator::MiddleInside(int32 a, int32 b) const
+{
+	double px = (m_nodes[a].x + m_nodes[b].x) / 2.0;
+	double py = (m_nodes[a].y + m_nodes[b].y) / 2.0;
+	bool inside = false;
+	int32 p = a;
+	do
+	{
+		const FNode& node = m_nodes[p];
+		const FNode& next = m_nodes[node.next];
+		if (((node.y > py) != (next.y > py)) && next.y != node.y
+			&& (px < (next.x - node.x) * (py - node.y) / (next.y - node.y) + node.x))
+		{
+			inside = !inside;
+		}
+		p = node.next;
+	} while (p != a);
+	return inside;
+}
+
+bool FPolygonTriangulator::IsValidDiagonal(int32 a, int32 b) const
+{
+	const FNode& na = m_nodes[a];
+	const FNode& nb = m_nodes[b];
+	if (m_nodes[na.next].index == nb.index || m_nodes[na.prev].index == nb.index || IntersectsPolygon(a, b))
+	{
+		return false;
+	}
+	if (LocallyInside(a, b) && LocallyInside(b, a) && MiddleInside(a, b)
+		&& (Area(na.prev, a, nb.prev) != 0.0 || Area(a, nb.prev, b) != 0.0))
+	{
+		return true;
+	}
+	//غ϶㴦
+	return Equals(a, b) && Area(na.prev, a, na.next) < 0.0 && Area(nb.prev, b, nb.next) < 0.0;
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BuildingScratch.h"
+
+//зǻ˫ζ㣬ά㣬϶ʱzٶ
+//ڵ߳ݴ䣬FBuildingScratchMarkڴʹ
+class FPolygonTriangulator
+{
+public:
+	FPolygonTriangulator();
+
+	//polygonΪظ׵Ļ˳ʱɣpolygonеĶţÿΪһΣ
+	//ζ˳divideConvexPolygonһ£ʱ뻷(0, i + 2, i + 1)
+	bool Triangulate(TArrayView<const FVector2D> polygon, TArray<int32>& triangles);
+
+private:
+	struct FNode
+	{
+		int32 index;
+		double x;
+		double y;
+		int32 prev;
+		int32 next;
+		int32 prev_z;
+		int32 next_z;
+		uint32 z;
+		bool reflex;
+	};
+
+	int32 AddNode(int32 index, double x, double y, int32 last);
+	void RemoveNode(int32 node);
+	void UpdateReflex(int32 node);
+	void AddTriangle(int32 a, int32 b, int32 c, TArray<int32>& triangles) const;
+
+	void EarcutLinked(int32 ear, TArray<int32>& triangles, int32 pass);
+	bool IsEar(int32 ear) const;
+	bool IsEarHashed(int32 ear) const;
+	bool IsEarBlocker(int32 node, int32 a, int32 b, int32 c) const;
+	int32 FilterPoints(int32 start, int32 end);
+	int32 CureLocalIntersections(int32 start, TArray<int32>& triangles);
+	void SplitEarcut(int32 start, TArray<int32>& triangles);
+	int32 SplitPolygon(int32 a, int32 b);
+
+	void IndexCurve(int32 start);
+	uint32 ZOrder(double x, double y) const;
+
+	double Area(int32 p, int32 q, int32 r) const;
+	bool Equals(int32 p, int32 q) const;
+	bool PointInTriangle(int32 a, int32 b, int32 c, int32 p) const;
+	bool Intersects(int32 p1, int32 q1, int32 p2, int32 q2) const;
+	bool OnSegment(int32 p, int32 q, int32 r) const;
+	bool IntersectsPolygon(int32 a, int32 b) const;
+	bool LocallyInside(int32 a, int32 b) const;
+	bool MiddleInside(int32 a, int32 b) const;
+	bool IsValidDiagonal(int32 a, int32 b) const;
+
+private:
+	TBuildingScratchArray<FNode> m_nodes;
+	TBuildingScratchArray<int32> m_sort_buffer;
+	int32 m_reflex_count;
+	bool m_use_hash;
+	double m_min_x;
+	double m_min_y;
+	double m_inv_size;
+};
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "Misc/AutomationTest.h"
+#include "BuildingGeometry.h"
+#include "BuildingLayer.h"
+#include "BuildingMeshChunks.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBuildingPointInPolygonTest, "BuildingBuilder.Core.Geometry.PointInPolygon",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBuildingPointInPolygonTest::RunTest(const FString& Parameters)
+{
+	const FVector2D square[] = { FVector2D(0, 0), FVector2D(10, 0), FVector2D(10, 10), FVector2D(0, 10) };
+	TestTrue(TEXT("square center"), PointInPolygon(square, FVector2D(5, 5)));
+	//߲καߵⲿ㣬ԭʵֻΪ
+	TestFalse(TEXT("left of square"), PointInPolygon(square, FVector2D(-5, 5)));
+	TestFalse(TEXT("right of square"), PointInPolygon(square, FVector2D(15, 5)));
+	TestFalse(TEXT("above square"), PointInPolygon(square, FVector2D(5, 15)));
+	TestFalse(TEXT("below square"), PointInPolygon(square, FVector2D(5, -5)));
+
+	//߾εĶ㣬ֻһ
+	const FVector2D diamond[] = { FVector2D(5, 0), FVector2D(10, 5), FVector2D(5, 10), FVector2D(0, 5) };
+	TestTrue(TEXT("diamond, ray through top vertex"), PointInPolygon(diamond, FVector2D(5, 2)));
+	TestFalse(TEXT("diamond, ray through both vertices"), PointInPolygon(diamond, FVector2D(5, -2)));
+	TestFalse(TEXT("diamond corner region"), PointInPolygon(diamond, FVector2D(1, 1)));
+
+	//UΰΣȱڵĵⲿ
+	const FVector2D notch[] = { FVector2D(0, 0), FVector2D(30, 0), FVector2D(30, 30), FVector2D(20, 30),
+		FVector2D(20, 10), FVector2D(10, 10), FVector2D(10, 30), FVector2D(0, 30) };
+	TestTrue(TEXT("U arm"), PointInPolygon(notch, FVector2D(5, 20)));
+	TestTrue(TEXT("U base"), PointInPolygon(notch, FVector2D(15, 5)));
+	TestFalse(TEXT("U notch"), PointInPolygon(notch, FVector2D(15, 20)));
+
+	TestEqual(TEXT("distance inside"), PointPolygonDistanceSquared(square, FVector2D(5, 5)), 0.0);
+	TestEqual(TEXT("distance outside"), PointPolygonDistanceSquared(square, FVector2D(13, 14)), 25.0, 1e-6);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBuildingSegmentCrossTest, "BuildingBuilder.Core.Geometry.IsSegmentCross",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBuildingSegmentCrossTest::RunTest(const FString& Parameters)
+{
+	TestTrue(TEXT("crossing diagonals"), IsSegmentCross(FVector2D(0, 0), FVector2D(2, 2), FVector2D(0, 2), FVector2D(2, 0)));
+	TestTrue(TEXT("touching end point"), IsSegmentCross(FVector2D(0, 0), FVector2D(2, 0), FVector2D(2, 0), FVector2D(2, 2)));
+	//ԭʵֵڶΪ0ֲཻΪཻ
+	TestFalse(TEXT("parallel segments"), IsSegmentCross(FVector2D(0, 0), FVector2D(1, 0), FVector2D(0, 1), FVector2D(1, 1)));
+	TestFalse(TEXT("segment beyond end"), IsSegmentCross(FVector2D(0, 0), FVector2D(1, 0), FVector2D(2, -1), FVector2D(2, 1)));
+	TestFalse(TEXT("separate segments"), IsSegmentCross(FVector2D(0, 0), FVector2D(1, 1), FVector2D(3, 0), FVector2D(2, 1)));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBuildingConvexPolygonTest, "BuildingBuilder.Core.Geometry.IsConvexPolygon",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBuildingConvexPolygonTest::RunTest(const FString& Parameters)
+{
+	const FVector2D square[] = { FVector2D(0, 0), FVector2D(10, 0), FVector2D(10, 10), FVector2D(0, 10) };
+	TestTrue(TEXT("square"), IsConvexPolygon(square));
+	const FVector2D notch[] = { FVector2D(0, 0), FVector2D(30, 0), FVector2D(30, 30), FVector2D(20, 30),
+		FVector2D(20, 10), FVector2D(10, 10), FVector2D(10, 30), FVector2D(0, 30) };
+	TestFalse(TEXT("U shape"), IsConvexPolygon(notch));
+	const FVector2D line[] = { FVector2D(0, 0), FVector2D(1, 0), FVector2D(2, 0) };
+	TestFalse(TEXT("collinear ring"), IsConvexPolygon(line));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBuildingRoofMeshTest, "BuildingBuilder.Core.Geometry.RoofMesh",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBuildingRoofMeshTest::RunTest(const FString& Parameters)
+{
+	//2Ļ빲߻δ޷ǻ׶β룬д׶Ҳд
+	const FVector2D square[] = { FVector2D(0, 0), FVector2D(10, 0), FVector2D(10, 10), FVector2D(0, 10) };
+	const FVector2D segment[] = { FVector2D(20, 0), FVector2D(30, 0) };
+	const FVector2D line[] = { FVector2D(40, 0), FVector2D(50, 0), FVector2D(60, 0), FVector2D(45, 0) };
+	const FVector2D notch[] = { FVector2D(0, 20), FVector2D(30, 20), FVector2D(30, 50), FVector2D(20, 50),
+		FVector2D(20, 30), FVector2D(10, 30), FVector2D(10, 50), FVector2D(0, 50) };
+	FBuildingLayer buildings;
+	buildings.AddBuilding(1, 10.0, segment);
+	buildings.AddBuilding(2, 10.0, square);
+	buildings.AddBuilding(3, 10.0, line);
+	buildings.AddBuilding(4, 10.0, notch);
+	TArray<FBuildingChunk> chunks;
+	MakeBuildingChunks(0, buildings, chunks);
+
+	FPMCMeshChunk roof;
+	TArray<FRoofChunkTriangles> chunk_triangles;
+	double count_time = 0.0;
+	FMeshSize size = MakeRoofMesh_PMC(chunks, nullptr, chunk_triangles, roof, count_time);
+	TestEqual(TEXT("roof vertices"), size.vertices, 4 + 8);
+	TestEqual(TEXT("roof indices"), size.indices, 3 * (2 + 6));
+	TestEqual(TEXT("allocated vertices"), roof.Vertices.Num(), size.vertices);
+	//дλεĶ֮
+	TestTrue(TEXT("concave vertices follow the square"), roof.Vertices.Num() == 12 && roof.Vertices[4] == FVector(0, 20, 10));
+	bool indices_valid = true;
+	for (int32 index : roof.Index)
+	{
+		indices_valid &= index >= 0 && index < roof.Vertices.Num();
+	}
+	TestTrue(TEXT("roof index range"), indices_valid);
+
+	//յǻƶдλãҲ
+	FMeshSize cursor;
+	FPMCMeshChunk empty_mesh;
+	DivideConcavePolygon_PMC(line, TArrayView<const int32>(), 10.0, empty_mesh, cursor);
+	FRawMeshView empty_view;
+	DivideConcavePolygon_RawMesh(segment, TArrayView<const int32>(), 10.0, empty_view, cursor);
+	TestTrue(TEXT("cursor unchanged"), cursor.vertices == 0 && cursor.indices == 0 && cursor.faces == 0);
+	return true;
+}
+
+#endif
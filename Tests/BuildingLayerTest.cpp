@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "Misc/AutomationTest.h"
+#include "BuildingLayer.h"
+#include "BuildingLayerCache.h"
+#include "BuildingProjection.h"
+#include "BuildingGeometry.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//γȽ
+static void MakeSourceLayer(FBuildingLayer& buildings)
+{
+	const double first[] = { 116.3974123456789, 39.9087654321, 116.3975, 39.9087654321, 116.3975, 39.9088 };
+	const double second[] = { 116.4, 39.9, 116.401, 39.9, 116.401, 39.901, 116.4, 39.901 };
+	buildings.AddSourceBuilding(3, 12.5, first);
+	buildings.AddSourceBuilding(4, 30.0, second);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBuildingLayerTest, "BuildingBuilder.Core.BuildingLayer",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBuildingLayerTest::RunTest(const FString& Parameters)
+{
+	FBuildingLayer buildings;
+	const FVector2D square[] = { FVector2D(0, 0), FVector2D(10, 0), FVector2D(10, 20), FVector2D(0, 20) };
+	const FVector2D triangle[] = { FVector2D(-5, -5), FVector2D(5, -5), FVector2D(0, 5) };
+	TestEqual(TEXT("first index"), buildings.AddBuilding(1, 10.0, square), 0);
+	TestEqual(TEXT("second index"), buildings.AddBuilding(2, 20.0, triangle), 1);
+	TestEqual(TEXT("coord count"), buildings.NumCoords(), 7);
+	TestEqual(TEXT("ring size"), buildings.GetRingSize(1), 3);
+	TestTrue(TEXT("ring offset"), buildings.GetRing(1)[0] == FVector2D(-5, -5));
+	TestTrue(TEXT("bounds"), buildings.GetBounds(0).Min == FVector2D(0, 0) && buildings.GetBounds(0).Max == FVector2D(10, 20));
+	TestFalse(TEXT("no source coords"), buildings.HasSourceCoords());
+
+	FBuildingLayer other;
+	other.AddBuilding(5, 5.0, triangle);
+	buildings.Append(other);
+	TestEqual(TEXT("appended count"), buildings.Num(), 3);
+	TestEqual(TEXT("appended code"), buildings[2].code, 5);
+	TestEqual(TEXT("appended ring"), buildings[2].coords.Num(), 3);
+
+	buildings.Truncate(1);
+	TestEqual(TEXT("truncated count"), buildings.Num(), 1);
+	TestEqual(TEXT("truncated coords"), buildings.NumCoords(), 4);
+
+	FBuildingLayer source;
+	MakeSourceLayer(source);
+	TestTrue(TEXT("source coords"), source.HasSourceCoords());
+	TestEqual(TEXT("source coord count"), source.GetSourceCoords().Num(), source.NumCoords() * 2);
+	source.Truncate(1);
+	TestEqual(TEXT("truncated source coords"), source.GetSourceCoords().Num(), 6);
+
+	const int32 codes[] = { 7, 8 };
+	const double heights[] = { 1.0, 2.0 };
+	const uint64 offsets[] = { 0, 5, 4 };
+	const double lonlat[] = { 0, 0, 1, 0, 1, 1, 0, 1 };
+	FBuildingLayer data;
+	TestFalse(TEXT("decreasing offsets"), data.SetData(codes, heights, offsets, lonlat));
+	const uint64 valid_offsets[] = { 0, 3, 4 };
+	TestTrue(TEXT("set data"), data.SetData(codes, heights, valid_offsets, lonlat));
+	TestEqual(TEXT("set data ring"), data.GetRingSize(1), 1);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBuildingProjectionTest, "BuildingBuilder.Core.BuildingProjection",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBuildingProjectionTest::RunTest(const FString& Parameters)
+{
+	double north = 0.0, east = 0.0;
+	LonLatToMercator(0.0, 0.0, north, east);
+	TestEqual(TEXT("origin north"), north, 0.0, 1e-9);
+	TestEqual(TEXT("origin east"), east, 0.0, 1e-9);
+	LonLatToMercator(180.0, 85.0511287798, north, east);
+	TestEqual(TEXT("max east"), east, PI * earth_radius, 1e-6);
+	TestEqual(TEXT("max north"), north, PI * earth_radius, 1e-2);
+
+	//ȵβ㴦
+	const double lon[] = { 116.39, 116.40, 116.41, 116.42, 116.43, -73.98, 151.2 };
+	const double lat[] = { 39.90, 39.91, 39.92, 39.93, 39.94, 40.75, -33.86 };
+	const int32 count = UE_ARRAY_COUNT(lon);
+	double ref_north = 0.0, ref_east = 0.0;
+	LonLatToMercator(116.39, 39.90, ref_north, ref_east);
+	double north_simd[count], east_simd[count], north_scalar[count], east_scalar[count];
+	ProjectMercator(lon, lat, count, ref_north, ref_east, north_simd, east_simd);
+	ProjectMercatorScalar(lon, lat, count, ref_north, ref_east, north_scalar, east_scalar);
+	for (int32 i = 0; i < count; i++)
+	{
+		TestEqual(*FString::Printf(TEXT("%s north %d"), GetMercatorKernelName(), i), north_simd[i], north_scalar[i], 1e-6);
+		TestEqual(*FString::Printf(TEXT("%s east %d"), GetMercatorKernelName(), i), east_simd[i], east_scalar[i], 1e-6);
+	}
+
+	//ͼ˫ȾγͶӰͶӰͷԴꣻԲοڵԶС1
+	FBuildingLayer buildings;
+	MakeSourceLayer(buildings);
+	ProjectBuildingLayer(buildings, ref_north, ref_east);
+	TestFalse(TEXT("source coords released"), buildings.HasSourceCoords());
+	LonLatToMercator(116.3974123456789, 39.9087654321, north, east);
+	TestEqual(TEXT("projected north"), (double)buildings.GetRing(0)[0].X, north - ref_north, 1e-3);
+	TestEqual(TEXT("projected east"), (double)buildings.GetRing(0)[0].Y, east - ref_east, 1e-3);
+	TestTrue(TEXT("projected bounds"), buildings.GetBounds(1).IsInsideOrOn(buildings.GetRing(1)[2]));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBuildingLayerCacheTest, "BuildingBuilder.Core.BuildingLayerCache",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBuildingLayerCacheTest::RunTest(const FString& Parameters)
+{
+	FString cache_file = FPaths::AutomationTransientDir() / TEXT("BuildingLayerCacheTest.bin");
+	const FBuildingCacheKey key{ 1234, 5678, 0x9abc };
+	FBuildingLayer buildings;
+	MakeSourceLayer(buildings);
+	if (!TestTrue(TEXT("save"), FBuildingLayerCache::Save(cache_file, key, buildings)))
+	{
+		return false;
+	}
+
+	FBuildingLayer loaded;
+	if (TestTrue(TEXT("load"), FBuildingLayerCache::Load(cache_file, key, loaded)))
+	{
+		TestEqual(TEXT("building count"), loaded.Num(), buildings.Num());
+		TestEqual(TEXT("coord count"), loaded.NumCoords(), buildings.NumCoords());
+		TestEqual(TEXT("code"), loaded.GetCode(1), 4);
+		TestEqual(TEXT("height"), loaded.GetHeight(0), 12.5);
+		TestEqual(TEXT("ring size"), loaded.GetRingSize(1), 4);
+		//γȰ˫λԭ
+		TestTrue(TEXT("source coords"), loaded.GetSourceCoords().Num() == buildings.GetSourceCoords().Num()
+			&& FMemory::Memcmp(loaded.GetSourceCoords().GetData(), buildings.GetSourceCoords().GetData(), buildings.GetSourceCoords().Num() * sizeof(double)) == 0);
+
+		//ӳľγ׷ʱضֻС÷Χ
+		FBuildingLayer appended;
+		appended.Append(loaded);
+		TestEqual(TEXT("appended source coords"), appended.GetSourceCoords().Num(), loaded.GetSourceCoords().Num());
+		loaded.Truncate(1);
+		TestEqual(TEXT("truncated source coords"), loaded.GetSourceCoords().Num(), 6);
+		loaded.AddSourceBuilding(5, 1.0, TArrayView<const double>(appended.GetSourceCoords().GetData() + 6, 8));
+		TestTrue(TEXT("detached source coords"), loaded.GetSourceCoords().Num() == 14 && loaded.GetSourceCoords()[6] == 116.4);
+	}
+	//ͷӳɾ滻ļ
+	loaded.ReleaseSourceCoords();
+
+	FBuildingCacheKey stale_key = key;
+	stale_key.source_time++;
+	FBuildingLayer stale;
+	TestFalse(TEXT("stale key"), FBuildingLayerCache::Load(cache_file, stale_key, stale));
+
+	//ͶӰͼûоγȣд뻺
+	ProjectBuildingLayer(buildings, 0.0, 0.0);
+	TestFalse(TEXT("save projected layer"), FBuildingLayerCache::Save(cache_file, key, buildings));
+
+	IFileManager::Get().Delete(*cache_file);
+	return true;
+}
+
+#endif
@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "Misc/AutomationTest.h"
+#include "BuildingSpatialIndex.h"
+#include "BuildingLayer.h"
+#include "BuildingGeometry.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//grid_size * grid_size߳10Σ20ƫoffset㹻ĽʹRжڵ
+static void MakeGridLayer(int32 grid_size, const FVector2D& offset, FBuildingLayer& buildings)
+{
+	for (int32 y = 0; y < grid_size; y++)
+	{
+		for (int32 x = 0; x < grid_size; x++)
+		{
+			FVector2D min = offset + FVector2D(x * 20.0f, y * 20.0f);
+			const FVector2D square[] = { min, min + FVector2D(10, 0), min + FVector2D(10, 10), min + FVector2D(0, 10) };
+			buildings.AddBuilding(y * grid_size + x, 10.0, square);
+		}
+	}
+}
+
+//ͼ򣬱жϵĽȽ
+static TArray<TPair<int32, int32>> GetSortedHits(const TArray<FBuildingHit>& hits)
+{
+	TArray<TPair<int32, int32>> sorted;
+	for (const FBuildingHit& hit : hits)
+	{
+		sorted.Emplace(hit.layer_id, hit.index);
+	}
+	sorted.Sort();
+	return sorted;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBuildingSpatialIndexTest, "BuildingBuilder.Core.BuildingSpatialIndex",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBuildingSpatialIndexTest::RunTest(const FString& Parameters)
+{
+	TMap<int32, FBuildingLayer> layer_data;
+	MakeGridLayer(30, FVector2D(0, 0), layer_data.Add(1));
+	MakeGridLayer(10, FVector2D(5, 5), layer_data.Add(2));
+	//3Ľ
+	const FVector2D segment[] = { FVector2D(0, 0), FVector2D(1000, 1000) };
+	layer_data[2].AddBuilding(-1, 10.0, segment);
+
+	FBuildingSpatialIndex index;
+	index.Build(layer_data);
+	TestEqual(TEXT("item count"), index.Num(), 30 * 30 + 10 * 10);
+
+	FBuildingHit hit;
+	if (TestTrue(TEXT("pick"), index.PickPoint(FVector2D(20 * 7 + 5, 20 * 25 + 5), hit)))
+	{
+		TestEqual(TEXT("pick layer"), hit.layer_id, 1);
+		TestEqual(TEXT("pick index"), hit.index, 25 * 30 + 7);
+	}
+	TestFalse(TEXT("pick gap"), index.PickPoint(FVector2D(20 * 7 + 15, 20 * 25 + 15), hit));
+	TestFalse(TEXT("pick outside"), index.PickPoint(FVector2D(-100, -100), hit));
+
+	//ľȷжϱȽ
+	const FBox2D box(FVector2D(95, 33), FVector2D(247, 161));
+	const FVector2D center(301, 177);
+	const double radius = 57.0;
+	TArray<FBuildingHit> expected_box, expected_radius;
+	for (auto it_layer_data = layer_data.begin(); it_layer_data != layer_data.end(); ++it_layer_data)
+	{
+		const FBuildingLayer& buildings = it_layer_data->Value;
+		for (int32 i = 0; i < buildings.Num(); i++)
+		{
+			if (buildings.GetRingSize(i) < 3)
+			{
+				continue;
+			}
+			if (PolygonIntersectBox(buildings.GetRing(i), box))
+			{
+				expected_box.Add(FBuildingHit{ it_layer_data->Key, i, 0.0 });
+			}
+			if (PointPolygonDistanceSquared(buildings.GetRing(i), center) <= radius * radius)
+			{
+				expected_radius.Add(FBuildingHit{ it_layer_data->Key, i, 0.0 });
+			}
+		}
+	}
+	TArray<FBuildingHit> hits;
+	index.QueryBox(box, hits);
+	TestTrue(TEXT("box query"), expected_box.Num() > 0 && GetSortedHits(hits) == GetSortedHits(expected_box));
+	index.QueryRadius(center, radius, hits);
+	TestTrue(TEXT("radius query"), expected_radius.Num() > 0 && GetSortedHits(hits) == GetSortedHits(expected_radius));
+
+	//ĽӽԶ뾶ѯľһ
+	index.QueryNearest(center, 8, hits);
+	if (TestEqual(TEXT("nearest count"), hits.Num(), 8))
+	{
+		for (int32 i = 1; i < hits.Num(); i++)
+		{
+			TestTrue(TEXT("nearest order"), hits[i - 1].distance <= hits[i].distance);
+		}
+		const FBuildingLayer& buildings = layer_data[hits[0].layer_id];
+		TestEqual(TEXT("nearest distance"), hits[0].distance, FMath::Sqrt(PointPolygonDistanceSquared(buildings.GetRing(hits[0].index), center)), 1e-6);
+	}
+
+	index.Empty();
+	TestFalse(TEXT("empty index"), index.PickPoint(FVector2D(5, 5), hit));
+	return true;
+}
+
+#endif
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "Misc/AutomationTest.h"
+#include "GeoJsonStreamReader.h"
+#include "BuildingLayer.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//дʱļȡȡɾļ
+static bool ReadGeoJsonText(const FString& text, FBuildingLayer& building_data, FString& error)
+{
+	FString file_name = FPaths::AutomationTransientDir() / TEXT("BuildingGeoJsonTest.geojson");
+	if (!FFileHelper::SaveStringToFile(text, *file_name, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		error = TEXT("write test file failed");
+		return false;
+	}
+	bool result = false;
+	{
+		FGeoJsonStreamReader reader;
+		result = reader.Open(file_name) && reader.ReadBuildings(building_data);
+		error = reader.GetError();
+	}
+	IFileManager::Get().Delete(*file_name);
+	return result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGeoJsonStreamReaderTest, "BuildingBuilder.Core.GeoJsonStreamReader",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FGeoJsonStreamReaderTest::RunTest(const FString& Parameters)
+{
+	//һҪصgeometryproperties֮ǰһڻڶҪزMultiPolygon
+	const FString text = TEXT(R"({
+		"type": "FeatureCollection",
+		"name": "buildings",
+		"features": [
+			{
+				"type": "Feature",
+				"geometry": { "type": "MultiPolygon", "coordinates": [
+					[ [ [116.3974123456789, 39.9087654321], [116.3975, 39.9087654321, 12.0], [116.3975, 39.9088], [116.3974123456789, 39.9087654321] ],
+					  [ [116.39742, 39.90877], [116.39743, 39.90877], [116.39743, 39.90878] ] ],
+					[ [ [116.4, 39.9], [116.401, 39.9], [116.401, 39.901], [116.4, 39.901] ] ]
+				] },
+				"properties": { "name": "a \"quoted\" name", "height": 12.5, "code": 3 }
+			},
+			{
+				"type": "Feature",
+				"properties": { "height": 8, "code": 4 },
+				"geometry": { "type": "Polygon", "coordinates": [ [ [0, 0], [1, 0], [1, 1] ] ] }
+			},
+			{
+				"type": "Feature",
+				"properties": { "height": 9007199254740993, "code": 5 },
+				"geometry": { "coordinates": [ [ [ [-0.5, -0.25], [116.39741234567891234, 39.9087654321e0], [0.5, 2.5e-1] ] ] ], "type": "MultiPolygon" }
+			}
+		]
+	})");
+
+	FBuildingLayer buildings;
+	FString error;
+	if (!TestTrue(TEXT("read feature collection"), ReadGeoJsonText(text, buildings, error)))
+	{
+		AddError(error);
+		return false;
+	}
+	if (!TestEqual(TEXT("building count"), buildings.Num(), 3))
+	{
+		return false;
+	}
+	//βغϵյ㱻ڻĸ̷߳
+	TestEqual(TEXT("ring size 0"), buildings.GetRingSize(0), 3);
+	TestEqual(TEXT("ring size 1"), buildings.GetRingSize(1), 4);
+	TestEqual(TEXT("ring size 2"), buildings.GetRingSize(2), 3);
+	TestEqual(TEXT("height 0"), buildings.GetHeight(0), 12.5);
+	TestEqual(TEXT("code 1"), buildings.GetCode(1), 3);
+	//2^53β볬19λЧֲ߿·Atodλһ£ֶȡʽõͬ
+	TestTrue(TEXT("height 2"), buildings.GetHeight(2) == FCStringAnsi::Atod("9007199254740993"));
+	TestEqual(TEXT("code 2"), buildings.GetCode(2), 5);
+
+	//γȱ˫
+	if (TestTrue(TEXT("source coords"), buildings.HasSourceCoords()))
+	{
+		TArrayView<const double> lonlat = buildings.GetSourceCoords();
+		TestEqual(TEXT("source coord count"), lonlat.Num(), buildings.NumCoords() * 2);
+		TestEqual(TEXT("lon"), lonlat[0], 116.3974123456789, 1e-12);
+		TestEqual(TEXT("lat"), lonlat[1], 39.9087654321, 1e-12);
+		int32 long_digits = 2 * (buildings.GetRingSize(0) + buildings.GetRingSize(1) + 1);
+		TestTrue(TEXT("long mantissa"), lonlat[long_digits] == FCStringAnsi::Atod("116.39741234567891234"));
+		TestTrue(TEXT("exponent"), lonlat[long_digits + 3] == 0.25);
+	}
+
+	FBuildingLayer broken;
+	TestFalse(TEXT("truncated file"), ReadGeoJsonText(TEXT(R"({ "features": [ { "type": "Feature", "geometry": { "type": "MultiPolygon", "coordinates": [ [ [ [1, 2], )"), broken, error));
+	TestFalse(TEXT("error message"), error.IsEmpty());
+	return true;
+}
+
+#endif
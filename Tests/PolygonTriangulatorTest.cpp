@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "Misc/AutomationTest.h"
+#include "PolygonTriangulator.h"
+#include "BuildingScratch.h"
+#include "Algo/Reverse.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//ʱΪ
+static double GetSignedArea2(const FVector2D& a, const FVector2D& b, const FVector2D& c)
+{
+	return ((double)b.X - a.X) * ((double)c.Y - a.Y) - ((double)b.Y - a.Y) * ((double)c.X - a.X);
+}
+
+static double GetRingArea(TArrayView<const FVector2D> ring)
+{
+	double area = 0.0;
+	for (int32 i = 0, j = ring.Num() - 1; i < ring.Num(); j = i++)
+	{
+		area += (double)ring[j].X * ring[i].Y - (double)ring[i].X * ring[j].Y;
+	}
+	return FMath::Abs(area) * 0.5;
+}
+
+//ǻn - 2ΣЧһ£ʱ뻷(0, i + 2, i + 1)򣩣֮͵ڶ
+static void TestTriangulation(FAutomationTestBase& test, const FString& name, TArrayView<const FVector2D> ring)
+{
+	FBuildingScratchMark scratch_mark;
+	TArray<int32> triangles;
+	if (!test.TestTrue(*(name + TEXT(" triangulated")), FPolygonTriangulator().Triangulate(ring, triangles)))
+	{
+		return;
+	}
+	test.TestEqual(*(name + TEXT(" triangle count")), triangles.Num(), (ring.Num() - 2) * 3);
+	double area = 0.0;
+	for (int32 i = 0; i + 2 < triangles.Num(); i += 3)
+	{
+		if (!test.TestTrue(*(name + TEXT(" index range")), triangles[i] >= 0 && triangles[i] < ring.Num()
+			&& triangles[i + 1] >= 0 && triangles[i + 1] < ring.Num() && triangles[i + 2] >= 0 && triangles[i + 2] < ring.Num()))
+		{
+			return;
+		}
+		double signed_area = GetSignedArea2(ring[triangles[i]], ring[triangles[i + 1]], ring[triangles[i + 2]]);
+		test.TestTrue(*(name + TEXT(" winding")), signed_area <= 0.0);
+		area -= signed_area * 0.5;
+	}
+	test.TestEqual(*(name + TEXT(" area")), area, GetRingArea(ring), 1e-6 * FMath::Max(1.0, GetRingArea(ring)));
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPolygonTriangulatorTest, "BuildingBuilder.Core.PolygonTriangulator",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPolygonTriangulatorTest::RunTest(const FString& Parameters)
+{
+	TArray<FVector2D> square = { FVector2D(0, 0), FVector2D(10, 0), FVector2D(10, 10), FVector2D(0, 10) };
+	TestTriangulation(*this, TEXT("square"), square);
+
+	TArray<FVector2D> notch = { FVector2D(0, 0), FVector2D(30, 0), FVector2D(30, 30), FVector2D(20, 30),
+		FVector2D(20, 10), FVector2D(10, 10), FVector2D(10, 30), FVector2D(0, 30) };
+	TestTriangulation(*this, TEXT("U shape"), notch);
+	//˳ʱ뷴򲻱
+	Algo::Reverse(notch);
+	TestTriangulation(*this, TEXT("clockwise U shape"), notch);
+
+	//ֵʱʹz
+	TArray<FVector2D> star;
+	const int32 star_points = 200;
+	for (int32 i = 0; i < star_points; i++)
+	{
+		double angle = 2.0 * PI * i / star_points;
+		double radius = i % 2 == 0 ? 100.0 : 40.0;
+		star.Add(FVector2D(radius * FMath::Cos(angle), radius * FMath::Sin(angle)));
+	}
+	TestTriangulation(*this, TEXT("star"), star);
+
+	//3е㹲ʱ޷ǻ
+	FBuildingScratchMark scratch_mark;
+	TArray<int32> triangles;
+	TArray<FVector2D> segment = { FVector2D(0, 0), FVector2D(10, 0) };
+	TestFalse(TEXT("2-point ring"), FPolygonTriangulator().Triangulate(segment, triangles));
+	TArray<FVector2D> line = { FVector2D(0, 0), FVector2D(10, 0), FVector2D(20, 0), FVector2D(5, 0) };
+	TestFalse(TEXT("collinear ring"), FPolygonTriangulator().Triangulate(line, triangles));
+	TestEqual(TEXT("no triangles for degenerate rings"), triangles.Num(), 0);
+	return true;
+}
+
+#endif